@@ -168,6 +168,30 @@ Matrix* hard_tanh_prime(Matrix* m);
  */
 Matrix* softmax_prime(Matrix* m);
 
+// Scalar forms, for kernels that do not work on Matrix objects.
+
+/**
+ * @brief Applies an elementwise activation to one value. SOFTMAX needs whole
+ * rows and is returned unchanged, as is IDENTITY.
+ * @param func The activation function.
+ * @param x The pre-activation value.
+ * @param leak_parameter The leak parameter (alpha) for the Leaky ReLU.
+ * @return The activation of x.
+ */
+double activate_scalar(activation_function func, double x,
+                       double leak_parameter);
+
+/**
+ * @brief Computes the derivative of an elementwise activation at one
+ * pre-activation value, as the matching *_prime matrix function does.
+ * @param func The activation function.
+ * @param z The pre-activation value.
+ * @param leak_parameter The leak parameter (alpha) for the Leaky ReLU.
+ * @return The derivative at z (1 for IDENTITY and SOFTMAX).
+ */
+double activation_prime_scalar(activation_function func, double z,
+                               double leak_parameter);
+
 #endif  // NN_ACTIVATION_H
 /**
  * @brief Converts an activation function enum to its string representation.
@@ -8,6 +8,34 @@
  * @brief Backpropagation and gradient computation APIs.
  */
 
+/**
+ * @brief Per-layer gradients backed by one contiguous buffer.
+ *
+ * The layout mirrors `NeuralNetwork::parameters`: layer i's weight gradient is
+ * followed by its bias gradient, then layer i+1's. `weights[i]` and `bias[i]`
+ * are views into `data`. Batch normalization gradients stay in the layers'
+ * BatchNorm; `batch_norm[i]` records the one the gradients were created for so
+ * that `zero_gradients` clears it too.
+ */
+typedef struct {
+  Matrix** weights;       /**< Per-layer weight gradient views (D_in×D_out). */
+  Matrix** bias;          /**< Per-layer bias gradient views (1×D_out). */
+  size_t num_layers;      /**< Number of layers. */
+  double* data;           /**< Contiguous backing buffer. */
+  size_t size;            /**< Number of doubles in `data`. */
+  BatchNorm** batch_norm; /**< Per-layer batch normalization, or NULL. */
+} NetworkGradients;
+
+/**
+ * @brief Receives one layer's gradients during `backpropagate_gradients`.
+ *
+ * Called from the last layer to the first. `dW` and `db` are only valid for
+ * the duration of the call. The callback may update `layer` in place.
+ */
+typedef void (*LayerGradientCallback)(size_t layer_index, Layer* layer,
+                                      const Matrix* dW, const Matrix* db,
+                                      void* user_data);
+
 //============================
 // Functions for Backpropagation
 //============================
@@ -22,10 +50,117 @@
 void backpropagate(NeuralNetwork* nn, const Matrix* y_true,
                    LossFunctionType loss_type, LossFunctionGrad loss_func_grad);
 
-/** @brief Calculate weight gradient for a specific layer. */
-Matrix* calculate_weight_gradient(const Cache* cache, size_t layer_index,
-                                  size_t total_layers);
+/**
+ * @brief Backpropagate a SOFTMAX output with categorical cross-entropy using
+ *        the fused kernel on the cached logits.
+ *
+ * Equivalent to `backpropagate(nn, y_true, CCE, ...)` but reads only the
+ * cached pre-activations of the output layer and returns the loss from the
+ * same pass, so no separate `categorical_cross_entropy` call is needed. Run
+ * `feedforward_logits` first to skip the probability matrix entirely.
+ * @return Mean cross-entropy of the batch.
+ */
+double backpropagate_softmax_cross_entropy(NeuralNetwork* nn,
+                                           const Matrix* y_true);
+
+/**
+ * @brief Single backward pass that emits dW and db per layer while its delta
+ *        is hot, instead of caching every delta for later gradient calls.
+ *
+ * Activations are read from `nn->cache` without copying and deltas are not
+ * cached, so `calculate_*_gradient` and `compute_gradients` cannot be used
+ * after this call.
+ * @param nn Network after `feedforward`.
+ * @param y_true Ground-truth labels/targets.
+ * @param loss_type Loss type; SOFTMAX output with CCE uses the fused kernel.
+ * @param loss_func_grad Gradient of the loss (required).
+ * @param grads If non-NULL, receives every layer's gradients.
+ * @param callback If non-NULL, called with each layer's gradients as soon as
+ *        they are ready (e.g. `optimizer_layer_callback`).
+ * @param user_data Passed to `callback`.
+ */
+void backpropagate_gradients(NeuralNetwork* nn, const Matrix* y_true,
+                             LossFunctionType loss_type,
+                             LossFunctionGrad loss_func_grad,
+                             NetworkGradients* grads,
+                             LayerGradientCallback callback, void* user_data);
+
+/**
+ * @brief `backpropagate_gradients` after `feedforward_sparse`.
+ *
+ * The first layer's weight gradient is input^T · delta over the CSR input, so
+ * only the weight rows of features that are non-zero somewhere in the batch
+ * receive products.
+ * @param input The sparse input that was passed to `feedforward_sparse`.
+ */
+void backpropagate_gradients_sparse(NeuralNetwork* nn,
+                                    const SparseMatrix* input,
+                                    const Matrix* y_true,
+                                    LossFunctionType loss_type,
+                                    LossFunctionGrad loss_func_grad,
+                                    NetworkGradients* grads,
+                                    LayerGradientCallback callback,
+                                    void* user_data);
+
+/**
+ * @brief Like `backpropagate_gradients`, but adds this batch's dW and db to
+ *        `grads` instead of overwriting them (GEMM with beta = 1).
+ *
+ * Call `zero_gradients` once, then run feedforward + this function on several
+ * micro-batches and apply a single update: since gradients are sums over
+ * rows, the result equals one step on the concatenated batch, with no
+ * per-micro-batch allocation for the gradients.
+ */
+void backpropagate_accumulate(NeuralNetwork* nn, const Matrix* y_true,
+                              LossFunctionType loss_type,
+                              LossFunctionGrad loss_func_grad,
+                              NetworkGradients* grads);
+
+/**
+ * @brief Calculate the weight gradient of one layer from the values cached by
+ *        `backpropagate`. Handles dense, convolutional and pooling layers,
+ *        which is why it takes the network rather than only its cache. Only
+ *        the weight gradient is computed.
+ * @return New matrix shaped like the layer's weights. Caller owns and must
+ *         free.
+ */
+Matrix* calculate_weight_gradient(const NeuralNetwork* nn, size_t layer_index);
+
+/**
+ * @brief Calculate the bias gradient of one layer from the values cached by
+ *        `backpropagate`. Handles dense, convolutional and pooling layers.
+ *        Only the bias gradient is computed.
+ * @return New matrix shaped like the layer's bias. Caller owns and must free.
+ */
+Matrix* calculate_bias_gradient(const NeuralNetwork* nn, size_t layer_index);
+
+/**
+ * @brief Derivative of a layer's activation at pre-activation values `z`.
+ * @return New matrix of elementwise derivatives. Caller owns and must free.
+ */
+Matrix* activation_derivative_for_layer(const Layer* layer, Matrix* z);
+
+//============================
+// Gradient Buffers
+//============================
+
+/**
+ * @brief Allocate zeroed gradient buffers matching the layer shapes of `nn`.
+ * @return New gradients, or NULL on allocation failure.
+ */
+NetworkGradients* create_gradients(const NeuralNetwork* nn);
+
+/** @brief Set every gradient to zero, batch normalization ones included. */
+void zero_gradients(NetworkGradients* grads);
+
+/**
+ * @brief Fill `grads` with dW and db for every layer from the deltas cached by
+ *        `backpropagate`, writing straight into the buffers.
+ */
+void compute_gradients(const NeuralNetwork* nn, NetworkGradients* grads);
+
+/** @brief L2 norm over all gradients, computed in one pass. */
+double gradient_l2_norm(const NetworkGradients* grads);
 
-/** @brief Calculate bias gradient for a specific layer. */
-Matrix* calculate_bias_gradient(const Cache* cache, size_t layer_index,
-                                size_t total_layers);
+/** @brief Free gradient buffers and views. */
+void free_gradients(NetworkGradients* grads);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file batch_norm.h
+ * @brief Batch normalization of dense layer pre-activations.
+ *
+ * A layer with a `batch_norm` computes z = gamma * (xW + b - mean) / std +
+ * beta before its activation. In training mode mean and variance come from
+ * the batch, in one fused pass over its rows, and are blended into running
+ * averages; in inference mode the running averages are used, which makes the
+ * normalization a per-feature affine map. `fold_batch_norm` merges that map
+ * into the layer's weights and bias, so a folded network runs at the cost of
+ * a plain one.
+ *
+ * gamma and beta are trained alongside the layer: the backward passes leave
+ * their gradients in `grad_gamma` and `grad_beta` and the optimizer applies
+ * its update rule to them. They are layer state, so trainers that run
+ * replicas concurrently (data-parallel, Hogwild, pipeline) do not support
+ * batch normalization; neither do the mixed-precision trainer, the quantizer
+ * and the C exporter, which need a folded network.
+ */
+
+/** @brief Default weight of the batch statistics in the running averages. */
+#define BATCH_NORM_MOMENTUM 0.1
+
+/** @brief Default variance guard. */
+#define BATCH_NORM_EPSILON 1e-5
+
+/**
+ * @brief Create batch normalization for `features` outputs: gamma 1, beta 0,
+ * running mean 0 and running variance 1.
+ * @return A new BatchNorm, or NULL on allocation failure.
+ */
+BatchNorm* create_batch_norm(size_t features);
+
+/** @brief Deep copy of `bn`, or NULL if `bn` is NULL or allocation fails. */
+BatchNorm* copy_batch_norm(const BatchNorm* bn);
+
+/** @brief Free `bn` (NULL is ignored). */
+void free_batch_norm(BatchNorm* bn);
+
+/**
+ * @brief Per-column mean and biased variance of `z` in a single pass over its
+ * rows (Welford's update, vectorized across columns).
+ * @param z Input (rows x cols, rows > 0).
+ * @param mean Receives cols means.
+ * @param var Receives cols variances.
+ */
+void batch_norm_statistics(const Matrix* z, double* mean, double* var);
+
+/**
+ * @brief Normalize layer `layer_index`'s pre-activation `z` in place and
+ * cache what the backward pass needs. Uses and updates batch statistics in
+ * training mode, the running averages otherwise. Does nothing if the layer
+ * has no batch normalization.
+ */
+void batch_norm_forward(const NeuralNetwork* nn, size_t layer_index,
+                        Matrix* z);
+
+/** @brief Inference-mode normalization of `z` in place, without caching. */
+void batch_norm_inference(const BatchNorm* bn, Matrix* z);
+
+/**
+ * @brief Turn dL/dz of the normalized pre-activation of layer `layer_index`
+ * into dL/dz of its input, in place, and store dL/dgamma and dL/dbeta.
+ * Does nothing if the layer has no batch normalization.
+ * @param beta 0 to overwrite `grad_gamma`/`grad_beta`, 1 to add to them.
+ */
+void batch_norm_backward(const NeuralNetwork* nn, size_t layer_index,
+                         Matrix* delta, double beta);
+
+/**
+ * @brief Merge `layer`'s inference-mode normalization into its weights and
+ * bias and remove it: W[:, j] *= s_j and b_j = (b_j - mean_j) * s_j + beta_j
+ * with s_j = gamma_j / sqrt(var_j + epsilon). Does nothing without one.
+ */
+void fold_batch_norm(Layer* layer);
+
+/** @brief `fold_batch_norm` on every layer of `nn`. */
+void fold_network_batch_norm(NeuralNetwork* nn);
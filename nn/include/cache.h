@@ -26,6 +26,25 @@ void cache_put(Cache* cache, const char* key, Matrix* m);
 /** @brief Retrieve a deep copy of a matrix by key, or NULL if not found. */
 Matrix* cache_get(Cache* cache, const char* key);
 
+/** @brief Borrow a stored matrix by key without copying, or NULL if not
+ *          found. The cache keeps ownership; the pointer is valid until the
+ *          entry is overwritten or the cache is cleared. Read-only hot paths
+ *          use this to avoid the deep copy made by `cache_get`. */
+const Matrix* cache_peek(const Cache* cache, const char* key);
+
+/** @brief Get a writable raw buffer of at least `bytes` bytes under `key`,
+ *          reusing the existing allocation when it is large enough. The cache
+ *          owns the buffer. Returns NULL on allocation failure. Used for
+ *          scratch that is not a matrix, such as packed dropout masks. */
+void* cache_reserve_buffer(Cache* cache, const char* key, size_t bytes);
+
+/** @brief Borrow a raw buffer stored with `cache_reserve_buffer`, or NULL if
+ *          not found. */
+const void* cache_peek_buffer(const Cache* cache, const char* key);
+
+/** @brief Remove and free the entry stored under `key`, if any. */
+void cache_remove(Cache* cache, const char* key);
+
 /** @brief Free all entries in the cache, without freeing the cache itself. */
 void clear_cache(Cache* cache);
 
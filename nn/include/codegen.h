@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "neural_network.h"
+
+/**
+ * @file codegen.h
+ * @brief Export a trained network as standalone, shape-specialized C source.
+ *
+ * The generated translation unit depends only on `<math.h>`. Weights become
+ * `static const` arrays and the forward function has every loop bound,
+ * activation and the layer count fixed at compile time, so the compiler can
+ * unroll and vectorize it freely. It performs no allocation and keeps no
+ * cache.
+ */
+
+/**
+ * @brief Write C source for a single-sample forward pass of `nn`.
+ *
+ * The output defines `<prefix>_INPUT_SIZE`, `<prefix>_OUTPUT_SIZE` and
+ * `void <prefix>_forward(const double* input, double* output)`.
+ * @param stream Destination stream.
+ * @param nn Trained network (non-NULL).
+ * @param prefix C identifier used to prefix every generated symbol.
+ * @return 0 on success, -1 if writing to `stream` failed.
+ */
+int export_network_c(FILE* stream, const NeuralNetwork* nn,
+                     const char* prefix);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "activation.h"
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file conv.h
+ * @brief 2D convolution layers lowered to GEMM with im2col.
+ *
+ * A convolutional layer is a `Layer` with a `conv` geometry. Its input rows
+ * hold in_height×in_width×in_channels values and its output rows
+ * out_height×out_width×out_channels values, both channels-last (NHWC), so
+ * convolutional and dense layers chain without reordering and a dense layer
+ * can consume a flattened feature map directly.
+ *
+ * The forward pass packs every receptive field of the batch into one row of
+ * a (N·H_out·W_out)×(kernel²·C_in) matrix and multiplies it by the
+ * (kernel²·C_in)×C_out weights in a single library GEMM; in channels-last
+ * order the product already is the output batch. The backward pass uses the
+ * same packing for dW and scatters dcol = delta · W^T back with col2im.
+ */
+
+/**
+ * @brief Create a convolutional layer with zeroed weights and bias.
+ * @param in_height Input height.
+ * @param in_width Input width.
+ * @param in_channels Input channels.
+ * @param out_channels Number of filters.
+ * @param kernel_size Square kernel side (at most the padded input size).
+ * @param stride Step between windows (at least 1).
+ * @param padding Zero padding on every border.
+ * @param activation Activation of the layer (not SOFTMAX).
+ * @return A new layer, or NULL on allocation failure. Owned by the network
+ *         it is stored in.
+ */
+Layer* create_conv2d_layer(size_t in_height, size_t in_width,
+                           size_t in_channels, size_t out_channels,
+                           size_t kernel_size, size_t stride, size_t padding,
+                           activation_function activation);
+
+/**
+ * @brief Pack the receptive fields of a batch into rows.
+ * @param conv Convolution geometry.
+ * @param input Batch (N x in_height·in_width·in_channels).
+ * @param col Receives (N·out_height·out_width) x (kernel²·in_channels).
+ */
+void im2col(const Conv2D* conv, const Matrix* input, Matrix* col);
+
+/**
+ * @brief Inverse scatter of `im2col`: sums every packed value back into the
+ * input position it was read from; padding positions are dropped.
+ * @param conv Convolution geometry.
+ * @param col Packed values, shaped like the output of `im2col`.
+ * @param output Receives the batch (N x in_height·in_width·in_channels).
+ */
+void col2im(const Conv2D* conv, const Matrix* col, Matrix* output);
+
+/**
+ * @brief Convolve a batch and add the per-channel bias.
+ * @param layer Convolutional layer.
+ * @param input Batch (N x layer input size).
+ * @return A new N x (out_height·out_width·out_channels) matrix.
+ */
+Matrix* conv2d_forward(const Layer* layer, const Matrix* input);
+
+/**
+ * @brief dW = im2col(input)^T · delta and db = per-channel sums of delta.
+ * @param layer Convolutional layer.
+ * @param input The batch the forward pass was run on.
+ * @param delta dL/dz of the layer output (N x layer output size).
+ * @param beta 0 to overwrite dW and db, 1 to add to them.
+ * @param dW Weight gradient, shaped like `layer->weights`, or NULL to skip
+ *        it (then `input` is not read).
+ * @param db Bias gradient, shaped like `layer->bias`, or NULL to skip it.
+ */
+void conv2d_parameter_gradients(const Layer* layer, const Matrix* input,
+                                const Matrix* delta, double beta, Matrix* dW,
+                                Matrix* db);
+
+/**
+ * @brief dL/dinput = col2im(delta · W^T).
+ * @param layer Convolutional layer.
+ * @param delta dL/dz of the layer output (N x layer output size).
+ * @param delta_input Receives N x layer input size.
+ */
+void conv2d_input_gradient(const Layer* layer, const Matrix* delta,
+                           Matrix* delta_input);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file dropout.h
+ * @brief Inverted dropout on hidden layer outputs.
+ *
+ * A hidden layer with `dropout_rate` p > 0 has each output zeroed with
+ * probability p during training and the survivors scaled by 1 / (1 - p), so
+ * inference needs no rescaling and skips dropout entirely. The keep-mask is
+ * drawn from the counter-based RNG as packed bits (one bit per output) and
+ * stored in the network cache under "mask_i"; the backward pass reapplies it
+ * to the layer's delta. `feedforward` and the backward passes call these
+ * functions; they are exposed for custom training loops.
+ */
+
+/** @brief 1 if layer `layer_index` of `nn` applies dropout in this pass. */
+int dropout_active(const NeuralNetwork* nn, size_t layer_index);
+
+/**
+ * @brief Draw a new keep-mask for layer `layer_index` and apply it to its
+ * activations `a` in place. Does nothing unless `dropout_active`.
+ */
+void dropout_forward(const NeuralNetwork* nn, size_t layer_index, Matrix* a);
+
+/**
+ * @brief Multiply `delta` (dL/da of layer `layer_index`, or dL/dz after the
+ * activation derivative has been applied) by the cached mask and scale, in
+ * place. Does nothing unless `dropout_active`.
+ */
+void dropout_backward(const NeuralNetwork* nn, size_t layer_index,
+                      Matrix* delta);
@@ -18,12 +18,66 @@
  */
 NeuralNetwork* create_network(size_t num_layers);
 
+/**
+ * @brief Allocate a zeroed buffer of `count` doubles with the same cache-line
+ *        alignment as `nn->parameters`, for buffers that mirror it.
+ * @param count Number of doubles.
+ * @return The buffer, or NULL on allocation failure. Release with `free`.
+ */
+double* create_parameter_buffer(size_t count);
+
+/**
+ * @brief Allocate a fully connected network whose parameters live in one
+ *        contiguous, cache-line aligned buffer (`nn->parameters`).
+ *
+ * Each layer's `weights` and `bias` are views into that buffer, so whole-model
+ * operations (optimizer updates, norms, checkpoints, gradient exchange) can
+ * run as a single streaming loop. Parameters are zero-initialized and must be
+ * updated in place; never replace or `free_matrix` a layer's matrices.
+ * @param layer_sizes Array of num_layers + 1 widths, input first.
+ * @param activations Array of num_layers activation types.
+ * @param num_layers Number of layers.
+ * @return A new network, or NULL on allocation failure.
+ */
+NeuralNetwork* create_contiguous_network(const size_t* layer_sizes,
+                                         const activation_function* activations,
+                                         size_t num_layers);
+
 /**
  * @brief Free a network and its associated resources.
  * @param nn The network to free.
  */
 void free_network(NeuralNetwork* nn);
 
+/**
+ * @brief Free a standalone layer: its weights, bias and optional batch
+ *        normalization, convolution and pooling descriptors.
+ * @param layer The layer to free; NULL is ignored.
+ */
+void free_layer(Layer* layer);
+
+/**
+ * @brief Deep copy a network's layers; the copy gets its own empty cache.
+ * @param nn The network to copy.
+ * @return A new network, or NULL on allocation failure. Free with
+ *         `free_network`.
+ */
+NeuralNetwork* copy_network(const NeuralNetwork* nn);
+
+/**
+ * @brief Create a network that shares `nn`'s layers but has its own cache.
+ *
+ * Each thread that runs `feedforward`/`backpropagate` concurrently needs its
+ * own replica. The layers stay owned by `nn`. `training` is copied at
+ * creation only; a replica kept across steps must be resynchronized.
+ * @return A new replica, or NULL on allocation failure. Free with
+ *         `free_network_replica`.
+ */
+NeuralNetwork* create_network_replica(const NeuralNetwork* nn);
+
+/** @brief Free a replica's cache and struct, leaving the shared layers. */
+void free_network_replica(NeuralNetwork* replica);
+
 /**
  * @brief Run the forward pass and cache intermediates for backprop.
  * @param nn Network pointer (non-NULL).
@@ -32,3 +86,76 @@ void free_network(NeuralNetwork* nn);
  *         Caller owns and must free.
  */
 Matrix* feedforward(const NeuralNetwork* nn, const Matrix* input);
+
+/**
+ * @brief Run the forward pass like `feedforward` but skip the output layer's
+ *        activation, for losses fused with it (see
+ *        `backpropagate_softmax_cross_entropy`). The output activation is
+ *        neither computed nor cached.
+ * @param nn Network pointer (non-NULL).
+ * @param input Input matrix (batch_size x input_features).
+ * @return Pre-activation of the last layer (batch_size x output_features).
+ *         Caller owns and must free.
+ */
+Matrix* feedforward_logits(const NeuralNetwork* nn, const Matrix* input);
+
+/**
+ * @brief Run the forward pass on a sparse (CSR) input.
+ *
+ * The first layer is a sparse-dense product that skips zero features; the
+ * remaining layers run as in `feedforward`, caching their intermediates. The
+ * input itself is not cached, so the backward pass must be given it again
+ * (`backpropagate_gradients_sparse`).
+ * @param nn Network pointer (non-NULL).
+ * @param input Sparse input (batch_size x input_features).
+ * @return Output activation of the last layer (batch_size x output_features).
+ *         Caller owns and must free.
+ */
+Matrix* feedforward_sparse(const NeuralNetwork* nn, const SparseMatrix* input);
+
+/** @brief Input values per sample of `layer` (D_in, or H·W·C_in). */
+size_t layer_input_size(const Layer* layer);
+
+/** @brief Output values per sample of `layer` (D_out, or H_out·W_out·C_out). */
+size_t layer_output_size(const Layer* layer);
+
+/**
+ * @brief 1 if every layer of `nn` is fully connected without batch
+ *        normalization or pooling, the only kind the specialized trainers,
+ *        the quantizer and the C exporter handle.
+ */
+int network_is_dense(const NeuralNetwork* nn);
+
+/**
+ * @brief 1 if any layer of `nn` has a positive `dropout_rate`. Trainers with
+ *        their own forward kernels (pipeline, mixed precision) reject such
+ *        networks.
+ */
+int network_has_dropout(const NeuralNetwork* nn);
+
+/**
+ * @brief Apply one layer (affine transform + activation) without caching.
+ * @param layer Layer pointer (non-NULL).
+ * @param input Layer input (batch_size x D_in).
+ * @return Layer activation (batch_size x D_out). Caller owns and must free.
+ */
+Matrix* layer_forward(const Layer* layer, const Matrix* input);
+
+/**
+ * @brief Apply a layer's activation function to pre-activation values `z`.
+ * @return New matrix with the activation of `z`. Caller owns and must free.
+ */
+Matrix* apply_layer_activation(const Layer* layer, Matrix* z);
+
+/**
+ * @brief Run the forward pass without caching intermediates.
+ *
+ * Unlike `feedforward`, this never writes to `nn->cache`, so it is safe to call
+ * from several threads at once on a network whose layers are not being
+ * updated.
+ * @param nn Network pointer (non-NULL).
+ * @param input Input matrix (batch_size x input_features).
+ * @return Output activation of the last layer (batch_size x output_features).
+ *         Caller owns and must free.
+ */
+Matrix* predict(const NeuralNetwork* nn, const Matrix* input);
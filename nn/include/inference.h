@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file inference.h
+ * @brief Asynchronous inference submission backed by a worker pool.
+ *
+ * Jobs are submitted without blocking on the forward pass and are executed by
+ * a fixed set of worker threads using the cache-free `predict` path. Results
+ * are either handed to a per-job completion callback or queued for the
+ * submitting thread to collect with `inference_poll`/`inference_wait_any`.
+ *
+ * The number of jobs in flight (submitted but not yet collected) is bounded by
+ * the pool's capacity; `inference_submit` blocks once that bound is reached,
+ * while `inference_try_submit` returns immediately instead.
+ */
+
+/** @brief Opaque worker pool type; implementation hidden. */
+typedef struct InferencePool InferencePool;
+
+/**
+ * @brief Completion callback, invoked on a worker thread.
+ * @param job_id Identifier returned at submission time.
+ * @param output Network output for the job. The callback takes ownership.
+ * @param user_data Pointer passed at submission time.
+ */
+typedef void (*InferenceCallback)(size_t job_id, Matrix* output,
+                                  void* user_data);
+
+/**
+ * @brief Create a pool of worker threads serving inference for `nn`.
+ * @param nn Network to run. Must outlive the pool and not be modified while
+ *           jobs are running.
+ * @param num_workers Number of worker threads (at least 1).
+ * @param capacity Maximum number of jobs in flight (at least 1).
+ * @return A new pool, or NULL if allocation or thread creation fails.
+ */
+InferencePool* create_inference_pool(const NeuralNetwork* nn,
+                                     size_t num_workers, size_t capacity);
+
+/**
+ * @brief Submit a job, blocking while the pool is at capacity.
+ * @param pool The pool.
+ * @param input Input batch. Must stay valid until the job completes.
+ * @param callback Optional completion callback; when NULL the result is queued
+ *                 for `inference_poll`/`inference_wait_any`.
+ * @param user_data Passed through to the callback.
+ * @return The job identifier.
+ */
+size_t inference_submit(InferencePool* pool, const Matrix* input,
+                        InferenceCallback callback, void* user_data);
+
+/**
+ * @brief Submit a job only if the pool has room.
+ * @param job_id Receives the job identifier on success (may be NULL).
+ * @return 1 if the job was queued, 0 if the pool is at capacity.
+ */
+int inference_try_submit(InferencePool* pool, const Matrix* input,
+                         InferenceCallback callback, void* user_data,
+                         size_t* job_id);
+
+/**
+ * @brief Collect one completed result without blocking.
+ * @param job_id Receives the identifier of the returned job (may be NULL).
+ * @return The output of a completed job (caller owns), or NULL if none is
+ *         ready.
+ */
+Matrix* inference_poll(InferencePool* pool, size_t* job_id);
+
+/**
+ * @brief Block until a queued result is available and collect it.
+ * @param job_id Receives the identifier of the returned job (may be NULL).
+ * @return The output of a completed job (caller owns), or NULL if no jobs
+ *         without a callback are outstanding.
+ */
+Matrix* inference_wait_any(InferencePool* pool, size_t* job_id);
+
+/** @brief Block until every submitted job has finished running. */
+void inference_drain(InferencePool* pool);
+
+/**
+ * @brief Finish outstanding jobs, stop the workers and free the pool.
+ * Results that were never collected are freed.
+ */
+void free_inference_pool(InferencePool* pool);
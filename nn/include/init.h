@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file init.h
+ * @brief Weight initialization schemes.
+ *
+ * Xavier (Glorot) schemes keep the activation variance constant across
+ * layers with symmetric activations such as tanh and sigmoid; He schemes
+ * account for ReLU zeroing half its inputs. Values come from the global
+ * counter-based stream (rng.h) through its parallel bulk fills, so a whole
+ * layer is filled by all OpenMP threads and the result depends only on the
+ * seed and the order of the calls.
+ */
+
+/** @brief Supported initialization schemes. */
+typedef enum {
+  INIT_XAVIER_UNIFORM, /**< U(-a, a), a = sqrt(6 / (fan_in + fan_out)). */
+  INIT_XAVIER_NORMAL,  /**< N(0, s^2), s = sqrt(2 / (fan_in + fan_out)). */
+  INIT_HE_UNIFORM,     /**< U(-a, a), a = sqrt(6 / fan_in). */
+  INIT_HE_NORMAL,      /**< N(0, s^2), s = sqrt(2 / fan_in). */
+} InitScheme;
+
+/**
+ * @brief Fill `m` according to `scheme`.
+ * @param m Matrix to fill (non-NULL).
+ * @param scheme Initialization scheme.
+ * @param fan_in Inputs per unit (at least 1).
+ * @param fan_out Outputs per unit.
+ */
+void initialize_matrix(Matrix* m, InitScheme scheme, size_t fan_in,
+                       size_t fan_out);
+
+/**
+ * @brief Initialize a layer's weights with `scheme` (fan_in = D_in,
+ * fan_out = D_out; kernel²·C_in and kernel²·C_out for a convolution) and
+ * zero its bias. Max-pool layers are skipped.
+ */
+void initialize_layer(Layer* layer, InitScheme scheme);
+
+/** @brief `initialize_layer` on every layer of `nn`. */
+void initialize_network(NeuralNetwork* nn, InitScheme scheme);
@@ -36,7 +36,8 @@ typedef struct _Matrix {
 
 /** @brief Read a matrix from a text file. */
 Matrix* read_matrix(const char* filename);
-/** @brief Create an uninitialized matrix with given shape. */
+/** @brief Create an uninitialized matrix with given shape. An empty matrix
+ *         has a NULL data buffer. */
 Matrix* create_matrix(size_t rows, size_t cols);
 /** @brief Deep copy a matrix. */
 Matrix* copy_matrix(const Matrix* m);
@@ -46,6 +47,11 @@ void fill_matrix(Matrix* m, double n);
 void randomize_matrix(Matrix* m, double n);
 /** @brief Free a matrix and its data buffer. */
 void free_matrix(Matrix* m);
+/** @brief Wrap an existing buffer as a matrix without copying or owning it.
+ *         Release with `free_matrix_view`, never `free_matrix`. */
+Matrix* create_matrix_view(double* data, size_t rows, size_t cols);
+/** @brief Free a view's struct, leaving the underlying buffer untouched. */
+void free_matrix_view(Matrix* view);
 /** @brief Print a matrix to stdout (for debugging). */
 void print_matrix(Matrix* m);
 /** @brief Return the index of the maximum element (flattened argmax). */
@@ -78,3 +84,70 @@ Matrix* add_bias_to_matrix(Matrix* m, Matrix* bias);
 
 /** @brief Sum the columns of a matrix, returning a row vector. */
 Matrix* sum_matrix_columns(Matrix* m);
+
+/**
+ * @brief General matrix product into an existing matrix:
+ *        c = alpha * op(a) · op(b) + beta * c, where op(x) is x or x^T.
+ *
+ * With beta = 0 the previous contents of `c` are ignored; with beta = 1 the
+ * product is accumulated into `c`. No memory is allocated.
+ */
+void gemm_matrix(int transpose_a, int transpose_b, double alpha,
+                 const Matrix* a, const Matrix* b, double beta, Matrix* c);
+
+/**
+ * @brief Copy rows `indices[0..n)` of `src` into rows 0..n of `dst` and set
+ *        `dst->rows` to n.
+ *
+ * `dst` is a reusable batch buffer with room for at least n rows of
+ * `src->cols` values; its capacity is the caller's responsibility. Upcoming
+ * source rows are prefetched while the current one is copied, since random
+ * row order defeats the hardware prefetcher.
+ */
+void gather_rows(const Matrix* src, const size_t* indices, size_t n,
+                 Matrix* dst);
+
+/** @brief Column sums into an existing row vector: out = colsum(m) + beta*out.
+ */
+void sum_matrix_columns_into(const Matrix* m, double beta, Matrix* out);
+
+//============================
+// Sparse Matrices
+//============================
+
+/**
+ * @brief Sparse matrix in compressed sparse row (CSR) form.
+ *
+ * Row r's non-zeros are `values[row_ptr[r] .. row_ptr[r + 1])`, in column
+ * order, at columns `col_indices[...]`. `row_ptr` has rows + 1 entries.
+ */
+typedef struct {
+  double* values;      /**< Non-zero values (nnz). */
+  size_t* col_indices; /**< Column of each value (nnz). */
+  size_t* row_ptr;     /**< Start of each row in values (rows + 1). */
+  size_t rows;
+  size_t cols;
+  size_t nnz;
+} SparseMatrix;
+
+/** @brief Convert a dense matrix to CSR, keeping the non-zero elements. */
+SparseMatrix* dense_to_sparse(const Matrix* m);
+/** @brief Free a sparse matrix and its buffers. */
+void free_sparse_matrix(SparseMatrix* m);
+
+/**
+ * @brief Sparse-dense product into an existing matrix: c = a · b + beta * c.
+ *
+ * Only the rows of `b` whose index is a non-zero column of `a` are read.
+ */
+void sparse_gemm(const SparseMatrix* a, const Matrix* b, double beta,
+                 Matrix* c);
+
+/**
+ * @brief Transposed sparse-dense product: c = a^T · b + beta * c.
+ *
+ * Only the rows of `c` whose index is a non-zero column of `a` receive
+ * products; with beta = 1 no other row is touched.
+ */
+void sparse_gemm_transpose(const SparseMatrix* a, const Matrix* b,
+                           double beta, Matrix* c);
@@ -47,6 +47,20 @@ double mean_absolute_error(const Matrix* y_hat, const Matrix* y);
 /** @brief Binary Cross-Entropy (BCE). */
 double binary_cross_entropy(const Matrix* y_hat, const Matrix* y);
 
+/**
+ * @brief Fused softmax + categorical cross-entropy on raw logits.
+ *
+ * Uses a per-row log-sum-exp, so it is stable for large logits and never
+ * takes the log of a probability.
+ * @param logits Pre-softmax values (batch_size x classes).
+ * @param y One-hot (or probability) targets of the same shape.
+ * @param delta If non-NULL, receives softmax(logits) - y, the gradient of the
+ *        loss sum with respect to the logits. Same shape as `logits`.
+ * @return Cross-entropy averaged over rows, as `categorical_cross_entropy`.
+ */
+double softmax_cross_entropy(const Matrix* logits, const Matrix* y,
+                             Matrix* delta);
+
 //==============================
 // Loss Function Gradients
 //==============================
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+
+/**
+ * @file mixed_precision.h
+ * @brief Mixed-precision training: float32 compute, double master weights.
+ *
+ * Each step casts the network's weights to a float32 shadow copy and runs the
+ * forward pass, the hidden-layer activations and the backward GEMMs in
+ * float32, so twice as many values fit in a SIMD register and the saved
+ * activations take half the memory. Only the output layer's loss gradient is
+ * evaluated in double.
+ *
+ * The output delta is multiplied by a loss scale before it enters the float32
+ * backward pass so small gradients do not flush to zero. Gradients are
+ * unscaled into double buffers and applied to the master weights by the
+ * optimizer. If any gradient is Inf or NaN the step is skipped and the scale
+ * halved; after `MIXED_PRECISION_GROWTH_INTERVAL` clean steps in a row the
+ * scale is doubled again.
+ */
+
+/** @brief Clean steps after which the loss scale is doubled. */
+#define MIXED_PRECISION_GROWTH_INTERVAL 2000
+
+/** @brief Upper bound of the dynamic loss scale. */
+#define MIXED_PRECISION_MAX_SCALE 16777216.0
+
+/** @brief Opaque mixed-precision trainer; implementation hidden. */
+typedef struct MixedPrecisionTrainer MixedPrecisionTrainer;
+
+/**
+ * @brief Create a mixed-precision trainer for `nn`.
+ * @param nn Network to train (non-NULL). Must outlive the trainer.
+ * @param loss_type Loss type; SOFTMAX output with CCE uses the fused kernel.
+ * @param loss_func Loss used for the returned value; may be NULL.
+ * @param loss_func_grad Gradient of the loss (required).
+ * @param initial_scale Initial loss scale (at least 1); clamped to
+ *        MIXED_PRECISION_MAX_SCALE.
+ * @return A new trainer, or NULL on allocation failure.
+ */
+MixedPrecisionTrainer* create_mixed_precision_trainer(
+    NeuralNetwork* nn, LossFunctionType loss_type, LossFunction loss_func,
+    LossFunctionGrad loss_func_grad, double initial_scale);
+
+/**
+ * @brief Run one mixed-precision training step on a mini-batch.
+ *
+ * The update is skipped, and the loss scale halved, if the scaled gradients
+ * overflow float32.
+ * @param trainer Trainer (non-NULL).
+ * @param opt Optimizer created for the trainer's network.
+ * @param x Mini-batch inputs (batch_size x input_features).
+ * @param y Mini-batch targets (batch_size x output_features).
+ * @return Loss of the batch before the update, 0 if no loss was given, or
+ *         -1 if the activation buffers could not be allocated (the step is
+ *         not taken).
+ */
+double mixed_precision_step(MixedPrecisionTrainer* trainer, Optimizer* opt,
+                            const Matrix* x, const Matrix* y);
+
+/** @brief Current loss scale. */
+double mixed_precision_loss_scale(const MixedPrecisionTrainer* trainer);
+
+/** @brief Number of steps skipped because of overflow so far. */
+size_t mixed_precision_skipped_steps(const MixedPrecisionTrainer* trainer);
+
+/** @brief Free the trainer. The network is not freed. */
+void free_mixed_precision_trainer(MixedPrecisionTrainer* trainer);
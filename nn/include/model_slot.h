@@ -0,0 +1,63 @@
+#pragma once
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file model_slot.h
+ * @brief Hot-swappable model holder for long-running inference processes.
+ *
+ * A `ModelSlot` publishes one network at a time. Readers pin the current
+ * network with `model_slot_acquire` and unpin it with `model_slot_release`;
+ * acquiring never blocks. `model_slot_publish` swaps in a new network with a
+ * single atomic pointer exchange and then waits for a grace period (every
+ * reader that could still see the old network has released it) before freeing
+ * the old one, RCU style. In-flight requests therefore finish on the weights
+ * they started with while new requests pick up the new weights immediately.
+ *
+ * Networks held by a slot must only be used through cache-free entry points
+ * such as `predict`, since many readers may share one network.
+ */
+
+/** @brief Opaque model slot type; implementation hidden. */
+typedef struct ModelSlot ModelSlot;
+
+/** @brief A pinned reference to the network that was current at acquire. */
+typedef struct {
+  const NeuralNetwork* nn; /**< The pinned network. */
+  unsigned int phase;      /**< Reader phase; pass back unchanged. */
+} ModelSnapshot;
+
+/**
+ * @brief Create a slot holding `initial`. The slot takes ownership.
+ * @return A new slot, or NULL on allocation failure.
+ */
+ModelSlot* create_model_slot(NeuralNetwork* initial);
+
+/** @brief Pin the current network. Lock-free; never waits for writers. */
+ModelSnapshot model_slot_acquire(ModelSlot* slot);
+
+/** @brief Unpin a network pinned by `model_slot_acquire`. */
+void model_slot_release(ModelSlot* slot, ModelSnapshot snapshot);
+
+/**
+ * @brief Atomically replace the current network with `next`.
+ *
+ * The slot takes ownership of `next`. Returns once no reader can still hold the
+ * previous network, which is then freed. Meant to be called from a background
+ * thread that has just finished building or loading `next`; concurrent
+ * publishers are serialized.
+ */
+void model_slot_publish(ModelSlot* slot, NeuralNetwork* next);
+
+/**
+ * @brief Run `predict` on the current network, pinning it for the duration.
+ * @return Output activation of the last layer. Caller owns and must free.
+ */
+Matrix* model_slot_predict(ModelSlot* slot, const Matrix* input);
+
+/**
+ * @brief Free the slot and its current network.
+ * No readers may be active and no publish may be in progress.
+ */
+void free_model_slot(ModelSlot* slot);
@@ -11,6 +11,63 @@
  * @brief Neural network layer and network structures.
  */
 
+//==============================
+// Batch Normalization Struct
+//==============================
+
+/**
+ * @brief Per-feature normalization of a layer's pre-activation (see
+ * batch_norm.h). Every matrix is 1×D_out.
+ */
+typedef struct _BatchNorm {
+  Matrix* gamma;        /**< Learned scale. */
+  Matrix* beta;         /**< Learned shift. */
+  Matrix* running_mean; /**< Mean used in inference mode. */
+  Matrix* running_var;  /**< Variance used in inference mode. */
+  Matrix* grad_gamma;   /**< dL/dgamma of the last backward pass. */
+  Matrix* grad_beta;    /**< dL/dbeta of the last backward pass. */
+  double momentum;      /**< Weight of the batch in the running averages. */
+  double epsilon;       /**< Variance guard. */
+} BatchNorm;
+
+//==============================
+// Convolution Geometry Struct
+//==============================
+
+/**
+ * @brief Shape of a 2D convolution (see conv.h). Inputs and outputs are rows
+ * of H×W×C values in channels-last order.
+ */
+typedef struct _Conv2D {
+  size_t in_height;    /**< Input height. */
+  size_t in_width;     /**< Input width. */
+  size_t in_channels;  /**< Input channels. */
+  size_t out_channels; /**< Output channels (filters). */
+  size_t kernel_size;  /**< Square kernel side. */
+  size_t stride;       /**< Step between windows, both directions. */
+  size_t padding;      /**< Zero padding on every border. */
+  size_t out_height;   /**< (in_height + 2 padding - kernel) / stride + 1. */
+  size_t out_width;    /**< (in_width + 2 padding - kernel) / stride + 1. */
+} Conv2D;
+
+//==============================
+// Pooling Geometry Struct
+//==============================
+
+/**
+ * @brief Shape of a 2D max-pool (see pool.h). Inputs and outputs are rows of
+ * H×W×C values in channels-last order.
+ */
+typedef struct _Pool2D {
+  size_t in_height;  /**< Input height. */
+  size_t in_width;   /**< Input width. */
+  size_t channels;   /**< Channels, pooled independently. */
+  size_t window;     /**< Square window side. */
+  size_t stride;     /**< Step between windows, both directions. */
+  size_t out_height; /**< (in_height - window) / stride + 1. */
+  size_t out_width;  /**< (in_width - window) / stride + 1. */
+} Pool2D;
+
 //==============================
 // Neural Network Layer Struct
 //==============================
@@ -19,17 +76,37 @@
 typedef Matrix* (*ActivationFunc)(Matrix*);
 
 /**
- * @brief Fully connected layer parameters and activation.
+ * @brief Fully connected, convolutional or max-pool layer parameters and
+ * activation.
  */
 typedef struct _Layer {
-  Matrix* weights; /**< Weight matrix (D_in×D_out). */
-  Matrix* bias;    /**< Bias vector as (1×D_out). */
+  /** Weight matrix (D_in×D_out), (kernel²·C_in)×C_out for a convolution,
+   * or 0×0 for a max-pool. */
+  Matrix* weights;
+  /** Bias vector as (1×D_out), (1×C_out) for a convolution, or 1×0 for a
+   * max-pool. */
+  Matrix* bias;
 
   activation_function
       activation_type; /**< Type of activation function for this layer. */
 
   /** The leak parameter for Leaky ReLU activation. */
   double leak_parameter;
+
+  /** Fraction of this layer's outputs zeroed in training mode (0 disables
+   * dropout). Ignored on the output layer. */
+  double dropout_rate;
+
+  /** Batch normalization between the bias add and the activation, or NULL.
+   * Owned by the layer. */
+  BatchNorm* batch_norm;
+
+  /** Convolution geometry, or NULL for a fully connected layer. Owned by the
+   * layer. */
+  Conv2D* conv;
+
+  /** Max-pool geometry, or NULL. Owned by the layer. */
+  Pool2D* pool;
 } Layer;
 
 //==============================
@@ -45,6 +122,18 @@ typedef struct _NeuralNetwork {
 
   /** Caches intermediate forward/backward values. */
   Cache* cache;
+
+  /** Single buffer backing every layer's weights and bias when the network
+   * was built with `create_contiguous_network`, otherwise NULL. Layer i's
+   * weights are followed immediately by its bias, then layer i+1's weights. */
+  double* parameters;
+  size_t num_parameters; /**< Length of `parameters` (0 if NULL). */
+
+  /** Non-zero in training mode, where `feedforward` applies dropout and
+   * batch normalization uses batch statistics. Zero (the default) for
+   * inference; do not change it between a forward pass and its backward
+   * pass. */
+  int training;
 } NeuralNetwork;
 
 /**
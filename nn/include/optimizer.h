@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "backprop.h"
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file optimizer.h
+ * @brief Parameter update rules applied in place to layer weights.
+ *
+ * Updates write straight into the existing `weights` and `bias` buffers in a
+ * single fused pass, so layer matrices keep their addresses across training
+ * steps. Stateful optimizers keep their per-parameter state (velocity, moment
+ * estimates) in buffers allocated once when the optimizer is created; each
+ * update reads the gradient and updates the state and the parameters in the
+ * same loop.
+ *
+ * Batch normalization scale and shift get the same update rule as the weights
+ * whenever their layer is updated; their state is laid out after the network
+ * parameters. Batch normalization must be attached before the optimizer is
+ * created.
+ */
+
+/** @brief Enumerates supported optimizers. */
+typedef enum {
+  OPTIMIZER_SGD,      /**< Plain stochastic gradient descent. */
+  OPTIMIZER_MOMENTUM, /**< SGD with heavy-ball momentum. */
+  OPTIMIZER_ADAM,     /**< Adam with bias-corrected moment estimates. */
+  OPTIMIZER_RMSPROP,  /**< RMSProp with a running average of squared grads. */
+} OptimizerType;
+
+/**
+ * @brief Optimizer hyperparameters and per-parameter state.
+ *
+ * Hyperparameters may be adjusted between steps. State buffers hold one entry
+ * per network parameter; layer i's weights start at `offsets[i]`, followed
+ * immediately by its bias. The batch normalization scale and shift of layer i,
+ * if any, start at `bn_offsets[i]`, after all `num_parameters` entries.
+ */
+typedef struct {
+  OptimizerType type;   /**< Update rule. */
+  double learning_rate; /**< Step size. */
+  double momentum;      /**< Velocity decay (MOMENTUM). */
+  double beta1;         /**< First moment decay (ADAM). */
+  double beta2;         /**< Second moment decay (ADAM). */
+  double rho;           /**< Squared gradient decay (RMSPROP). */
+  double epsilon;       /**< Denominator guard (ADAM, RMSPROP). */
+  size_t step;          /**< Number of steps started so far. */
+
+  size_t num_layers;     /**< Number of layers the state covers. */
+  size_t num_parameters; /**< Total weights and biases. */
+  size_t* offsets;       /**< Per layer start of its state (length
+                            num_layers + 1). */
+  size_t* bn_offsets;    /**< Per layer start of its batch normalization
+                            state (length num_layers + 1). */
+  double* state1; /**< Velocity, first moment or squared average. */
+  double* state2; /**< Second moment (ADAM only, otherwise NULL). */
+} Optimizer;
+
+/**
+ * @brief Plain SGD step in place: W -= lr * dW and b -= lr * db.
+ * @param layer Layer whose parameters are updated.
+ * @param dW Weight gradient, same shape as `layer->weights`.
+ * @param db Bias gradient, same shape as `layer->bias`.
+ * @param learning_rate Step size.
+ */
+void sgd_update(Layer* layer, const Matrix* dW, const Matrix* db,
+                double learning_rate);
+
+/**
+ * @brief Create an optimizer with default hyperparameters for `nn`.
+ *
+ * Defaults: momentum 0.9, beta1 0.9, beta2 0.999, rho 0.9, epsilon 1e-8.
+ * State buffers are sized from the network's current layer shapes and zeroed.
+ * @return A new optimizer, or NULL on allocation failure.
+ */
+Optimizer* create_optimizer(OptimizerType type, const NeuralNetwork* nn,
+                            double learning_rate);
+
+/** @brief Start a new step; call once before updating the layers. */
+void optimizer_begin_step(Optimizer* opt);
+
+/**
+ * @brief Update one layer's parameters and state in a single fused pass.
+ * @param opt Optimizer (a step must have been started).
+ * @param layer_index Index of `layer` in the network.
+ * @param layer Layer to update in place.
+ * @param dW Weight gradient, same shape as `layer->weights`.
+ * @param db Bias gradient, same shape as `layer->bias`.
+ */
+void optimizer_update_layer(Optimizer* opt, size_t layer_index, Layer* layer,
+                            const Matrix* dW, const Matrix* db);
+
+/**
+ * @brief `LayerGradientCallback` adapter around `optimizer_update_layer`.
+ *
+ * Pass it to `backpropagate_gradients` with the Optimizer as `user_data`
+ * (after `optimizer_begin_step`) to update each layer while its gradients are
+ * still in cache.
+ */
+void optimizer_layer_callback(size_t layer_index, Layer* layer,
+                              const Matrix* dW, const Matrix* db,
+                              void* user_data);
+
+/**
+ * @brief Begin a step and update every layer of `nn`.
+ * @param dW Array of per-layer weight gradients (length nn->num_layers).
+ * @param db Array of per-layer bias gradients (length nn->num_layers).
+ */
+void optimizer_step(Optimizer* opt, NeuralNetwork* nn, Matrix* const* dW,
+                    Matrix* const* db);
+
+/**
+ * @brief Begin a step and apply `grads` to every layer of `nn`.
+ *
+ * When `nn` was built with `create_contiguous_network`, the parameters,
+ * gradients and optimizer state share one layout, so the whole model is
+ * updated by a single kernel call over three flat buffers.
+ */
+void optimizer_apply_gradients(Optimizer* opt, NeuralNetwork* nn,
+                               const NetworkGradients* grads);
+
+/** @brief Free the optimizer and its state. */
+void free_optimizer(Optimizer* opt);
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+
+/**
+ * @file parallel_training.h
+ * @brief Multi-threaded training modes.
+ *
+ * The data-parallel trainer splits every mini-batch across a fixed pool of
+ * worker threads. Each worker runs the forward and backward pass for its
+ * shard on a private replica of the network (shared layers, private cache)
+ * into its own gradient buffer. The buffers are then summed in parallel, each
+ * worker reducing one contiguous slice of the parameter range across all
+ * replicas, and a single optimizer update is applied. Because gradients are
+ * sums over rows, the result equals a single-threaded step on the whole batch
+ * up to floating-point summation order.
+ *
+ * Hogwild training drops all synchronization between workers: each worker
+ * pulls the next mini-batch, computes its gradients on a private replica and
+ * applies an SGD update straight to the shared layer weights while other
+ * workers may be reading or writing them. Updates can be lost or computed
+ * from stale weights; in exchange throughput scales with cores, and when
+ * gradients are sparse (e.g. one-hot tabular inputs) workers rarely touch the
+ * same weights.
+ *
+ * The pipeline trainer assigns contiguous ranges of layers to stage threads
+ * and streams micro-batches through them with a one-forward-one-backward
+ * (1F1B) schedule, so stage s works on micro-batch k while stage s + 1 works
+ * on micro-batch k - 1. It pays off when individual layer GEMMs are too small
+ * to parallelize internally. Gradients are accumulated over micro-batches and
+ * applied once per step, so a step matches a single-threaded step on the
+ * whole batch.
+ */
+
+/** @brief Opaque data-parallel trainer; implementation hidden. */
+typedef struct DataParallelTrainer DataParallelTrainer;
+
+/**
+ * @brief Start `num_workers` training threads for `nn`.
+ * @param nn Network to train (non-NULL). Must outlive the trainer.
+ * @param num_workers Number of worker threads (at least 1).
+ * @param loss_type Loss type passed to `backpropagate`.
+ * @param loss_func Loss used for the returned value; may be NULL.
+ * @param loss_func_grad Gradient of the loss (required).
+ * @return A new trainer, or NULL on allocation or thread creation failure.
+ */
+DataParallelTrainer* create_data_parallel_trainer(
+    NeuralNetwork* nn, size_t num_workers, LossFunctionType loss_type,
+    LossFunction loss_func, LossFunctionGrad loss_func_grad);
+
+/**
+ * @brief Run one data-parallel training step on a mini-batch.
+ * @param trainer Trainer (non-NULL).
+ * @param opt Optimizer created for the trainer's network.
+ * @param x Mini-batch inputs (batch_size x input_features).
+ * @param y Mini-batch targets (batch_size x output_features).
+ * @return Loss of the batch before the update, or 0 if no loss was given.
+ */
+double data_parallel_step(DataParallelTrainer* trainer, Optimizer* opt,
+                          const Matrix* x, const Matrix* y);
+
+/** @brief Stop the worker threads and free the trainer. */
+void free_data_parallel_trainer(DataParallelTrainer* trainer);
+
+/**
+ * @brief Train `nn` with lock-free asynchronous SGD (Hogwild).
+ *
+ * Mini-batches are consecutive row ranges of `x`/`y`; workers claim them from
+ * a shared atomic counter until `epochs` passes have been handed out. Zero
+ * gradient entries are skipped so sparse updates do not write shared cache
+ * lines. The network must not be used by other threads during training.
+ * @param nn Network to train (non-NULL).
+ * @param x Training inputs (samples x input_features).
+ * @param y Training targets (samples x output_features).
+ * @param batch_size Rows per mini-batch (at least 1).
+ * @param epochs Number of passes over the data.
+ * @param learning_rate SGD step size.
+ * @param num_workers Number of worker threads (at least 1).
+ * @param loss_type Loss type passed to `backpropagate`.
+ * @param loss_func_grad Gradient of the loss (required).
+ * @return Number of updates applied, or -1 if allocation failed or a worker
+ *         could not start. In the latter case the workers that did start
+ *         may already have updated `nn`, so its weights are partially
+ *         trained.
+ */
+long hogwild_train(NeuralNetwork* nn, const Matrix* x, const Matrix* y,
+                   size_t batch_size, size_t epochs, double learning_rate,
+                   size_t num_workers, LossFunctionType loss_type,
+                   LossFunctionGrad loss_func_grad);
+
+/** @brief Opaque pipeline-parallel trainer; implementation hidden. */
+typedef struct PipelineTrainer PipelineTrainer;
+
+/**
+ * @brief Split `nn` into `num_stages` stages and start one thread per stage.
+ *
+ * Layers are assigned to stages in order, balancing weight counts. Stages
+ * never exceed the number of layers.
+ * @param nn Network to train (non-NULL). Must outlive the trainer.
+ * @param num_stages Number of stage threads (at least 1).
+ * @param num_micro_batches Micro-batches each mini-batch is split into.
+ * @param loss_type Loss type; SOFTMAX output with CCE skips the softmax and
+ *        uses the fused `softmax_cross_entropy` on the logits.
+ * @param loss_func Loss used for the returned value; may be NULL. With the
+ *        fused path the kernel's cross-entropy is reported.
+ * @param loss_func_grad Gradient of the loss (required).
+ * @return A new trainer, or NULL on allocation or thread creation failure.
+ */
+PipelineTrainer* create_pipeline_trainer(NeuralNetwork* nn, size_t num_stages,
+                                         size_t num_micro_batches,
+                                         LossFunctionType loss_type,
+                                         LossFunction loss_func,
+                                         LossFunctionGrad loss_func_grad);
+
+/**
+ * @brief Run one pipelined training step on a mini-batch.
+ * @return Loss of the batch before the update, or 0 if no loss was given.
+ */
+double pipeline_step(PipelineTrainer* trainer, Optimizer* opt, const Matrix* x,
+                     const Matrix* y);
+
+/** @brief Stop the stage threads and free the trainer. */
+void free_pipeline_trainer(PipelineTrainer* trainer);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file pool.h
+ * @brief 2D max-pool layers with cached argmax indices.
+ *
+ * A max-pool layer is a `Layer` with a `pool` geometry, no parameters and an
+ * IDENTITY activation. Rows are channels-last (NHWC), like convolutions.
+ * `feedforward` records, for every output value, which tap of its window won
+ * as one byte (kh * window + kw) in a raw cache buffer ("argmax_i"); the
+ * backward pass scatters each delta to that tap without reading the input
+ * again or recomputing the maximum.
+ */
+
+/** @brief Largest window side whose taps fit the one-byte argmax. */
+#define MAX_POOL_MAX_WINDOW 16
+
+/**
+ * @brief Create a max-pool layer.
+ * @param in_height Input height.
+ * @param in_width Input width.
+ * @param channels Input (and output) channels.
+ * @param window Square window side (1 to MAX_POOL_MAX_WINDOW, at most the
+ *        input size).
+ * @param stride Step between windows (at least 1).
+ * @return A new layer, or NULL on allocation failure.
+ */
+Layer* create_max_pool_layer(size_t in_height, size_t in_width,
+                             size_t channels, size_t window, size_t stride);
+
+/**
+ * @brief Max-pool a batch.
+ * @param pool Pool geometry.
+ * @param input Batch (N x in_height·in_width·channels).
+ * @param argmax Receives N·out_height·out_width·channels winning taps, or
+ *        NULL if not needed.
+ * @return A new N x (out_height·out_width·channels) matrix.
+ */
+Matrix* max_pool_forward(const Pool2D* pool, const Matrix* input,
+                         uint8_t* argmax);
+
+/**
+ * @brief Route each output delta to its window's winning tap, summing where
+ *        windows overlap.
+ * @param pool Pool geometry.
+ * @param delta dL/d(output) (N x out_height·out_width·channels).
+ * @param argmax Winning taps recorded by `max_pool_forward`.
+ * @param delta_input Receives dL/d(input) (N x in_height·in_width·channels).
+ */
+void max_pool_backward(const Pool2D* pool, const Matrix* delta,
+                       const uint8_t* argmax, Matrix* delta_input);
+
+/**
+ * @brief `max_pool_forward` for layer `layer_index`, keeping the argmax in
+ *        the network cache for `max_pool_input_gradient`.
+ */
+Matrix* max_pool_forward_cached(const NeuralNetwork* nn, size_t layer_index,
+                                const Matrix* input);
+
+/**
+ * @brief `max_pool_backward` for layer `layer_index` using the argmax cached
+ *        by the last `feedforward`.
+ */
+void max_pool_input_gradient(const NeuralNetwork* nn, size_t layer_index,
+                             const Matrix* delta, Matrix* delta_input);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "activation.h"
+#include "linalg.h"
+#include "neural_network.h"
+
+/**
+ * @file quantize.h
+ * @brief Post-training int8 quantization and quantized inference.
+ *
+ * Weights are quantized symmetrically per output channel; activations are
+ * quantized symmetrically per layer with scales calibrated on sample data.
+ * Products are accumulated in int32 and requantized in the same pass that adds
+ * the bias and applies the activation, so intermediate layers never
+ * materialize a double matrix.
+ */
+
+/** @brief Largest magnitude used for symmetric int8 values. */
+#define QUANT_INT8_MAX 127
+
+/**
+ * @brief Fully connected layer with int8 weights.
+ */
+typedef struct {
+  int8_t* weights; /**< Weights transposed to D_out×D_in, one row per output
+                      channel. */
+  double* weight_scales; /**< Per output channel scale (length D_out). */
+  double* bias;          /**< Bias in real units (length D_out). */
+  double input_scale;    /**< Scale of this layer's int8 input. */
+  size_t input_size;     /**< D_in. */
+  size_t output_size;    /**< D_out. */
+
+  activation_function activation_type; /**< Activation of the layer. */
+  double leak_parameter;               /**< Leak for Leaky ReLU. */
+} QuantizedLayer;
+
+/**
+ * @brief Network of int8 layers produced by `quantize_network`.
+ */
+typedef struct {
+  QuantizedLayer* layers; /**< Array of layers (length = num_layers). */
+  size_t num_layers;      /**< Number of layers. */
+} QuantizedNetwork;
+
+/**
+ * @brief Calibrate activation ranges on `calibration_data` and quantize `nn`.
+ * @param nn Trained network (non-NULL). Only its last layer may use SOFTMAX.
+ * @param calibration_data Representative inputs (samples x input_features).
+ * @return A new quantized network, or NULL on allocation failure.
+ */
+QuantizedNetwork* quantize_network(const NeuralNetwork* nn,
+                                   const Matrix* calibration_data);
+
+/**
+ * @brief Run inference with int8 weights and activations.
+ * @param qnn Quantized network (non-NULL).
+ * @param input Input matrix (batch_size x input_features).
+ * @return Output of the last layer in real units. Caller owns and must free.
+ */
+Matrix* quantized_predict(const QuantizedNetwork* qnn, const Matrix* input);
+
+/** @brief Free a quantized network. */
+void free_quantized_network(QuantizedNetwork* qnn);
+
+/**
+ * @brief int8 GEMM with int32 accumulation: c = a · b_t^T.
+ * @param a Row-major m×k matrix.
+ * @param b_t Row-major n×k matrix (the transposed right-hand side).
+ * @param c Row-major m×n output.
+ */
+void gemm_int8(const int8_t* a, const int8_t* b_t, int32_t* c, size_t m,
+               size_t n, size_t k);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file rng.h
+ * @brief Counter-based random numbers (Philox4x32-10).
+ *
+ * Philox maps a 128-bit counter and a 64-bit key (the seed) to 128 random
+ * bits with no hidden state, so the value at position `offset` of the stream
+ * for `seed` can be computed on its own. Bulk fills split the range across
+ * OpenMP threads and still produce exactly the same numbers as a serial fill,
+ * whatever the thread count.
+ *
+ * Code that has no seed of its own (weight initialization through
+ * `randomize_matrix`) draws from a global stream: `rng_reserve` hands out
+ * disjoint offset ranges of the global seed, so runs are reproducible given
+ * the seed and the order of the calls.
+ */
+
+/** @brief Seed of the global stream until `rng_set_seed` is called. */
+#define RNG_DEFAULT_SEED 0x5EEDULL
+
+/**
+ * @brief One Philox4x32-10 block.
+ * @param counter 128-bit counter as four 32-bit words.
+ * @param key 64-bit key as two 32-bit words.
+ * @param out Receives four random 32-bit words.
+ */
+void philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                uint32_t out[4]);
+
+/** @brief Random 64-bit value at `offset` of the stream for `seed`. */
+uint64_t rng_u64(uint64_t seed, uint64_t offset);
+
+/** @brief Uniform double in [0, 1) at `offset` of the stream for `seed`. */
+double rng_uniform(uint64_t seed, uint64_t offset);
+
+/**
+ * @brief Fill `out[i]` with uniform values in [low, high) taken from offsets
+ * offset + i of the stream for `seed`.
+ */
+void rng_fill_uniform(uint64_t seed, uint64_t offset, double* out, size_t n,
+                      double low, double high);
+
+/**
+ * @brief Fill `out[i]` with normal values (Box-Muller) taken from offsets
+ * offset + 2i and offset + 2i + 1 of the stream for `seed`. A fill of n values
+ * reads 2n offsets; reserve that many.
+ */
+void rng_fill_normal(uint64_t seed, uint64_t offset, double* out, size_t n,
+                     double mean, double stddev);
+
+/**
+ * @brief Fill a packed bit mask: bit i of `mask[i / 64]` is set with
+ * probability `keep_prob`.
+ *
+ * Element i compares 32-bit word i % 4 of block `block_offset + i / 4` with a
+ * threshold, so a block decides four bits and a 64-bit mask word costs 16
+ * blocks. Words are generated in parallel. Bits past n in the last word are
+ * cleared. Block b covers stream offsets 2b and 2b + 1.
+ * @param seed Stream seed.
+ * @param block_offset First Philox block to use.
+ * @param keep_prob Probability of a set bit, in [0, 1].
+ * @param mask Receives (n + 63) / 64 words.
+ * @param n Number of bits.
+ */
+void rng_fill_keep_mask(uint64_t seed, uint64_t block_offset, double keep_prob,
+                        uint64_t* mask, size_t n);
+
+/**
+ * @brief Write a uniformly random permutation of 0..n-1 to `indices`
+ * (Fisher-Yates), drawing from offsets offset .. offset + n - 2 of the
+ * stream for `seed`. Used as an epoch sampler: epoch e with offset e * n
+ * gets its own permutation, independent of earlier epochs.
+ */
+void rng_permutation(uint64_t seed, uint64_t offset, size_t* indices,
+                     size_t n);
+
+/** @brief Restart the global stream with a new seed. */
+void rng_set_seed(uint64_t seed);
+
+/** @brief Seed of the global stream. */
+uint64_t rng_seed(void);
+
+/**
+ * @brief Reserve `n` consecutive offsets of the global stream.
+ * The range is rounded up to whole blocks and starts on a block boundary, so
+ * two reservations never read the same Philox block. Thread-safe.
+ * @return The first reserved offset (always even).
+ */
+uint64_t rng_reserve(size_t n);
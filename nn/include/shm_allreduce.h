@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "backprop.h"
+#include "neural_network.h"
+
+/**
+ * @file shm_allreduce.h
+ * @brief Collective operations between processes on one host over POSIX
+ * shared memory.
+ *
+ * Every rank of a job opens the same named segment with `shm_comm_open`. The
+ * segment holds one buffer slot per rank and a process-shared barrier.
+ * `shm_allreduce_sum` runs a ring allreduce over the slots: a reduce-scatter
+ * of world_size - 1 steps in which each rank adds the chunk its left
+ * neighbour just reduced, then an allgather of world_size - 1 steps that
+ * passes the fully reduced chunks around the ring. Each step moves only
+ * count / world_size values per rank, which is the same communication
+ * pattern a multi-node transport would use.
+ *
+ * For data-parallel training every rank keeps a full copy of the network,
+ * calls `shm_sync_network` once so all ranks start from rank 0's weights, and
+ * then per step computes gradients on its own shard, sums them with
+ * `shm_allreduce_gradients` and applies the same optimizer update, which
+ * keeps the weights identical across ranks.
+ */
+
+/** @brief Opaque communicator type; implementation hidden. */
+typedef struct ShmCommunicator ShmCommunicator;
+
+/**
+ * @brief Join (rank 0: create) the shared-memory group `name`.
+ *
+ * Rank 0 creates the segment and fails if it already exists, so each job
+ * needs a unique name. Other ranks wait up to a few seconds for it to appear.
+ * @param name POSIX shared-memory name, starting with '/'.
+ * @param rank This process's rank in [0, world_size).
+ * @param world_size Number of processes in the group (at least 1).
+ * @param count Number of doubles exchanged per collective.
+ * @return A new communicator, or NULL on failure.
+ */
+ShmCommunicator* shm_comm_open(const char* name, size_t rank,
+                               size_t world_size, size_t count);
+
+/**
+ * @brief Replace `data` (length `count`) on every rank with the elementwise
+ * sum over all ranks. Must be called by every rank.
+ */
+void shm_allreduce_sum(ShmCommunicator* comm, double* data);
+
+/**
+ * @brief Copy `data` (length `count`) from rank `root` to every rank. Must be
+ * called by every rank.
+ */
+void shm_broadcast(ShmCommunicator* comm, double* data, size_t root);
+
+/**
+ * @brief Overwrite every rank's weights and biases with rank 0's.
+ * The communicator's count must equal the network's parameter count, and the
+ * network must be dense (`network_is_dense`): batch normalization state is
+ * not synchronized.
+ */
+void shm_sync_network(ShmCommunicator* comm, NeuralNetwork* nn);
+
+/**
+ * @brief Sum gradients over all ranks in place.
+ * The communicator's count must equal `grads->size`, and the gradients must
+ * not cover batch normalization.
+ */
+void shm_allreduce_gradients(ShmCommunicator* comm, NetworkGradients* grads);
+
+/**
+ * @brief Leave the group. Waits for every rank; rank 0 removes the segment.
+ */
+void shm_comm_close(ShmCommunicator* comm);
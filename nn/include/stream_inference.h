@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "neural_network.h"
+
+/**
+ * @file stream_inference.h
+ * @brief Chunked, pipelined scoring of inputs too large to load at once.
+ *
+ * Rows are read from a text stream (one sample per line, values separated by
+ * commas and/or whitespace), scored in fixed-size chunks and written out as
+ * they complete. Reading, the forward pass and writing run on separate
+ * threads over a small ring of reusable chunk buffers, so memory use depends
+ * only on the chunk size and never on the size of the dataset.
+ */
+
+/** @brief Number of chunk buffers cycling through the pipeline. */
+#define STREAM_PIPELINE_DEPTH 3
+
+/**
+ * @brief Score every row of `input` with `nn` and write one prediction per
+ * line to `output` (comma separated, in input order).
+ * @param nn Network pointer (non-NULL). Only the cache-free path is used.
+ * @param input Stream of samples with `input_features` values per line.
+ * @param output Destination stream for predictions.
+ * @param chunk_rows Maximum number of rows per forward pass (at least 1).
+ * @return Number of rows scored, or -1 on a parse or write error.
+ */
+long stream_predict(const NeuralNetwork* nn, FILE* input, FILE* output,
+                    size_t chunk_rows);
+
+/**
+ * @brief Convenience wrapper around `stream_predict` that opens both files.
+ * @return Number of rows scored, or -1 on error.
+ */
+long stream_predict_file(const NeuralNetwork* nn, const char* input_path,
+                         const char* output_path, size_t chunk_rows);
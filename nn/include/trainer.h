@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+
+/**
+ * @file trainer.h
+ * @brief Epoch/mini-batch training loop with a prefetching data loader.
+ *
+ * A trainer binds a network, an optimizer and a dataset. A background loader
+ * thread assembles mini-batches into two alternating buffers: while the
+ * calling thread trains on batch k from one buffer, the loader gathers
+ * (optionally shuffled) rows for batch k + 1 into the other and runs the
+ * user's transform on them. The loader keeps running across epoch
+ * boundaries, so the first batch of the next epoch is ready as soon as the
+ * last batch of the current one is done.
+ */
+
+/**
+ * @brief Converts or normalizes a freshly gathered batch in place. Runs on the
+ * loader thread, so it must not touch the network.
+ * @param x Batch inputs (rows x input_features).
+ * @param y Batch targets (rows x output_features).
+ * @param user_data The trainer config's `transform_data`.
+ */
+typedef void (*BatchTransform)(Matrix* x, Matrix* y, void* user_data);
+
+/** @brief Training loop settings. */
+typedef struct {
+  size_t batch_size;               /**< Rows per mini-batch (at least 1). */
+  int shuffle;                     /**< Reshuffle rows every epoch if set. */
+  uint64_t seed;                   /**< Seed of the shuffle (see rng.h). */
+  LossFunctionType loss_type;      /**< Loss type for backpropagation. */
+  LossFunction loss_func;          /**< Loss for the epoch mean; may be NULL.
+                                        With CCE on a SOFTMAX output the fused
+                                        kernel's cross-entropy is used. */
+  LossFunctionGrad loss_func_grad; /**< Gradient of the loss (required). */
+  BatchTransform transform;        /**< Per-batch transform; may be NULL. */
+  void* transform_data;            /**< Passed to `transform`. */
+} TrainerConfig;
+
+/** @brief Opaque trainer; implementation hidden. */
+typedef struct Trainer Trainer;
+
+/**
+ * @brief Create a trainer and start its loader thread.
+ * @param nn Network to train (non-NULL). Must outlive the trainer.
+ * @param opt Optimizer created for `nn`. Must outlive the trainer.
+ * @param x Training inputs (samples x input_features). Must outlive the
+ *        trainer and stay unchanged while it runs.
+ * @param y Training targets (samples x output_features). Same lifetime as x.
+ * @param config Loop settings; copied.
+ * @return A new trainer, or NULL on allocation or thread creation failure.
+ */
+Trainer* create_trainer(NeuralNetwork* nn, Optimizer* opt, const Matrix* x,
+                        const Matrix* y, const TrainerConfig* config);
+
+/**
+ * @brief Train for one pass over the dataset. The network is in training
+ * mode (dropout enabled) for the duration of the call.
+ * @param trainer Trainer (non-NULL).
+ * @return Mean per-row loss of the epoch's batches before their updates, or 0
+ *         if no loss function was given.
+ */
+double trainer_run_epoch(Trainer* trainer);
+
+/** @brief Stop the loader thread and free the trainer. */
+void free_trainer(Trainer* trainer);
@@ -429,6 +429,68 @@ Matrix* softmax_prime(Matrix* m) {
   return result;
 }
 
+//============================
+// Scalar Activations
+//============================
+
+/**
+ * @brief Applies an elementwise activation to one value.
+ * @param func The activation function.
+ * @param x The pre-activation value.
+ * @param leak_parameter The leak parameter for the Leaky ReLU.
+ * @return The activation of x; SOFTMAX and IDENTITY return x.
+ */
+double activate_scalar(activation_function func, double x,
+                       double leak_parameter) {
+  switch (func) {
+    case SIGMOID:
+      return 1.0 / (1.0 + exp(-x));
+    case RELU:
+      return x > 0.0 ? x : 0.0;
+    case TANH:
+      return tanh(x);
+    case LEAKY_RELU:
+      return x > 0.0 ? x : leak_parameter * x;
+    case SIGN:
+      return (x > 0.0) - (x < 0.0);
+    case HARD_TANH:
+      return x > 1.0 ? 1.0 : (x < -1.0 ? -1.0 : x);
+    default:
+      return x;
+  }
+}
+
+/**
+ * @brief Computes the derivative of an elementwise activation at one value.
+ * @param func The activation function.
+ * @param z The pre-activation value.
+ * @param leak_parameter The leak parameter for the Leaky ReLU.
+ * @return The derivative at z; SOFTMAX and IDENTITY return 1.
+ */
+double activation_prime_scalar(activation_function func, double z,
+                               double leak_parameter) {
+  switch (func) {
+    case SIGMOID: {
+      double s = 1.0 / (1.0 + exp(-z));
+      return s * (1.0 - s);
+    }
+    case RELU:
+      return z > 0.0 ? 1.0 : 0.0;
+    case TANH: {
+      double t = tanh(z);
+      return 1.0 - t * t;
+    }
+    case LEAKY_RELU:
+      return z > 0.0 ? 1.0 : leak_parameter;
+    case SIGN:
+      return 0.0;
+    case HARD_TANH:
+      return (z > -1.0 && z < 1.0) ? 1.0 : 0.0;
+    default:
+      return 1.0;
+  }
+}
+
 const char* activation_to_string(activation_function func) {
   switch (func) {
     case SIGMOID:
@@ -439,6 +501,14 @@ const char* activation_to_string(activation_function func) {
       return "LEAKY_RELU";
     case SOFTMAX:
       return "SOFTMAX";
+    case TANH:
+      return "TANH";
+    case SIGN:
+      return "SIGN";
+    case IDENTITY:
+      return "IDENTITY";
+    case HARD_TANH:
+      return "HARD_TANH";
     default:
       return "UNKNOWN";
   }
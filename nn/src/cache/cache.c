@@ -16,8 +16,10 @@
  * Uses a linked list for collision resolution in the hash map.
  */
 typedef struct CacheEntry {
-  char* key; /**< The key associated with the matrix. */
-  Matrix* m; /**< The matrix stored in this entry. */
+  char* key;           /**< The key associated with the matrix. */
+  Matrix* m;           /**< The matrix stored in this entry, or NULL. */
+  void* buffer;        /**< Raw buffer stored in this entry, or NULL. */
+  size_t buffer_bytes; /**< Capacity of `buffer`. */
   struct CacheEntry*
       next; /**< Pointer to the next entry in case of collision. */
 } CacheEntry;
@@ -49,6 +51,36 @@ static unsigned int hash(const char* key) {
   return (unsigned int)(hash % HASH_MAP_SIZE);
 }
 
+/**
+ * @brief Finds the entry stored under a key.
+ * @param cache A pointer to the Cache structure.
+ * @param key The string key to look up.
+ * @return The entry, or NULL if the key is not found.
+ */
+static CacheEntry* find_entry(const Cache* cache, const char* key) {
+  CacheEntry* current = cache->entries[hash(key)];
+  while (current != NULL) {
+    if (strcmp(current->key, key) == 0) {
+      return current;
+    }
+    current = current->next;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Frees an entry's key, matrix and buffer, and the entry itself.
+ * @param entry The entry to free.
+ */
+static void free_entry(CacheEntry* entry) {
+  free(entry->key);
+  if (entry->m != NULL) {
+    free_matrix(entry->m);
+  }
+  free(entry->buffer);
+  free(entry);
+}
+
 //------------------------------
 // Cache Functions
 //------------------------------
@@ -88,8 +120,13 @@ void cache_put(Cache* cache, const char* key, Matrix* m) {
   CacheEntry* current = cache->entries[index];
   while (current != NULL) {
     if (strcmp(current->key, key) == 0) {
-      // Key found, free existing matrix and update with new one.
-      free_matrix(current->m);
+      // Key found, free existing contents and update with the new matrix.
+      if (current->m != NULL) {
+        free_matrix(current->m);
+      }
+      free(current->buffer);
+      current->buffer = NULL;
+      current->buffer_bytes = 0;
       current->m = m;
       return;
     }
@@ -102,6 +139,8 @@ void cache_put(Cache* cache, const char* key, Matrix* m) {
   }
   new_entry->key = strdup(key);
   new_entry->m = m;
+  new_entry->buffer = NULL;
+  new_entry->buffer_bytes = 0;
   new_entry->next = cache->entries[index];
   cache->entries[index] = new_entry;
 }
@@ -121,13 +160,120 @@ Matrix* cache_get(Cache* cache, const char* key) {
   CacheEntry* current = cache->entries[index];
   while (current != NULL) {
     if (strcmp(current->key, key) == 0) {
-      return copy_matrix(current->m);
+      return current->m != NULL ? copy_matrix(current->m) : NULL;
+    }
+    current = current->next;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Looks up a matrix in the cache without copying it.
+ * @param cache A pointer to the Cache structure.
+ * @param key The string key of the matrix to look up.
+ * @return The stored Matrix, or NULL if the key is not found. The matrix stays
+ * owned by the cache and is only valid until its entry is overwritten or the
+ * cache is cleared.
+ */
+const Matrix* cache_peek(const Cache* cache, const char* key) {
+  if (cache == NULL || key == NULL) {
+    return NULL;
+  }
+  unsigned int index = hash(key);
+  const CacheEntry* current = cache->entries[index];
+  while (current != NULL) {
+    if (strcmp(current->key, key) == 0) {
+      return current->m;
     }
     current = current->next;
   }
   return NULL;
 }
 
+/**
+ * @brief Returns a writable raw buffer of at least `bytes` bytes stored under
+ * a key. An existing buffer entry that is large enough is reused, so per-step
+ * scratch such as dropout masks is allocated only once. Any matrix stored
+ * under the key is replaced.
+ * @param cache A pointer to the Cache structure.
+ * @param key The string key for the buffer.
+ * @param bytes The required size in bytes.
+ * @return The buffer (contents unspecified), owned by the cache, or NULL if
+ * allocation fails.
+ */
+void* cache_reserve_buffer(Cache* cache, const char* key, size_t bytes) {
+  if (cache == NULL || key == NULL) {
+    return NULL;
+  }
+
+  CacheEntry* entry = find_entry(cache, key);
+  if (entry == NULL) {
+    entry = (CacheEntry*)calloc(1, sizeof(CacheEntry));
+    if (entry == NULL) {
+      return NULL;
+    }
+    entry->key = strdup(key);
+    if (entry->key == NULL) {
+      free(entry);
+      return NULL;
+    }
+    unsigned int index = hash(key);
+    entry->next = cache->entries[index];
+    cache->entries[index] = entry;
+  }
+  if (entry->m != NULL) {
+    free_matrix(entry->m);
+    entry->m = NULL;
+  }
+  if (entry->buffer_bytes < bytes || entry->buffer == NULL) {
+    void* buffer = malloc(bytes > 0 ? bytes : 1);
+    if (buffer == NULL) {
+      return NULL;
+    }
+    free(entry->buffer);
+    entry->buffer = buffer;
+    entry->buffer_bytes = bytes;
+  }
+  return entry->buffer;
+}
+
+/**
+ * @brief Looks up a raw buffer stored with cache_reserve_buffer.
+ * @param cache A pointer to the Cache structure.
+ * @param key The string key of the buffer.
+ * @return The buffer, or NULL if the key is not found or holds a matrix.
+ */
+const void* cache_peek_buffer(const Cache* cache, const char* key) {
+  if (cache == NULL || key == NULL) {
+    return NULL;
+  }
+  const CacheEntry* entry = find_entry(cache, key);
+  return entry != NULL ? entry->buffer : NULL;
+}
+
+/**
+ * @brief Removes the entry stored under a key and frees its matrix. Does
+ * nothing if the key is not found.
+ * @param cache A pointer to the Cache structure.
+ * @param key The string key of the entry to remove.
+ */
+void cache_remove(Cache* cache, const char* key) {
+  if (cache == NULL || key == NULL) {
+    return;
+  }
+  unsigned int index = hash(key);
+  CacheEntry** link = &cache->entries[index];
+  while (*link != NULL) {
+    CacheEntry* current = *link;
+    if (strcmp(current->key, key) == 0) {
+      *link = current->next;
+      free_entry(current);
+      return;
+    }
+    link = &current->next;
+  }
+}
+
 /**
  * @brief Clears all entries from the cache, freeing associated memory for keys
  * and matrices. The cache structure itself is not freed.
@@ -142,9 +288,7 @@ void clear_cache(Cache* cache) {
     while (current != NULL) {
       CacheEntry* to_free = current;
       current = current->next;
-      free(to_free->key);
-      free_matrix(to_free->m);
-      free(to_free);
+      free_entry(to_free);
     }
     cache->entries[i] = NULL;
   }
@@ -12,13 +12,30 @@
 #include <time.h>
 
 #include "activation.h"
-#include "backprop.h"
 #include "feedforward.h"
+#include "init.h"
 #include "linalg.h"
 #include "loss.h"
 #include "neural_network.h"
+#include "optimizer.h"
+#include "rng.h"
+#include "trainer.h"
 #include "utils.h"
 
+/**
+ * @brief Batch transform that scales pixel values from [0, 255] to [0, 1].
+ * @param x The batch images.
+ * @param y The batch labels (unused).
+ * @param user_data Unused.
+ */
+static void normalize_pixels(Matrix* x, Matrix* y, void* user_data) {
+  (void)y;
+  (void)user_data;
+  for (size_t i = 0; i < x->rows * x->cols; i++) {
+    x->matrix_data[i] /= 255.0;
+  }
+}
+
 /**
  * @brief Helper function to write a matrix to a file in a human-readable
  * format.
@@ -82,7 +99,7 @@ Matrix* read_csv(const char* filename, size_t rows, size_t cols) {
  * @return 0 on successful execution, 1 on error.
  */
 int main() {
-  srand(time(NULL));
+  rng_set_seed((uint64_t)time(NULL));
 
   NeuralNetwork* nn;
 
@@ -147,10 +164,7 @@ int main() {
            &test_data->matrix_data[i * 785 + 1], 784 * sizeof(double));
   }
 
-  // Normalize image data
-  for (size_t i = 0; i < train_images->rows * train_images->cols; i++) {
-    train_images->matrix_data[i] /= 255.0;
-  }
+  // Normalize image data; training batches are normalized by the loader.
   for (size_t i = 0; i < test_images->rows * test_images->cols; i++) {
     test_images->matrix_data[i] /= 255.0;
   }
@@ -172,12 +186,13 @@ int main() {
   nn = create_network(num_layers);
 
   for (size_t i = 0; i < num_layers; i++) {
-    nn->layers[i] = (Layer*)malloc(sizeof(Layer));
+    nn->layers[i] = (Layer*)calloc(1, sizeof(Layer));
     nn->layers[i]->weights =
         create_matrix(layers_sizes[i], layers_sizes[i + 1]);
     nn->layers[i]->bias = create_matrix(1, layers_sizes[i + 1]);
-    randomize_matrix(nn->layers[i]->weights, 0.1);
-    fill_matrix(nn->layers[i]->bias, 0.0);
+    // He init for the ReLU layers, Xavier for the softmax output.
+    initialize_layer(nn->layers[i], (i == num_layers - 1) ? INIT_XAVIER_UNIFORM
+                                                          : INIT_HE_UNIFORM);
     nn->layers[i]->activation_type = (i == num_layers - 1) ? SOFTMAX : RELU;
   }
 
@@ -186,61 +201,29 @@ int main() {
   int epochs = 10;
   int batch_size = 32;
 
-  // Training loop
+  // Training loop; batches are gathered and normalized on a loader thread
+  // while the previous batch trains.
+  Optimizer* opt = create_optimizer(OPTIMIZER_SGD, nn, learning_rate);
+  TrainerConfig config = {(size_t)batch_size,
+                          1,
+                          (unsigned int)time(NULL),
+                          CCE,
+                          categorical_cross_entropy,
+                          categorical_cross_entropy_gradient,
+                          normalize_pixels,
+                          NULL};
+  Trainer* trainer = create_trainer(nn, opt, train_images, train_labels,
+                                    &config);
+  if (trainer == NULL) {
+    LOG_ERROR("Failed to create the trainer.");
+    return 1;
+  }
   for (int epoch = 0; epoch < epochs; epoch++) {
-    double total_loss = 0;
-    for (size_t i = 0; i < train_images->rows; i += batch_size) {
-      // Create mini-batch
-      size_t current_batch_size = (i + batch_size > train_images->rows)
-                                      ? (train_images->rows - i)
-                                      : (size_t)batch_size;
-      Matrix* batch_images = create_matrix(current_batch_size, 784);
-      Matrix* batch_labels = create_matrix(current_batch_size, 10);
-
-      memcpy(batch_images->matrix_data, &train_images->matrix_data[i * 784],
-             current_batch_size * 784 * sizeof(double));
-      memcpy(batch_labels->matrix_data, &train_labels->matrix_data[i * 10],
-             current_batch_size * 10 * sizeof(double));
-
-      // Forward pass
-      Matrix* y_hat = feedforward(nn, batch_images);
-
-      // Calculate loss
-      total_loss += categorical_cross_entropy(y_hat, batch_labels);
-
-      // Backward pass
-      backpropagate(nn, batch_labels, CCE, categorical_cross_entropy_gradient);
-
-      // Update weights and biases
-      for (size_t j = 0; j < nn->num_layers; j++) {
-        Matrix* dW = calculate_weight_gradient(nn->cache, j, nn->num_layers);
-        Matrix* db = calculate_bias_gradient(nn->cache, j, nn->num_layers);
-
-        Matrix* scaled_dW = scale_matrix(learning_rate, dW);
-        Matrix* scaled_db = scale_matrix(learning_rate, db);
-
-        Matrix* new_weights =
-            subtract_matrix(nn->layers[j]->weights, scaled_dW);
-        Matrix* new_bias = subtract_matrix(nn->layers[j]->bias, scaled_db);
-
-        free_matrix(nn->layers[j]->weights);
-        free_matrix(nn->layers[j]->bias);
-        nn->layers[j]->weights = new_weights;
-        nn->layers[j]->bias = new_bias;
-
-        free_matrix(dW);
-        free_matrix(db);
-        free_matrix(scaled_dW);
-        free_matrix(scaled_db);
-      }
-
-      free_matrix(y_hat);
-      free_matrix(batch_images);
-      free_matrix(batch_labels);
-    }
-    fprintf(training_log_file, "Epoch %d, Loss: %f\n", epoch + 1,
-            total_loss / (train_images->rows / batch_size));
+    double loss = trainer_run_epoch(trainer);
+    fprintf(training_log_file, "Epoch %d, Loss: %f\n", epoch + 1, loss);
   }
+  free_trainer(trainer);
+  free_optimizer(opt);
 
   // Evaluate on test set
   Matrix* test_output = feedforward(nn, test_images);
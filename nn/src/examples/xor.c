@@ -14,9 +14,12 @@
 #include "activation.h"
 #include "backprop.h"
 #include "feedforward.h"
+#include "init.h"
 #include "linalg.h"
 #include "loss.h"
 #include "neural_network.h"
+#include "optimizer.h"
+#include "rng.h"
 #include "summary.h"
 #include "utils.h"
 
@@ -27,7 +30,7 @@
  * @return 0 on successful execution, 1 on error.
  */
 int main() {
-  srand(time(NULL));
+  rng_set_seed((uint64_t)time(NULL));
 
   // 1. Define XOR training data
   Matrix* x_train = create_matrix(4, 2);
@@ -57,7 +60,7 @@ int main() {
   }
 
   for (size_t i = 0; i < num_layers; i++) {
-    nn->layers[i] = (Layer*)malloc(sizeof(Layer));
+    nn->layers[i] = (Layer*)calloc(1, sizeof(Layer));
     if (nn->layers[i] == NULL) {
       LOG_ERROR("Failed to allocate memory for layer %zu.", i);
       free_network(nn);
@@ -69,8 +72,9 @@ int main() {
         create_matrix(layers_sizes[i], layers_sizes[i + 1]);
     nn->layers[i]->bias = create_matrix(1, layers_sizes[i + 1]);
 
-    randomize_matrix(nn->layers[i]->weights, 0.1);
-    fill_matrix(nn->layers[i]->bias, 0.0);
+    // He init for the ReLU layers, Xavier for the sigmoid output.
+    initialize_layer(nn->layers[i], (i == num_layers - 1) ? INIT_XAVIER_UNIFORM
+                                                          : INIT_HE_UNIFORM);
 
     nn->layers[i]->activation_type = (i == num_layers - 1) ? SIGMOID : RELU;
     nn->layers[i]->leak_parameter = 0.01;
@@ -118,24 +122,13 @@ int main() {
     backpropagate(nn, y_train, MSE, mean_squared_error_gradient);
 
     for (size_t j = 0; j < nn->num_layers; j++) {
-      Matrix* dW = calculate_weight_gradient(nn->cache, j, nn->num_layers);
-      Matrix* db = calculate_bias_gradient(nn->cache, j, nn->num_layers);
+      Matrix* dW = calculate_weight_gradient(nn, j);
+      Matrix* db = calculate_bias_gradient(nn, j);
 
-      Matrix* scaled_dW = scale_matrix(learning_rate, dW);
-      Matrix* scaled_db = scale_matrix(learning_rate, db);
-
-      Matrix* new_weights = subtract_matrix(nn->layers[j]->weights, scaled_dW);
-      Matrix* new_bias = subtract_matrix(nn->layers[j]->bias, scaled_db);
-
-      free_matrix(nn->layers[j]->weights);
-      free_matrix(nn->layers[j]->bias);
-      nn->layers[j]->weights = new_weights;
-      nn->layers[j]->bias = new_bias;
+      sgd_update(nn->layers[j], dW, db, learning_rate);
 
       free_matrix(dW);
       free_matrix(db);
-      free_matrix(scaled_dW);
-      free_matrix(scaled_db);
     }
     free_matrix(y_hat);
 
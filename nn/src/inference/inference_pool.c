@@ -0,0 +1,342 @@
+/**
+ * @file inference_pool.c
+ * @brief Worker pool implementation for asynchronous inference.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "feedforward.h"
+#include "inference.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/**
+ * @brief A single inference request. Jobs move from the pending queue to a
+ * worker and, unless they carry a callback, on to the completed queue.
+ */
+typedef struct InferenceJob {
+  size_t id;                  /**< Identifier handed back to the caller. */
+  const Matrix* input;        /**< Borrowed input batch. */
+  Matrix* output;             /**< Result, set once the job has run. */
+  InferenceCallback callback; /**< Optional completion callback. */
+  void* user_data;            /**< Passed through to the callback. */
+  struct InferenceJob* next;  /**< Next job in whichever queue holds it. */
+} InferenceJob;
+
+struct InferencePool {
+  const NeuralNetwork* nn; /**< Network served by the pool. */
+  pthread_t* workers;      /**< Worker thread handles. */
+  size_t num_workers;      /**< Number of started workers. */
+  size_t capacity;         /**< Maximum number of jobs in flight. */
+
+  pthread_mutex_t lock;          /**< Guards every field below. */
+  pthread_cond_t job_available;  /**< Signalled when work is queued. */
+  pthread_cond_t slot_available; /**< Signalled when in_flight drops. */
+  pthread_cond_t job_completed;  /**< Signalled when a job finishes. */
+
+  InferenceJob* pending_head; /**< FIFO of jobs waiting for a worker. */
+  InferenceJob* pending_tail;
+  InferenceJob* done_head; /**< FIFO of finished, uncollected jobs. */
+  InferenceJob* done_tail;
+
+  size_t in_flight;   /**< Submitted and not yet collected. */
+  size_t unfinished;  /**< Submitted and not yet run to completion. */
+  size_t collectable; /**< Callback-less jobs not yet collected. */
+  size_t next_id;     /**< Identifier for the next submission. */
+  int shutting_down;  /**< Set once the pool is being freed. */
+};
+
+/**
+ * @brief Worker thread body: run pending jobs until the pool shuts down and
+ * the pending queue is empty.
+ * @param arg A pointer to the owning InferencePool.
+ * @return Always NULL.
+ */
+static void* inference_worker(void* arg) {
+  InferencePool* pool = (InferencePool*)arg;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending_head == NULL && !pool->shutting_down) {
+      pthread_cond_wait(&pool->job_available, &pool->lock);
+    }
+    if (pool->pending_head == NULL) {
+      pthread_mutex_unlock(&pool->lock);
+      break;
+    }
+    InferenceJob* job = pool->pending_head;
+    pool->pending_head = job->next;
+    if (pool->pending_head == NULL) {
+      pool->pending_tail = NULL;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    job->output = predict(pool->nn, job->input);
+    job->next = NULL;
+
+    if (job->callback != NULL) {
+      job->callback(job->id, job->output, job->user_data);
+      free(job);
+
+      pthread_mutex_lock(&pool->lock);
+      pool->unfinished--;
+      pool->in_flight--;
+      pthread_cond_signal(&pool->slot_available);
+      pthread_cond_broadcast(&pool->job_completed);
+      pthread_mutex_unlock(&pool->lock);
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->done_tail == NULL) {
+      pool->done_head = job;
+    } else {
+      pool->done_tail->next = job;
+    }
+    pool->done_tail = job;
+    pool->unfinished--;
+    pthread_cond_broadcast(&pool->job_completed);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  return NULL;
+}
+
+InferencePool* create_inference_pool(const NeuralNetwork* nn,
+                                     size_t num_workers, size_t capacity) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(num_workers > 0, "Inference pool needs at least one worker.");
+  ASSERT(capacity > 0, "Inference pool capacity must be greater than 0.");
+
+  InferencePool* pool = (InferencePool*)calloc(1, sizeof(InferencePool));
+  if (pool == NULL) {
+    LOG_ERROR("Memory allocation failed for inference pool.");
+    return NULL;
+  }
+  pool->workers = (pthread_t*)malloc(sizeof(pthread_t) * num_workers);
+  if (pool->workers == NULL) {
+    LOG_ERROR("Memory allocation failed for inference workers.");
+    free(pool);
+    return NULL;
+  }
+
+  pool->nn = nn;
+  pool->capacity = capacity;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->job_available, NULL);
+  pthread_cond_init(&pool->slot_available, NULL);
+  pthread_cond_init(&pool->job_completed, NULL);
+
+  for (size_t i = 0; i < num_workers; i++) {
+    if (pthread_create(&pool->workers[i], NULL, inference_worker, pool) != 0) {
+      LOG_ERROR("Failed to start inference worker %zu.", i);
+      free_inference_pool(pool);
+      return NULL;
+    }
+    pool->num_workers++;
+  }
+
+  LOG_INFO("Inference pool started with %zu workers, capacity %zu.",
+           num_workers, capacity);
+  return pool;
+}
+
+/**
+ * @brief Queues a job. The pool lock must be held and a slot must be free.
+ * @return The identifier of the queued job.
+ */
+static size_t enqueue_job_locked(InferencePool* pool, const Matrix* input,
+                                 InferenceCallback callback, void* user_data) {
+  InferenceJob* job = (InferenceJob*)malloc(sizeof(InferenceJob));
+  CHECK_MALLOC(job, "Failed to allocate memory for inference job.");
+
+  job->id = pool->next_id++;
+  job->input = input;
+  job->output = NULL;
+  job->callback = callback;
+  job->user_data = user_data;
+  job->next = NULL;
+
+  if (pool->pending_tail == NULL) {
+    pool->pending_head = job;
+  } else {
+    pool->pending_tail->next = job;
+  }
+  pool->pending_tail = job;
+
+  pool->in_flight++;
+  pool->unfinished++;
+  if (callback == NULL) {
+    pool->collectable++;
+  }
+  pthread_cond_signal(&pool->job_available);
+  return job->id;
+}
+
+/**
+ * @brief Submits an inference job, waiting for a free slot when the pool is at
+ * capacity.
+ * @param pool A pointer to the InferencePool.
+ * @param input The input batch; it must stay valid until the job completes.
+ * @param callback Optional completion callback.
+ * @param user_data Passed through to the callback.
+ * @return The identifier of the submitted job.
+ */
+size_t inference_submit(InferencePool* pool, const Matrix* input,
+                        InferenceCallback callback, void* user_data) {
+  ASSERT(pool != NULL, "Inference pool cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->in_flight >= pool->capacity) {
+    pthread_cond_wait(&pool->slot_available, &pool->lock);
+  }
+  size_t id = enqueue_job_locked(pool, input, callback, user_data);
+  pthread_mutex_unlock(&pool->lock);
+  return id;
+}
+
+/**
+ * @brief Submits an inference job only if the pool has a free slot.
+ * @param pool A pointer to the InferencePool.
+ * @param input The input batch; it must stay valid until the job completes.
+ * @param callback Optional completion callback.
+ * @param user_data Passed through to the callback.
+ * @param job_id Receives the job identifier on success (may be NULL).
+ * @return 1 if the job was queued, 0 if the pool is at capacity.
+ */
+int inference_try_submit(InferencePool* pool, const Matrix* input,
+                         InferenceCallback callback, void* user_data,
+                         size_t* job_id) {
+  ASSERT(pool != NULL, "Inference pool cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->in_flight >= pool->capacity) {
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+  }
+  size_t id = enqueue_job_locked(pool, input, callback, user_data);
+  pthread_mutex_unlock(&pool->lock);
+
+  if (job_id != NULL) {
+    *job_id = id;
+  }
+  return 1;
+}
+
+/**
+ * @brief Removes the oldest completed job. The pool lock must be held and the
+ * completed queue must not be empty.
+ * @return The job's output; the job itself is freed.
+ */
+static Matrix* collect_job_locked(InferencePool* pool, size_t* job_id) {
+  InferenceJob* job = pool->done_head;
+  pool->done_head = job->next;
+  if (pool->done_head == NULL) {
+    pool->done_tail = NULL;
+  }
+  pool->in_flight--;
+  pool->collectable--;
+  pthread_cond_signal(&pool->slot_available);
+
+  if (job_id != NULL) {
+    *job_id = job->id;
+  }
+  Matrix* output = job->output;
+  free(job);
+  return output;
+}
+
+/**
+ * @brief Collects one completed result without blocking.
+ * @param pool A pointer to the InferencePool.
+ * @param job_id Receives the identifier of the returned job (may be NULL).
+ * @return The output of a completed job, or NULL if none is ready. The caller
+ * is responsible for freeing the returned matrix.
+ */
+Matrix* inference_poll(InferencePool* pool, size_t* job_id) {
+  ASSERT(pool != NULL, "Inference pool cannot be NULL.");
+
+  pthread_mutex_lock(&pool->lock);
+  Matrix* output = NULL;
+  if (pool->done_head != NULL) {
+    output = collect_job_locked(pool, job_id);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return output;
+}
+
+/**
+ * @brief Waits for a completed result and collects it.
+ * @param pool A pointer to the InferencePool.
+ * @param job_id Receives the identifier of the returned job (may be NULL).
+ * @return The output of a completed job, or NULL if no callback-less jobs are
+ * outstanding. The caller is responsible for freeing the returned matrix.
+ */
+Matrix* inference_wait_any(InferencePool* pool, size_t* job_id) {
+  ASSERT(pool != NULL, "Inference pool cannot be NULL.");
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->done_head == NULL && pool->collectable > 0) {
+    pthread_cond_wait(&pool->job_completed, &pool->lock);
+  }
+  Matrix* output = NULL;
+  if (pool->done_head != NULL) {
+    output = collect_job_locked(pool, job_id);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return output;
+}
+
+/**
+ * @brief Blocks until every submitted job has finished running. Results stay
+ * queued for collection.
+ * @param pool A pointer to the InferencePool.
+ */
+void inference_drain(InferencePool* pool) {
+  ASSERT(pool != NULL, "Inference pool cannot be NULL.");
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->unfinished > 0) {
+    pthread_cond_wait(&pool->job_completed, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Runs all outstanding jobs, joins the workers and frees the pool along
+ * with any results that were never collected.
+ * @param pool A pointer to the InferencePool to free.
+ */
+void free_inference_pool(InferencePool* pool) {
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->shutting_down = 1;
+  pthread_cond_broadcast(&pool->job_available);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->num_workers; i++) {
+    pthread_join(pool->workers[i], NULL);
+  }
+
+  InferenceJob* current = pool->done_head;
+  while (current != NULL) {
+    InferenceJob* to_free = current;
+    current = current->next;
+    free_matrix(to_free->output);
+    free(to_free);
+  }
+
+  pthread_cond_destroy(&pool->job_completed);
+  pthread_cond_destroy(&pool->slot_available);
+  pthread_cond_destroy(&pool->job_available);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->workers);
+  free(pool);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file model_slot.c
+ * @brief RCU-style publication of networks for hot-swapping weights.
+ *
+ * Readers announce themselves in one of two counters selected by the current
+ * phase, then load the network pointer. A publisher exchanges the pointer and
+ * afterwards flips the phase twice, each time waiting for the counter of the
+ * phase it just left to drain. Any reader that loaded the old pointer had
+ * already incremented one of the two counters before the exchange, so once both
+ * have drained the old network is unreachable and can be freed. Readers that
+ * arrive during a wait use the other counter, so publishers cannot be starved.
+ */
+#include "model_slot.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+struct ModelSlot {
+  _Atomic(NeuralNetwork*) current; /**< Network handed to new readers. */
+  atomic_uint phase;               /**< Low bit selects the reader counter. */
+  atomic_size_t readers[2];        /**< Active readers per phase. */
+  pthread_mutex_t publish_lock;    /**< Serializes publishers. */
+};
+
+/**
+ * @brief Creates a model slot that owns the given network.
+ * @param initial The network to serve until the first publish.
+ * @return A pointer to the new ModelSlot, or NULL if allocation fails.
+ */
+ModelSlot* create_model_slot(NeuralNetwork* initial) {
+  ASSERT(initial != NULL, "Initial network cannot be NULL.");
+
+  ModelSlot* slot = (ModelSlot*)malloc(sizeof(ModelSlot));
+  if (slot == NULL) {
+    LOG_ERROR("Memory allocation failed for model slot.");
+    return NULL;
+  }
+  atomic_init(&slot->current, initial);
+  atomic_init(&slot->phase, 0);
+  atomic_init(&slot->readers[0], 0);
+  atomic_init(&slot->readers[1], 0);
+  pthread_mutex_init(&slot->publish_lock, NULL);
+  return slot;
+}
+
+/**
+ * @brief Pins the currently published network.
+ * @param slot A pointer to the ModelSlot.
+ * @return A snapshot that must be passed to model_slot_release.
+ */
+ModelSnapshot model_slot_acquire(ModelSlot* slot) {
+  ASSERT(slot != NULL, "Model slot cannot be NULL.");
+
+  ModelSnapshot snapshot;
+  snapshot.phase = atomic_load(&slot->phase) & 1u;
+  atomic_fetch_add(&slot->readers[snapshot.phase], 1);
+  // The pointer must be loaded after announcing the reader.
+  snapshot.nn = atomic_load(&slot->current);
+  return snapshot;
+}
+
+/**
+ * @brief Unpins a network previously pinned by model_slot_acquire.
+ * @param slot A pointer to the ModelSlot.
+ * @param snapshot The snapshot returned by model_slot_acquire.
+ */
+void model_slot_release(ModelSlot* slot, ModelSnapshot snapshot) {
+  ASSERT(slot != NULL, "Model slot cannot be NULL.");
+  atomic_fetch_sub(&slot->readers[snapshot.phase], 1);
+}
+
+/**
+ * @brief Waits until no reader can still hold a network that was replaced
+ * before this call. The caller must hold the publish lock.
+ * @param slot A pointer to the ModelSlot.
+ */
+static void wait_for_grace_period(ModelSlot* slot) {
+  for (int flip = 0; flip < 2; flip++) {
+    unsigned int old_phase = atomic_fetch_add(&slot->phase, 1) & 1u;
+    while (atomic_load(&slot->readers[old_phase]) > 0) {
+      sched_yield();
+    }
+  }
+}
+
+/**
+ * @brief Publishes a new network and frees the previous one once every reader
+ * that might hold it has released it.
+ * @param slot A pointer to the ModelSlot.
+ * @param next The network to publish. The slot takes ownership.
+ */
+void model_slot_publish(ModelSlot* slot, NeuralNetwork* next) {
+  ASSERT(slot != NULL, "Model slot cannot be NULL.");
+  ASSERT(next != NULL, "Published network cannot be NULL.");
+
+  pthread_mutex_lock(&slot->publish_lock);
+  NeuralNetwork* previous = atomic_exchange(&slot->current, next);
+  wait_for_grace_period(slot);
+  pthread_mutex_unlock(&slot->publish_lock);
+
+  LOG_INFO("Published new model at %p, releasing %p.", next, previous);
+  free_network(previous);
+}
+
+/**
+ * @brief Runs a cache-free forward pass on the currently published network.
+ * @param slot A pointer to the ModelSlot.
+ * @param input A pointer to the input Matrix.
+ * @return A new matrix containing the network output. The caller is
+ * responsible for freeing this matrix.
+ */
+Matrix* model_slot_predict(ModelSlot* slot, const Matrix* input) {
+  ModelSnapshot snapshot = model_slot_acquire(slot);
+  Matrix* output = predict(snapshot.nn, input);
+  model_slot_release(slot, snapshot);
+  return output;
+}
+
+/**
+ * @brief Frees the model slot and the network it currently holds.
+ * @param slot A pointer to the ModelSlot to free.
+ */
+void free_model_slot(ModelSlot* slot) {
+  if (slot == NULL) {
+    return;
+  }
+  free_network(atomic_load(&slot->current));
+  pthread_mutex_destroy(&slot->publish_lock);
+  free(slot);
+}
@@ -0,0 +1,324 @@
+/**
+ * @file stream_inference.c
+ * @brief Three-stage read/score/write pipeline over reusable chunk buffers.
+ *
+ * Chunks are handed from the reader thread to the scoring (calling) thread to
+ * the writer thread strictly in sequence, cycling through
+ * STREAM_PIPELINE_DEPTH buffers. Each stage waits only for the specific chunk
+ * it needs next, so all three stages can work on different chunks at once.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "stream_inference.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/** @brief Pipeline stage a chunk buffer is waiting for. */
+typedef enum {
+  CHUNK_EMPTY,  /**< Free for the reader. */
+  CHUNK_READ,   /**< Filled, waiting to be scored. */
+  CHUNK_SCORED, /**< Scored, waiting to be written. */
+} ChunkState;
+
+/** @brief One reusable chunk buffer. */
+typedef struct {
+  Matrix* input;    /**< chunk_rows x input_features, allocated once. */
+  Matrix* output;   /**< Predictions for the chunk, owned until written. */
+  size_t rows;      /**< Number of valid rows in `input`. */
+  int last;         /**< Set on the final chunk of the stream. */
+  ChunkState state; /**< Current pipeline stage. */
+} Chunk;
+
+/** @brief Shared state of one stream_predict call. */
+typedef struct {
+  const NeuralNetwork* nn;
+  FILE* input;
+  FILE* output;
+  size_t chunk_rows;
+  size_t cols;
+
+  Chunk chunks[STREAM_PIPELINE_DEPTH];
+  pthread_mutex_t lock;   /**< Guards chunk states and `failed`. */
+  pthread_cond_t changed; /**< Broadcast on every state change. */
+  int failed;             /**< Set on a parse or write error. */
+  long rows_written;      /**< Only touched by the writer. */
+} StreamPipeline;
+
+/**
+ * @brief Blocks until the given chunk reaches the wanted state.
+ * @param p The pipeline.
+ * @param chunk The chunk to wait on.
+ * @param state The state to wait for.
+ */
+static void wait_for_chunk(StreamPipeline* p, Chunk* chunk, ChunkState state) {
+  pthread_mutex_lock(&p->lock);
+  while (chunk->state != state) {
+    pthread_cond_wait(&p->changed, &p->lock);
+  }
+  pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Moves a chunk to the next stage and wakes the other stages.
+ * @param p The pipeline.
+ * @param chunk The chunk to hand over.
+ * @param state The new state.
+ */
+static void hand_over_chunk(StreamPipeline* p, Chunk* chunk,
+                            ChunkState state) {
+  pthread_mutex_lock(&p->lock);
+  chunk->state = state;
+  pthread_cond_broadcast(&p->changed);
+  pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Records a failure so the reader stops early.
+ * @param p The pipeline.
+ */
+static void mark_failed(StreamPipeline* p) {
+  pthread_mutex_lock(&p->lock);
+  p->failed = 1;
+  pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Parses one line of separated values into a row.
+ * @param line The text line.
+ * @param row Destination of `cols` values.
+ * @param cols Expected number of values.
+ * @return The number of values found; 0 for a blank line.
+ */
+static size_t parse_row(const char* line, double* row, size_t cols) {
+  const char* cursor = line;
+  size_t count = 0;
+  for (;;) {
+    cursor += strspn(cursor, ", \t\r\n");
+    if (*cursor == '\0') {
+      break;
+    }
+    char* end;
+    double value = strtod(cursor, &end);
+    if (end == cursor || count == cols) {
+      return cols + 1;
+    }
+    row[count++] = value;
+    cursor = end;
+  }
+  return count;
+}
+
+/**
+ * @brief Reader stage: fills chunks from the input stream.
+ * @param arg A pointer to the StreamPipeline.
+ * @return Always NULL.
+ */
+static void* stream_reader(void* arg) {
+  StreamPipeline* p = (StreamPipeline*)arg;
+  char* line = NULL;
+  size_t line_capacity = 0;
+  size_t line_number = 0;
+
+  for (size_t seq = 0;; seq++) {
+    Chunk* chunk = &p->chunks[seq % STREAM_PIPELINE_DEPTH];
+    wait_for_chunk(p, chunk, CHUNK_EMPTY);
+
+    chunk->rows = 0;
+    chunk->last = 0;
+    while (chunk->rows < p->chunk_rows) {
+      if (getline(&line, &line_capacity, p->input) < 0) {
+        chunk->last = 1;
+        break;
+      }
+      line_number++;
+      double* row = &chunk->input->matrix_data[chunk->rows * p->cols];
+      size_t count = parse_row(line, row, p->cols);
+      if (count == 0) {
+        continue;
+      }
+      if (count != p->cols) {
+        LOG_ERROR("Expected %zu values on input line %zu.", p->cols,
+                  line_number);
+        mark_failed(p);
+        chunk->rows = 0;
+        chunk->last = 1;
+        break;
+      }
+      chunk->rows++;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    if (p->failed) {
+      chunk->rows = 0;
+      chunk->last = 1;
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    int last = chunk->last;
+    hand_over_chunk(p, chunk, CHUNK_READ);
+    if (last) {
+      break;
+    }
+  }
+
+  free(line);
+  return NULL;
+}
+
+/**
+ * @brief Writer stage: writes scored chunks in order and recycles them.
+ * @param arg A pointer to the StreamPipeline.
+ * @return Always NULL.
+ */
+static void* stream_writer(void* arg) {
+  StreamPipeline* p = (StreamPipeline*)arg;
+  int write_failed = 0;
+
+  for (size_t seq = 0;; seq++) {
+    Chunk* chunk = &p->chunks[seq % STREAM_PIPELINE_DEPTH];
+    wait_for_chunk(p, chunk, CHUNK_SCORED);
+
+    if (chunk->output != NULL) {
+      const Matrix* out = chunk->output;
+      for (size_t i = 0; i < out->rows && !write_failed; i++) {
+        for (size_t j = 0; j < out->cols; j++) {
+          fprintf(p->output, "%.9g%s", out->matrix_data[i * out->cols + j],
+                  (j == out->cols - 1) ? "\n" : ",");
+        }
+        if (ferror(p->output)) {
+          LOG_ERROR("Failed to write predictions.");
+          write_failed = 1;
+          mark_failed(p);
+        }
+      }
+      if (!write_failed) {
+        p->rows_written += (long)out->rows;
+      }
+      free_matrix(chunk->output);
+      chunk->output = NULL;
+    }
+
+    int last = chunk->last;
+    hand_over_chunk(p, chunk, CHUNK_EMPTY);
+    if (last) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Scores an input stream chunk by chunk, overlapping reading, the
+ * forward pass and writing.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param input The stream of input rows.
+ * @param output The stream predictions are written to.
+ * @param chunk_rows Maximum number of rows per forward pass.
+ * @return The number of rows scored, or -1 on error.
+ */
+long stream_predict(const NeuralNetwork* nn, FILE* input, FILE* output,
+                    size_t chunk_rows) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(input != NULL && output != NULL, "Streams cannot be NULL.");
+  ASSERT(chunk_rows > 0, "Chunk size must be greater than 0.");
+
+  StreamPipeline p;
+  memset(&p, 0, sizeof(p));
+  p.nn = nn;
+  p.input = input;
+  p.output = output;
+  p.chunk_rows = chunk_rows;
+  p.cols = layer_input_size(nn->layers[0]);
+  for (size_t i = 0; i < STREAM_PIPELINE_DEPTH; i++) {
+    p.chunks[i].input = create_matrix(chunk_rows, p.cols);
+    p.chunks[i].state = CHUNK_EMPTY;
+  }
+  pthread_mutex_init(&p.lock, NULL);
+  pthread_cond_init(&p.changed, NULL);
+
+  pthread_t reader;
+  pthread_t writer;
+  ASSERT(pthread_create(&reader, NULL, stream_reader, &p) == 0,
+         "Failed to start stream reader.");
+  ASSERT(pthread_create(&writer, NULL, stream_writer, &p) == 0,
+         "Failed to start stream writer.");
+
+  LOG_INFO("Streaming inference in chunks of %zu rows.", chunk_rows);
+  for (size_t seq = 0;; seq++) {
+    Chunk* chunk = &p.chunks[seq % STREAM_PIPELINE_DEPTH];
+    wait_for_chunk(&p, chunk, CHUNK_READ);
+
+    if (chunk->rows > 0) {
+      // Score only the filled rows of the reusable buffer.
+      Matrix* filled = create_matrix_view(chunk->input->matrix_data,
+                                          chunk->rows, p.cols);
+      CHECK_MALLOC(filled, "Failed to allocate chunk view.");
+      chunk->output = predict(nn, filled);
+      free_matrix_view(filled);
+    }
+
+    int last = chunk->last;
+    hand_over_chunk(&p, chunk, CHUNK_SCORED);
+    if (last) {
+      break;
+    }
+  }
+
+  pthread_join(reader, NULL);
+  pthread_join(writer, NULL);
+  fflush(output);
+
+  for (size_t i = 0; i < STREAM_PIPELINE_DEPTH; i++) {
+    free_matrix(p.chunks[i].input);
+  }
+  pthread_cond_destroy(&p.changed);
+  pthread_mutex_destroy(&p.lock);
+
+  if (p.failed) {
+    return -1;
+  }
+  LOG_INFO("Streamed predictions for %ld rows.", p.rows_written);
+  return p.rows_written;
+}
+
+/**
+ * @brief Opens the input and output files and streams predictions between
+ * them.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param input_path Path of the input file.
+ * @param output_path Path of the output file (created or truncated).
+ * @param chunk_rows Maximum number of rows per forward pass.
+ * @return The number of rows scored, or -1 on error.
+ */
+long stream_predict_file(const NeuralNetwork* nn, const char* input_path,
+                         const char* output_path, size_t chunk_rows) {
+  FILE* input = fopen(input_path, "r");
+  if (input == NULL) {
+    LOG_ERROR("Could not open file %s", input_path);
+    return -1;
+  }
+  FILE* output = fopen(output_path, "w");
+  if (output == NULL) {
+    LOG_ERROR("Could not open file %s", output_path);
+    fclose(input);
+    return -1;
+  }
+
+  long rows = stream_predict(nn, input, output, chunk_rows);
+
+  fclose(input);
+  if (fclose(output) != 0) {
+    LOG_ERROR("Failed to close %s", output_path);
+    return -1;
+  }
+  return rows;
+}
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "linalg.h"
+#include "rng.h"
 #include "utils.h"
 
 //============================
@@ -100,9 +101,14 @@ Matrix* create_matrix(size_t rows, size_t cols) {
   Matrix* matrix = (Matrix*)malloc(sizeof(Matrix));
   CHECK_MALLOC(matrix, "Failed to allocate memory for Matrix struct.");
 
-  matrix->matrix_data = (double*)malloc(rows * cols * sizeof(double));
-  CHECK_MALLOC(matrix->matrix_data,
-               "Failed to allocate memory for matrix data.");
+  // An empty matrix owns no buffer rather than relying on what malloc(0)
+  // returns.
+  matrix->matrix_data = NULL;
+  if (rows * cols > 0) {
+    matrix->matrix_data = (double*)malloc(rows * cols * sizeof(double));
+    CHECK_MALLOC(matrix->matrix_data,
+                 "Failed to allocate memory for matrix data.");
+  }
 
   matrix->rows = rows;
   matrix->cols = cols;
@@ -124,7 +130,9 @@ Matrix* copy_matrix(const Matrix* m) {
   Matrix* new_matrix = create_matrix(m->rows, m->cols);
 
   size_t total_bytes = m->rows * m->cols * sizeof(double);
-  memcpy(new_matrix->matrix_data, m->matrix_data, total_bytes);
+  if (total_bytes > 0) {
+    memcpy(new_matrix->matrix_data, m->matrix_data, total_bytes);
+  }
 
   LOG_INFO("Matrix copy complete.");
 
@@ -151,7 +159,9 @@ void fill_matrix(Matrix* m, double n) {
 /**
  * @brief Randomizes the elements of a matrix within a specific range.
  * The range is determined by `n` (typically the number of input features) to
- * help prevent vanishing/exploding gradients.
+ * help prevent vanishing/exploding gradients. Values come from the next
+ * offsets of the global counter-based stream (see rng.h), so they depend only
+ * on the seed and the order of the calls, not on the thread count.
  * @param m A pointer to the Matrix to be randomized.
  * @param n A scaling factor used to determine the range of random values.
  */
@@ -160,14 +170,10 @@ void randomize_matrix(Matrix* m, double n) {
   // Apparently a 1/n or 1/n^2 scaling leads to a vanishing gradient problem
   double min = -1.0 / sqrt(n);
   double max = 1.0 / sqrt(n);
-  double range = max - min;
 
-  for (size_t i = 0; i < m->rows; i++) {
-    for (size_t j = 0; j < m->cols; j++) {
-      double random_value = (double)rand() / (double)RAND_MAX;
-      m->matrix_data[i * m->cols + j] = min + random_value * range;
-    }
-  }
+  size_t count = m->rows * m->cols;
+  rng_fill_uniform(rng_seed(), rng_reserve(count), m->matrix_data, count, min,
+                   max);
   LOG_INFO("Matrix randomized successfully.");
 }
 
@@ -188,6 +194,33 @@ void free_matrix(Matrix* m) {
   LOG_INFO("Matrix freed successfully.");
 }
 
+/**
+ * @brief Wraps an existing buffer as a matrix without copying it.
+ * The view does not own the buffer; the caller must keep the buffer alive for
+ * the lifetime of the view and release the view with free_matrix_view.
+ * @param data The row-major buffer holding rows * cols doubles.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @return A pointer to the new view.
+ */
+Matrix* create_matrix_view(double* data, size_t rows, size_t cols) {
+  ASSERT(data != NULL, "View data cannot be NULL.");
+
+  Matrix* view = (Matrix*)malloc(sizeof(Matrix));
+  CHECK_MALLOC(view, "Failed to allocate memory for Matrix view.");
+  view->matrix_data = data;
+  view->rows = rows;
+  view->cols = cols;
+  return view;
+}
+
+/**
+ * @brief Frees a matrix view created by create_matrix_view. The underlying
+ * buffer is not freed.
+ * @param view A pointer to the view to be freed.
+ */
+void free_matrix_view(Matrix* view) { free(view); }
+
 /**
  * @brief Prints the elements of a matrix to standard output for debugging
  * purposes.
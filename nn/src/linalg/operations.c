@@ -299,3 +299,139 @@ Matrix* sum_matrix_columns(Matrix* m) {
 
   return result;
 }
+
+/**
+ * @brief Computes c = alpha * op(a) · op(b) + beta * c in place, where op(x)
+ * is x or its transpose. Rows of c are distributed across threads; the inner
+ * loops are ordered so that the innermost one walks contiguous memory.
+ * @param transpose_a Nonzero to use a^T.
+ * @param transpose_b Nonzero to use b^T.
+ * @param alpha Scale of the product.
+ * @param a The left operand.
+ * @param b The right operand.
+ * @param beta Scale of the existing contents of c (0 overwrites them).
+ * @param c The output matrix, updated in place.
+ */
+void gemm_matrix(int transpose_a, int transpose_b, double alpha,
+                 const Matrix* a, const Matrix* b, double beta, Matrix* c) {
+  ASSERT(a != NULL && b != NULL && c != NULL, "Input matrices cannot be NULL.");
+
+  size_t m = transpose_a ? a->cols : a->rows;
+  size_t k = transpose_a ? a->rows : a->cols;
+  size_t n = transpose_b ? b->rows : b->cols;
+  ASSERT(k == (transpose_b ? b->cols : b->rows),
+         "Matrices dimensions are incompatible for dot product.");
+  ASSERT(c->rows == m && c->cols == n,
+         "Output matrix has the wrong shape for dot product.");
+
+  const double* a_data = a->matrix_data;
+  const double* b_data = b->matrix_data;
+  double* c_data = c->matrix_data;
+  size_t lda = a->cols;
+  size_t ldb = b->cols;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < m; i++) {
+    double* c_row = &c_data[i * n];
+    if (beta == 0.0) {
+      memset(c_row, 0, n * sizeof(double));
+    } else if (beta != 1.0) {
+      for (size_t j = 0; j < n; j++) {
+        c_row[j] *= beta;
+      }
+    }
+
+    if (transpose_b) {
+      // Rows of b are columns of op(b): accumulate contiguous dot products.
+      for (size_t j = 0; j < n; j++) {
+        const double* b_row = &b_data[j * ldb];
+        double sum = 0.0;
+        for (size_t p = 0; p < k; p++) {
+          double a_ip = transpose_a ? a_data[p * lda + i] : a_data[i * lda + p];
+          sum += a_ip * b_row[p];
+        }
+        c_row[j] += alpha * sum;
+      }
+    } else {
+      for (size_t p = 0; p < k; p++) {
+        double a_ip = transpose_a ? a_data[p * lda + i] : a_data[i * lda + p];
+        if (a_ip == 0.0) {
+          continue;
+        }
+        double scaled = alpha * a_ip;
+        const double* b_row = &b_data[p * ldb];
+        for (size_t j = 0; j < n; j++) {
+          c_row[j] += scaled * b_row[j];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Sums the columns of a matrix into an existing row vector:
+ * out = colsum(m) + beta * out.
+ * @param m The input matrix.
+ * @param beta Scale of the existing contents of out (0 overwrites them).
+ * @param out A 1xN row vector, updated in place.
+ */
+void sum_matrix_columns_into(const Matrix* m, double beta, Matrix* out) {
+  ASSERT(m != NULL && out != NULL, "Input matrices cannot be NULL.");
+  ASSERT(out->rows == 1 && out->cols == m->cols,
+         "Output must be a row vector with one entry per column.");
+
+  double* sums = out->matrix_data;
+  if (beta == 0.0) {
+    memset(sums, 0, m->cols * sizeof(double));
+  } else if (beta != 1.0) {
+    for (size_t j = 0; j < m->cols; j++) {
+      sums[j] *= beta;
+    }
+  }
+  // Walk rows in order so both buffers are read contiguously.
+  for (size_t i = 0; i < m->rows; i++) {
+    const double* row = &m->matrix_data[i * m->cols];
+    for (size_t j = 0; j < m->cols; j++) {
+      sums[j] += row[j];
+    }
+  }
+}
+
+// Rows fetched ahead of the one being copied by gather_rows.
+#define GATHER_PREFETCH_DISTANCE 4
+#define GATHER_CACHE_LINE 64
+
+/**
+ * @brief Copies the rows of src listed in indices into the leading rows of
+ * dst, prefetching the rows GATHER_PREFETCH_DISTANCE positions ahead.
+ * @param src The source matrix.
+ * @param indices The source row of each destination row.
+ * @param n The number of rows to gather.
+ * @param dst The destination buffer; its rows are set to n.
+ */
+void gather_rows(const Matrix* src, const size_t* indices, size_t n,
+                 Matrix* dst) {
+  ASSERT(src != NULL && dst != NULL, "Input matrices cannot be NULL.");
+  ASSERT(indices != NULL || n == 0, "Row indices cannot be NULL.");
+  ASSERT(dst->cols == src->cols, "Gather buffer has the wrong width.");
+
+  size_t row_bytes = src->cols * sizeof(double);
+  for (size_t r = 0; r < n; r++) {
+#if defined(__GNUC__) || defined(__clang__)
+    if (r + GATHER_PREFETCH_DISTANCE < n) {
+      const char* ahead =
+          (const char*)(src->matrix_data +
+                        indices[r + GATHER_PREFETCH_DISTANCE] * src->cols);
+      for (size_t b = 0; b < row_bytes; b += GATHER_CACHE_LINE) {
+        __builtin_prefetch(ahead + b, 0, 0);
+      }
+    }
+#endif
+    ASSERT(indices[r] < src->rows, "Row index out of bounds.");
+    memcpy(dst->matrix_data + r * src->cols,
+           src->matrix_data + indices[r] * src->cols, row_bytes);
+  }
+  dst->rows = n;
+}
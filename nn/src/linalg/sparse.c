@@ -0,0 +1,155 @@
+/**
+ * @file sparse.c
+ * @brief CSR sparse matrices and sparse-dense products.
+ *
+ * Used for wide, mostly-zero inputs (pixels, one-hot features), where the
+ * first layer's product only needs the weight rows of non-zero features.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "linalg.h"
+#include "utils.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @brief Converts a dense matrix to CSR.
+ * @param m A pointer to the dense Matrix.
+ * @return A new SparseMatrix holding the non-zero elements of m, or NULL if
+ * allocation fails. Free with free_sparse_matrix.
+ */
+SparseMatrix* dense_to_sparse(const Matrix* m) {
+  ASSERT(m != NULL, "Input matrix cannot be NULL.");
+
+  size_t total = m->rows * m->cols;
+  size_t nnz = 0;
+  for (size_t i = 0; i < total; i++) {
+    nnz += (m->matrix_data[i] != 0.0);
+  }
+
+  SparseMatrix* sparse = (SparseMatrix*)malloc(sizeof(SparseMatrix));
+  CHECK_ALLOC(sparse);
+  sparse->rows = m->rows;
+  sparse->cols = m->cols;
+  sparse->nnz = nnz;
+  // Allocate at least one element so an all-zero matrix is not NULL.
+  sparse->values = (double*)malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+  sparse->col_indices = (size_t*)malloc((nnz > 0 ? nnz : 1) * sizeof(size_t));
+  sparse->row_ptr = (size_t*)malloc((m->rows + 1) * sizeof(size_t));
+  if (sparse->values == NULL || sparse->col_indices == NULL ||
+      sparse->row_ptr == NULL) {
+    LOG_ERROR("Memory allocation failed for sparse matrix.");
+    free_sparse_matrix(sparse);
+    return NULL;
+  }
+
+  size_t k = 0;
+  for (size_t r = 0; r < m->rows; r++) {
+    sparse->row_ptr[r] = k;
+    const double* row = m->matrix_data + r * m->cols;
+    for (size_t c = 0; c < m->cols; c++) {
+      if (row[c] != 0.0) {
+        sparse->values[k] = row[c];
+        sparse->col_indices[k] = c;
+        k++;
+      }
+    }
+  }
+  sparse->row_ptr[m->rows] = k;
+  return sparse;
+}
+
+/**
+ * @brief Frees a sparse matrix and its buffers.
+ * @param m A pointer to the SparseMatrix to free.
+ */
+void free_sparse_matrix(SparseMatrix* m) {
+  if (m == NULL) {
+    return;
+  }
+  free(m->values);
+  free(m->col_indices);
+  free(m->row_ptr);
+  free(m);
+}
+
+/**
+ * @brief Computes c = a · b + beta * c, reading only the rows of b that match
+ * a non-zero column of a.
+ * @param a The sparse left-hand side (m×k).
+ * @param b The dense right-hand side (k×n).
+ * @param beta Scale of the existing contents of c (0 overwrites them).
+ * @param c The output matrix (m×n), updated in place.
+ */
+void sparse_gemm(const SparseMatrix* a, const Matrix* b, double beta,
+                 Matrix* c) {
+  ASSERT(a != NULL && b != NULL && c != NULL, "Input matrices cannot be NULL.");
+  ASSERT(a->cols == b->rows,
+         "Matrices dimensions are incompatible for dot product.");
+  ASSERT(c->rows == a->rows && c->cols == b->cols,
+         "Output matrix has the wrong shape for dot product.");
+
+  size_t n = b->cols;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < a->rows; i++) {
+    double* c_row = &c->matrix_data[i * n];
+    if (beta == 0.0) {
+      memset(c_row, 0, n * sizeof(double));
+    } else if (beta != 1.0) {
+      for (size_t j = 0; j < n; j++) {
+        c_row[j] *= beta;
+      }
+    }
+    for (size_t p = a->row_ptr[i]; p < a->row_ptr[i + 1]; p++) {
+      double a_ip = a->values[p];
+      const double* b_row = &b->matrix_data[a->col_indices[p] * n];
+      for (size_t j = 0; j < n; j++) {
+        c_row[j] += a_ip * b_row[j];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Computes c = a^T · b + beta * c. Each non-zero a[i][p] adds
+ * a[i][p] * b[i] to row p of c, so only rows of c for non-zero columns of a
+ * receive products.
+ * @param a The sparse matrix (k×m) whose transpose is the left-hand side.
+ * @param b The dense right-hand side (k×n).
+ * @param beta Scale of the existing contents of c (0 overwrites them).
+ * @param c The output matrix (m×n), updated in place.
+ */
+void sparse_gemm_transpose(const SparseMatrix* a, const Matrix* b,
+                           double beta, Matrix* c) {
+  ASSERT(a != NULL && b != NULL && c != NULL, "Input matrices cannot be NULL.");
+  ASSERT(a->rows == b->rows,
+         "Matrices dimensions are incompatible for dot product.");
+  ASSERT(c->rows == a->cols && c->cols == b->cols,
+         "Output matrix has the wrong shape for dot product.");
+
+  size_t n = b->cols;
+  if (beta == 0.0) {
+    memset(c->matrix_data, 0, c->rows * n * sizeof(double));
+  } else if (beta != 1.0) {
+    for (size_t i = 0; i < c->rows * n; i++) {
+      c->matrix_data[i] *= beta;
+    }
+  }
+
+  // Rows of a may share columns, so the scatter stays serial.
+  for (size_t i = 0; i < a->rows; i++) {
+    const double* b_row = &b->matrix_data[i * n];
+    for (size_t p = a->row_ptr[i]; p < a->row_ptr[i + 1]; p++) {
+      double a_ip = a->values[p];
+      double* c_row = &c->matrix_data[a->col_indices[p] * n];
+      for (size_t j = 0; j < n; j++) {
+        c_row[j] += a_ip * b_row[j];
+      }
+    }
+  }
+}
@@ -140,6 +140,70 @@ double binary_cross_entropy(const Matrix* y_hat, const Matrix* y) {
   return loss / total_elements;
 }
 
+/**
+ * @brief Computes softmax cross-entropy directly from logits. Each row takes
+ * one pass to find its maximum and one pass that accumulates the shifted
+ * exponentials (stored in delta when requested) and the target-weighted
+ * logits; the delta row is then normalized while still in cache.
+ * @param logits A pointer to the Matrix of pre-softmax values.
+ * @param y A pointer to the Matrix of targets.
+ * @param delta A pointer to the Matrix receiving softmax(logits) - y, or NULL.
+ * @return The cross-entropy loss averaged over rows.
+ */
+double softmax_cross_entropy(const Matrix* logits, const Matrix* y,
+                             Matrix* delta) {
+  ASSERT(logits->rows == y->rows && logits->cols == y->cols,
+         "Softmax Cross-Entropy: Matrices must have matching dimensions.");
+  ASSERT(delta == NULL ||
+             (delta->rows == logits->rows && delta->cols == logits->cols),
+         "Softmax Cross-Entropy: Delta must match the logits.");
+
+  size_t cols = logits->cols;
+  double loss = 0.0;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for reduction(+ : loss)
+#endif
+  for (size_t r = 0; r < logits->rows; r++) {
+    const double* z = &logits->matrix_data[r * cols];
+    const double* t = &y->matrix_data[r * cols];
+
+    double max = z[0];
+    for (size_t j = 1; j < cols; j++) {
+      if (z[j] > max) {
+        max = z[j];
+      }
+    }
+
+    double sum = 0.0;
+    double target_logit = 0.0;
+    double target_mass = 0.0;
+    for (size_t j = 0; j < cols; j++) {
+      double e = exp(z[j] - max);
+      sum += e;
+      target_logit += t[j] * z[j];
+      target_mass += t[j];
+      if (delta != NULL) {
+        delta->matrix_data[r * cols + j] = e;
+      }
+    }
+
+    // -sum_j t_j * log(softmax_j) = sum(t) * logsumexp(z) - sum_j t_j * z_j
+    double log_sum_exp = max + log(sum);
+    loss += target_mass * log_sum_exp - target_logit;
+
+    if (delta != NULL) {
+      double inv_sum = 1.0 / sum;
+      double* d = &delta->matrix_data[r * cols];
+      for (size_t j = 0; j < cols; j++) {
+        d[j] = d[j] * inv_sum - t[j];
+      }
+    }
+  }
+
+  return loss / logits->rows;
+}
+
 /**
  * @brief Computes the gradient of the Mean Squared Error (MSE) loss with
  * respect to the predicted values.
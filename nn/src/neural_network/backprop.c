@@ -4,15 +4,22 @@
  */
 #include "backprop.h"
 
+#include <math.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "activation.h"
+#include "batch_norm.h"
 #include "cache.h"
+#include "conv.h"
+#include "dropout.h"
+#include "feedforward.h"
 #include "linalg.h"
 #include "neural_network.h"
+#include "pool.h"
 #include "utils.h"
 
 // Select and compute activation derivative for a layer given its pre-activation
@@ -27,7 +34,7 @@
  * @return A new matrix containing the element-wise derivative of the activation
  * function applied to z.
  */
-static Matrix* activation_derivative_for_layer(const Layer* layer, Matrix* z) {
+Matrix* activation_derivative_for_layer(const Layer* layer, Matrix* z) {
   ASSERT(layer != NULL, "Layer cannot be NULL.");
   ASSERT(z != NULL, "Pre-activation matrix z cannot be NULL.");
 
@@ -53,6 +60,93 @@ static Matrix* activation_derivative_for_layer(const Layer* layer, Matrix* z) {
   }
 }
 
+/**
+ * @brief Computes a layer's weight and bias gradients from its input and
+ * delta: dW = a_prev^T · delta and db = colsum(delta) for a dense layer, the
+ * im2col equivalents for a convolution, nothing for a parameterless
+ * max-pool.
+ * @param layer A pointer to the Layer.
+ * @param a_prev The layer's input.
+ * @param delta dL/dz of the layer.
+ * @param beta 0 to overwrite dW and db, 1 to add to them.
+ * @param dW The weight gradient, or NULL to skip it.
+ * @param db The bias gradient, or NULL to skip it.
+ */
+static void layer_parameter_gradients(const Layer* layer, const Matrix* a_prev,
+                                      const Matrix* delta, double beta,
+                                      Matrix* dW, Matrix* db) {
+  if (layer->conv != NULL) {
+    conv2d_parameter_gradients(layer, a_prev, delta, beta, dW, db);
+    return;
+  }
+  if (layer->pool != NULL) {
+    return;
+  }
+  if (dW != NULL) {
+    gemm_matrix(1, 0, 1.0, a_prev, delta, beta, dW);
+  }
+  if (db != NULL) {
+    sum_matrix_columns_into(delta, beta, db);
+  }
+}
+
+/**
+ * @brief Propagates the cached output delta back through the hidden layers,
+ * caching delta_i for every layer.
+ * @param nn A pointer to the NeuralNetwork with delta of the last layer cached.
+ */
+static void backpropagate_hidden_layers(NeuralNetwork* nn) {
+  size_t last_index = nn->num_layers - 1;
+  for (size_t i = last_index - 1; i != SIZE_MAX; i--) {
+    // delta_{i} = (delta_{i+1} dot W_{i+1}^T) .* a'_i(z_i)
+    char delta_next_key[32];
+    sprintf(delta_next_key, "delta_%zu", i + 1);
+    Matrix* delta_next = cache_get(nn->cache, delta_next_key);
+    ASSERT(delta_next != NULL, "Cached delta for next layer not found.");
+
+    const Layer* next = nn->layers[i + 1];
+    Matrix* W_next = next->weights;
+    ASSERT(W_next != NULL, "Weights for next layer cannot be NULL.");
+
+    Matrix* W_next_T = NULL;
+    Matrix* propagated = NULL;
+    if (next->conv != NULL) {
+      propagated = create_matrix(delta_next->rows, layer_input_size(next));
+      conv2d_input_gradient(next, delta_next, propagated);
+    } else if (next->pool != NULL) {
+      propagated = create_matrix(delta_next->rows, layer_input_size(next));
+      max_pool_input_gradient(nn, i + 1, delta_next, propagated);
+    } else {
+      W_next_T = transpose_matrix(W_next);
+      propagated = dot_matrix(delta_next, W_next_T);
+    }
+
+    char z_key[32];
+    sprintf(z_key, "z_%zu", i);
+    Matrix* z_i = cache_get(nn->cache, z_key);
+    ASSERT(z_i != NULL, "Cached z for layer not found.");
+    Matrix* act_prime_i = activation_derivative_for_layer(nn->layers[i], z_i);
+
+    Matrix* delta_i = multiply_matrix(propagated, act_prime_i);
+    ASSERT(delta_i != NULL, "Failed to compute delta for layer.");
+    dropout_backward(nn, i, delta_i);
+    batch_norm_backward(nn, i, delta_i, 0.0);
+
+    char delta_i_key[32];
+    sprintf(delta_i_key, "delta_%zu", i);
+    cache_put(nn->cache, delta_i_key, delta_i);
+
+    // Clean up
+    free_matrix(delta_next);
+    if (W_next_T != NULL) {
+      free_matrix(W_next_T);
+    }
+    free_matrix(propagated);
+    free_matrix(z_i);
+    free_matrix(act_prime_i);
+  }
+}
+
 void backpropagate(NeuralNetwork* nn, const Matrix* y_true,
                    LossFunctionType loss_type,
                    LossFunctionGrad loss_func_grad) {
@@ -95,6 +189,7 @@ void backpropagate(NeuralNetwork* nn, const Matrix* y_true,
     free_matrix(act_prime_last);
   }
 
+  batch_norm_backward(nn, last_index, delta_last, 0.0);
   char delta_last_key[32];
   sprintf(delta_last_key, "delta_%zu", last_index);
   cache_put(nn->cache, delta_last_key, delta_last);
@@ -102,105 +197,449 @@ void backpropagate(NeuralNetwork* nn, const Matrix* y_true,
   // Clean up temporaries for last layer
   free_matrix(y_hat);
 
-  // Backpropagate through hidden layers
-  for (size_t i = last_index - 1; i != SIZE_MAX; i--) {
-    // delta_{i} = (delta_{i+1} dot W_{i+1}^T) .* a'_i(z_i)
-    char delta_next_key[32];
-    sprintf(delta_next_key, "delta_%zu", i + 1);
-    Matrix* delta_next = cache_get(nn->cache, delta_next_key);
-    ASSERT(delta_next != NULL, "Cached delta for next layer not found.");
+  backpropagate_hidden_layers(nn);
+}
 
-    Matrix* W_next = nn->layers[i + 1]->weights;
-    ASSERT(W_next != NULL, "Weights for next layer cannot be NULL.");
+/**
+ * @brief Fused softmax + cross-entropy backward pass. The output delta and the
+ * loss come from one kernel over the cached logits, so neither the cached
+ * probabilities nor a separate loss pass are needed.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param y_true A pointer to the one-hot targets.
+ * @return The mean cross-entropy loss of the batch.
+ */
+double backpropagate_softmax_cross_entropy(NeuralNetwork* nn,
+                                           const Matrix* y_true) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(nn->cache != NULL, "Cache cannot be NULL.");
+  ASSERT(y_true != NULL, "Ground truth matrix cannot be NULL.");
 
-    Matrix* W_next_T = transpose_matrix(W_next);
-    Matrix* propagated = dot_matrix(delta_next, W_next_T);
+  size_t last_index = nn->num_layers - 1;
+  ASSERT(nn->layers[last_index]->activation_type == SOFTMAX,
+         "Fused softmax cross-entropy requires a SOFTMAX output layer.");
 
-    char z_key[32];
-    sprintf(z_key, "z_%zu", i);
-    Matrix* z_i = cache_get(nn->cache, z_key);
-    ASSERT(z_i != NULL, "Cached z for layer not found.");
-    Matrix* act_prime_i = activation_derivative_for_layer(nn->layers[i], z_i);
+  char z_last_key[32];
+  sprintf(z_last_key, "z_%zu", last_index);
+  Matrix* z_last = cache_get(nn->cache, z_last_key);
+  ASSERT(z_last != NULL, "Cached z for last layer not found.");
 
-    Matrix* delta_i = multiply_matrix(propagated, act_prime_i);
-    ASSERT(delta_i != NULL, "Failed to compute delta for layer.");
+  Matrix* delta_last = create_matrix(z_last->rows, z_last->cols);
+  double loss = softmax_cross_entropy(z_last, y_true, delta_last);
+  free_matrix(z_last);
+  batch_norm_backward(nn, last_index, delta_last, 0.0);
 
-    char delta_i_key[32];
-    sprintf(delta_i_key, "delta_%zu", i);
-    cache_put(nn->cache, delta_i_key, delta_i);
+  char delta_last_key[32];
+  sprintf(delta_last_key, "delta_%zu", last_index);
+  cache_put(nn->cache, delta_last_key, delta_last);
 
-    // Clean up
-    free_matrix(delta_next);
-    free_matrix(W_next_T);
-    free_matrix(propagated);
-    free_matrix(z_i);
-    free_matrix(act_prime_i);
+  backpropagate_hidden_layers(nn);
+  return loss;
+}
+
+/**
+ * @brief Computes delta of the output layer from borrowed cache entries.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param y_true A pointer to the targets.
+ * @param loss_type The loss type; SOFTMAX with CCE uses the fused kernel.
+ * @param loss_func_grad The gradient of the loss.
+ * @return A new matrix holding dL/dz of the output layer.
+ */
+static Matrix* output_layer_delta(const NeuralNetwork* nn, const Matrix* y_true,
+                                  LossFunctionType loss_type,
+                                  LossFunctionGrad loss_func_grad) {
+  size_t last_index = nn->num_layers - 1;
+  const Layer* last_layer = nn->layers[last_index];
+
+  char z_key[32];
+  sprintf(z_key, "z_%zu", last_index);
+  const Matrix* z_last = cache_peek(nn->cache, z_key);
+  ASSERT(z_last != NULL, "Cached z for last layer not found.");
+
+  Matrix* delta = create_matrix(z_last->rows, z_last->cols);
+  if (last_layer->activation_type == SOFTMAX && loss_type == CCE) {
+    softmax_cross_entropy(z_last, y_true, delta);
+    return delta;
   }
+
+  char a_key[32];
+  sprintf(a_key, "a_%zu", last_index);
+  const Matrix* y_hat = cache_peek(nn->cache, a_key);
+  ASSERT(y_hat != NULL, "Cached prediction (y_hat) not found.");
+
+  Matrix* dL_da = loss_func_grad(y_hat, y_true);
+  ASSERT(dL_da != NULL, "Loss gradient returned NULL.");
+  Matrix* act_prime =
+      activation_derivative_for_layer(last_layer, (Matrix*)z_last);
+  for (size_t i = 0; i < delta->rows * delta->cols; i++) {
+    delta->matrix_data[i] = dL_da->matrix_data[i] * act_prime->matrix_data[i];
+  }
+  free_matrix(dL_da);
+  free_matrix(act_prime);
+  return delta;
 }
 
 /**
- * @brief Calculates the gradient of the weights for a specific layer during
- * backpropagation.
- * @param cache A pointer to the Cache containing intermediate values.
- * @param layer_index The index of the current layer.
- * @param total_layers The total number of layers in the neural network.
- * @return A new matrix representing the gradient of the weights for the
- * specified layer.
+ * @brief Backward pass that produces each layer's weight and bias gradients
+ * as soon as its delta is known, from the last layer to the first. Cached
+ * activations are borrowed rather than copied, deltas are never cached, and
+ * the delta of layer i-1 is derived before the callback runs so the callback
+ * may update layer i in place.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param sparse_input The CSR input given to feedforward_sparse, or NULL to
+ * read the dense input from the cache.
+ * @param y_true A pointer to the targets.
+ * @param loss_type The loss type; SOFTMAX with CCE uses the fused kernel.
+ * @param loss_func_grad The gradient of the loss.
+ * @param grads Gradient buffers to fill, or NULL to use per-layer scratch.
+ * @param beta 0 to overwrite `grads`, 1 to add to them (ignored without
+ * `grads`).
+ * @param callback Called once per layer with its gradients, or NULL.
+ * @param user_data Passed through to the callback.
+ */
+static void backward_pass(NeuralNetwork* nn, const SparseMatrix* sparse_input,
+                          const Matrix* y_true, LossFunctionType loss_type,
+                          LossFunctionGrad loss_func_grad,
+                          NetworkGradients* grads, double beta,
+                          LayerGradientCallback callback, void* user_data) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(nn->cache != NULL, "Cache cannot be NULL.");
+  ASSERT(y_true != NULL, "Ground truth matrix cannot be NULL.");
+  ASSERT(loss_func_grad != NULL, "Loss gradient function cannot be NULL.");
+  ASSERT(grads == NULL || grads->num_layers == nn->num_layers,
+         "Gradients do not match the network.");
+  if (grads == NULL) {
+    beta = 0.0;  // Per-layer scratch starts uninitialized.
+  }
+
+  Matrix* delta = output_layer_delta(nn, y_true, loss_type, loss_func_grad);
+
+  for (size_t i = nn->num_layers - 1; i != SIZE_MAX; i--) {
+    Layer* layer = nn->layers[i];
+    ASSERT(grads == NULL || grads->batch_norm[i] == layer->batch_norm,
+           "Batch normalization changed since the gradients were created.");
+    batch_norm_backward(nn, i, delta, beta);
+
+    Matrix* dW = (grads != NULL) ? grads->weights[i]
+                                 : create_matrix(layer->weights->rows,
+                                                 layer->weights->cols);
+    Matrix* db = (grads != NULL)
+                     ? grads->bias[i]
+                     : create_matrix(layer->bias->rows, layer->bias->cols);
+    if (i == 0 && sparse_input != NULL) {
+      // Only weight rows of non-zero features receive products.
+      sparse_gemm_transpose(sparse_input, delta, beta, dW);
+      sum_matrix_columns_into(delta, beta, db);
+    } else {
+      const Matrix* a_prev = NULL;
+      if (i == 0) {
+        a_prev = cache_peek(nn->cache, "input");
+      } else {
+        char a_prev_key[32];
+        sprintf(a_prev_key, "a_%zu", i - 1);
+        a_prev = cache_peek(nn->cache, a_prev_key);
+      }
+      ASSERT(a_prev != NULL, "Cached previous activation/input not found.");
+      layer_parameter_gradients(layer, a_prev, delta, beta, dW, db);
+    }
+
+    // delta_{i-1} = (delta_i · W_i^T) .* a'_{i-1}(z_{i-1}), before W_i changes.
+    Matrix* delta_prev = NULL;
+    if (i > 0) {
+      delta_prev = create_matrix(delta->rows, layer_input_size(layer));
+      if (layer->conv != NULL) {
+        conv2d_input_gradient(layer, delta, delta_prev);
+      } else if (layer->pool != NULL) {
+        max_pool_input_gradient(nn, i, delta, delta_prev);
+      } else {
+        gemm_matrix(0, 1, 1.0, delta, layer->weights, 0.0, delta_prev);
+      }
+
+      char z_key[32];
+      sprintf(z_key, "z_%zu", i - 1);
+      const Matrix* z_prev = cache_peek(nn->cache, z_key);
+      ASSERT(z_prev != NULL, "Cached z for layer not found.");
+      Matrix* act_prime =
+          activation_derivative_for_layer(nn->layers[i - 1], (Matrix*)z_prev);
+      for (size_t j = 0; j < delta_prev->rows * delta_prev->cols; j++) {
+        delta_prev->matrix_data[j] *= act_prime->matrix_data[j];
+      }
+      free_matrix(act_prime);
+      dropout_backward(nn, i - 1, delta_prev);
+    }
+
+    if (callback != NULL) {
+      callback(i, layer, dW, db, user_data);
+    }
+
+    if (grads == NULL) {
+      free_matrix(dW);
+      free_matrix(db);
+    }
+    free_matrix(delta);
+    delta = delta_prev;
+  }
+}
+
+/**
+ * @brief Single backward pass that overwrites `grads` (if given) with this
+ * batch's gradients and passes each layer's gradients to `callback`.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param y_true A pointer to the targets.
+ * @param loss_type The loss type; SOFTMAX with CCE uses the fused kernel.
+ * @param loss_func_grad The gradient of the loss.
+ * @param grads Gradient buffers to fill, or NULL to use per-layer scratch.
+ * @param callback Called once per layer with its gradients, or NULL.
+ * @param user_data Passed through to the callback.
  */
-Matrix* calculate_weight_gradient(const Cache* cache, size_t layer_index,
-                                  size_t total_layers) {
-  ASSERT(cache != NULL, "Cache cannot be NULL.");
-  ASSERT(layer_index < total_layers, "layer_index out of bounds.");
+void backpropagate_gradients(NeuralNetwork* nn, const Matrix* y_true,
+                             LossFunctionType loss_type,
+                             LossFunctionGrad loss_func_grad,
+                             NetworkGradients* grads,
+                             LayerGradientCallback callback, void* user_data) {
+  backward_pass(nn, NULL, y_true, loss_type, loss_func_grad, grads, 0.0,
+                callback, user_data);
+}
 
-  // Get activation of previous layer (or input)
+/**
+ * @brief Single backward pass after feedforward_sparse. The first layer's
+ * weight gradient is a transposed sparse-dense product over the CSR input.
+ * @param nn A pointer to the NeuralNetwork after feedforward_sparse.
+ * @param input The sparse input given to feedforward_sparse.
+ * @param y_true A pointer to the targets.
+ * @param loss_type The loss type; SOFTMAX with CCE uses the fused kernel.
+ * @param loss_func_grad The gradient of the loss.
+ * @param grads Gradient buffers to fill, or NULL to use per-layer scratch.
+ * @param callback Called once per layer with its gradients, or NULL.
+ * @param user_data Passed through to the callback.
+ */
+void backpropagate_gradients_sparse(NeuralNetwork* nn,
+                                    const SparseMatrix* input,
+                                    const Matrix* y_true,
+                                    LossFunctionType loss_type,
+                                    LossFunctionGrad loss_func_grad,
+                                    NetworkGradients* grads,
+                                    LayerGradientCallback callback,
+                                    void* user_data) {
+  ASSERT(input != NULL, "Sparse input cannot be NULL.");
+  ASSERT(input->rows == y_true->rows,
+         "Inputs and targets must have the same rows.");
+  backward_pass(nn, input, y_true, loss_type, loss_func_grad, grads, 0.0,
+                callback, user_data);
+}
+
+/**
+ * @brief Single backward pass that adds this micro-batch's gradients to
+ * `grads`. The GEMM and column sums accumulate straight into the persistent
+ * buffers (beta = 1), so no per-step gradient matrices are allocated.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param y_true A pointer to the targets.
+ * @param loss_type The loss type; SOFTMAX with CCE uses the fused kernel.
+ * @param loss_func_grad The gradient of the loss.
+ * @param grads The NetworkGradients to accumulate into.
+ */
+void backpropagate_accumulate(NeuralNetwork* nn, const Matrix* y_true,
+                              LossFunctionType loss_type,
+                              LossFunctionGrad loss_func_grad,
+                              NetworkGradients* grads) {
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+  backward_pass(nn, NULL, y_true, loss_type, loss_func_grad, grads, 1.0, NULL,
+                NULL);
+}
+
+/**
+ * @brief Computes one layer's weight and bias gradients from the values
+ * cached by backpropagate, writing into existing buffers.
+ * @param nn A pointer to the NeuralNetwork after backpropagate.
+ * @param layer_index The index of the layer.
+ * @param dW The weight gradient, or NULL to skip it.
+ * @param db The bias gradient, or NULL to skip it.
+ */
+static void cached_parameter_gradients(const NeuralNetwork* nn,
+                                       size_t layer_index, Matrix* dW,
+                                       Matrix* db) {
+  // The bias gradient needs only the delta.
   Matrix* a_prev = NULL;
-  if (layer_index == 0) {
-    a_prev = cache_get((Cache*)cache, "input");
-  } else {
-    char a_prev_key[32];
-    sprintf(a_prev_key, "a_%zu", layer_index - 1);
-    a_prev = cache_get((Cache*)cache, a_prev_key);
+  if (dW != NULL) {
+    if (layer_index == 0) {
+      a_prev = cache_get(nn->cache, "input");
+    } else {
+      char a_prev_key[32];
+      sprintf(a_prev_key, "a_%zu", layer_index - 1);
+      a_prev = cache_get(nn->cache, a_prev_key);
+    }
+    ASSERT(a_prev != NULL, "Cached previous activation/input not found.");
   }
-  ASSERT(a_prev != NULL, "Cached previous activation/input not found.");
 
-  // Get delta for current layer
   char delta_key[32];
   sprintf(delta_key, "delta_%zu", layer_index);
-  Matrix* delta_i = cache_get((Cache*)cache, delta_key);
+  Matrix* delta_i = cache_get(nn->cache, delta_key);
   ASSERT(delta_i != NULL, "Cached delta for layer not found.");
 
-  Matrix* a_prev_T = transpose_matrix(a_prev);
-  Matrix* grad_W = dot_matrix(a_prev_T, delta_i);
+  layer_parameter_gradients(nn->layers[layer_index], a_prev, delta_i, 0.0, dW,
+                            db);
 
-  // Clean up
-  free_matrix(a_prev);
+  if (a_prev != NULL) {
+    free_matrix(a_prev);
+  }
   free_matrix(delta_i);
-  free_matrix(a_prev_T);
+}
+
+/**
+ * @brief Calculates the gradient of the weights for a specific layer during
+ * backpropagation.
+ * @param nn A pointer to the NeuralNetwork after backpropagate.
+ * @param layer_index The index of the current layer.
+ * @return A new matrix representing the gradient of the weights for the
+ * specified layer.
+ */
+Matrix* calculate_weight_gradient(const NeuralNetwork* nn,
+                                  size_t layer_index) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(layer_index < nn->num_layers, "layer_index out of bounds.");
+
+  const Layer* layer = nn->layers[layer_index];
+  Matrix* dW = create_matrix(layer->weights->rows, layer->weights->cols);
+  cached_parameter_gradients(nn, layer_index, dW, NULL);
 
-  return grad_W;
+  return dW;
 }
 
 /**
  * @brief Calculates the gradient of the biases for a specific layer during
  * backpropagation.
- * @param cache A pointer to the Cache containing intermediate values.
+ * @param nn A pointer to the NeuralNetwork after backpropagate.
  * @param layer_index The index of the current layer.
- * @param total_layers The total number of layers in the neural network.
  * @return A new matrix representing the gradient of the biases for the
  * specified layer.
  */
-Matrix* calculate_bias_gradient(const Cache* cache, size_t layer_index,
-                                size_t total_layers) {
-  ASSERT(cache != NULL, "Cache cannot be NULL.");
-  ASSERT(layer_index < total_layers, "layer_index out of bounds.");
-
-  char delta_key[32];
-  sprintf(delta_key, "delta_%zu", layer_index);
-  Matrix* delta_i = cache_get((Cache*)cache, delta_key);
-  ASSERT(delta_i != NULL, "Cached delta for layer not found.");
+Matrix* calculate_bias_gradient(const NeuralNetwork* nn, size_t layer_index) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(layer_index < nn->num_layers, "layer_index out of bounds.");
 
-  Matrix* db = sum_matrix_columns(delta_i);
-  free_matrix(delta_i);
+  const Layer* layer = nn->layers[layer_index];
+  Matrix* db = create_matrix(layer->bias->rows, layer->bias->cols);
+  cached_parameter_gradients(nn, layer_index, NULL, db);
 
   return db;
 }
+
+/**
+ * @brief Allocates contiguous, zeroed gradient buffers shaped like a network's
+ * layers.
+ * @param nn A pointer to the NeuralNetwork whose shapes are mirrored.
+ * @return A pointer to the new NetworkGradients, or NULL if allocation fails.
+ */
+NetworkGradients* create_gradients(const NeuralNetwork* nn) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+
+  NetworkGradients* grads = (NetworkGradients*)malloc(sizeof(NetworkGradients));
+  CHECK_ALLOC(grads);
+  grads->num_layers = nn->num_layers;
+  grads->size = 0;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    grads->size += layer->weights->rows * layer->weights->cols +
+                   layer->bias->rows * layer->bias->cols;
+  }
+
+  grads->weights = (Matrix**)calloc(nn->num_layers, sizeof(Matrix*));
+  grads->bias = (Matrix**)calloc(nn->num_layers, sizeof(Matrix*));
+  grads->batch_norm = (BatchNorm**)calloc(nn->num_layers, sizeof(BatchNorm*));
+  // Same alignment as the contiguous parameters the gradients mirror.
+  grads->data = create_parameter_buffer(grads->size);
+  if (grads->weights == NULL || grads->bias == NULL ||
+      grads->batch_norm == NULL || grads->data == NULL) {
+    LOG_ERROR("Memory allocation failed for gradient buffers.");
+    free_gradients(grads);
+    return NULL;
+  }
+
+  double* cursor = grads->data;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    grads->weights[i] =
+        create_matrix_view(cursor, layer->weights->rows, layer->weights->cols);
+    cursor += layer->weights->rows * layer->weights->cols;
+    grads->bias[i] =
+        create_matrix_view(cursor, layer->bias->rows, layer->bias->cols);
+    cursor += layer->bias->rows * layer->bias->cols;
+    grads->batch_norm[i] = layer->batch_norm;
+  }
+  return grads;
+}
+
+/**
+ * @brief Sets every gradient to zero, including the scale and shift gradients
+ * of the batch normalizations the gradients were created for.
+ * @param grads A pointer to the NetworkGradients to clear.
+ */
+void zero_gradients(NetworkGradients* grads) {
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+  memset(grads->data, 0, grads->size * sizeof(double));
+  for (size_t i = 0; i < grads->num_layers; i++) {
+    BatchNorm* bn = grads->batch_norm[i];
+    if (bn != NULL) {
+      fill_matrix(bn->grad_gamma, 0.0);
+      fill_matrix(bn->grad_beta, 0.0);
+    }
+  }
+}
+
+/**
+ * @brief Computes every layer's weight and bias gradients from the values
+ * cached by backpropagate, writing into existing buffers.
+ * @param nn A pointer to the NeuralNetwork after backpropagate.
+ * @param grads A pointer to the NetworkGradients to fill.
+ */
+void compute_gradients(const NeuralNetwork* nn, NetworkGradients* grads) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+  ASSERT(grads->num_layers == nn->num_layers,
+         "Gradients do not match the network.");
+
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    cached_parameter_gradients(nn, i, grads->weights[i], grads->bias[i]);
+  }
+}
+
+/**
+ * @brief Computes the L2 norm of all gradients in a single pass over the
+ * contiguous buffer.
+ * @param grads A pointer to the NetworkGradients.
+ * @return The L2 norm.
+ */
+double gradient_l2_norm(const NetworkGradients* grads) {
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+
+  double sum = 0.0;
+#ifdef USE_OPENMP
+#pragma omp parallel for simd reduction(+ : sum)
+#endif
+  for (size_t i = 0; i < grads->size; i++) {
+    sum += grads->data[i] * grads->data[i];
+  }
+  return sqrt(sum);
+}
+
+/**
+ * @brief Frees gradient buffers and their per-layer views.
+ * @param grads A pointer to the NetworkGradients to free.
+ */
+void free_gradients(NetworkGradients* grads) {
+  if (grads == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < grads->num_layers; i++) {
+    if (grads->weights != NULL) {
+      free_matrix_view(grads->weights[i]);
+    }
+    if (grads->bias != NULL) {
+      free_matrix_view(grads->bias[i]);
+    }
+  }
+  free(grads->weights);
+  free(grads->bias);
+  free(grads->batch_norm);
+  free(grads->data);
+  free(grads);
+}
@@ -0,0 +1,339 @@
+/**
+ * @file batch_norm.c
+ * @brief Batch normalization forward/backward kernels and weight folding.
+ */
+#include "batch_norm.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/**
+ * @brief Creates batch normalization for a layer's outputs.
+ * @param features The number of outputs (D_out).
+ * @return A pointer to the new BatchNorm, or NULL if allocation fails.
+ */
+BatchNorm* create_batch_norm(size_t features) {
+  ASSERT(features > 0, "Batch normalization needs at least one feature.");
+
+  BatchNorm* bn = (BatchNorm*)calloc(1, sizeof(BatchNorm));
+  CHECK_ALLOC(bn);
+  bn->gamma = create_matrix(1, features);
+  bn->beta = create_matrix(1, features);
+  bn->running_mean = create_matrix(1, features);
+  bn->running_var = create_matrix(1, features);
+  bn->grad_gamma = create_matrix(1, features);
+  bn->grad_beta = create_matrix(1, features);
+  if (bn->gamma == NULL || bn->beta == NULL || bn->running_mean == NULL ||
+      bn->running_var == NULL || bn->grad_gamma == NULL ||
+      bn->grad_beta == NULL) {
+    LOG_ERROR("Memory allocation failed for batch normalization.");
+    free_batch_norm(bn);
+    return NULL;
+  }
+  fill_matrix(bn->gamma, 1.0);
+  fill_matrix(bn->beta, 0.0);
+  fill_matrix(bn->running_mean, 0.0);
+  fill_matrix(bn->running_var, 1.0);
+  fill_matrix(bn->grad_gamma, 0.0);
+  fill_matrix(bn->grad_beta, 0.0);
+  bn->momentum = BATCH_NORM_MOMENTUM;
+  bn->epsilon = BATCH_NORM_EPSILON;
+  return bn;
+}
+
+/**
+ * @brief Creates a deep copy of batch normalization state.
+ * @param bn A pointer to the BatchNorm to copy, or NULL.
+ * @return A pointer to the copy, or NULL.
+ */
+BatchNorm* copy_batch_norm(const BatchNorm* bn) {
+  if (bn == NULL) {
+    return NULL;
+  }
+  BatchNorm* copy = create_batch_norm(bn->gamma->cols);
+  CHECK_ALLOC(copy);
+  size_t bytes = bn->gamma->cols * sizeof(double);
+  memcpy(copy->gamma->matrix_data, bn->gamma->matrix_data, bytes);
+  memcpy(copy->beta->matrix_data, bn->beta->matrix_data, bytes);
+  memcpy(copy->running_mean->matrix_data, bn->running_mean->matrix_data,
+         bytes);
+  memcpy(copy->running_var->matrix_data, bn->running_var->matrix_data, bytes);
+  memcpy(copy->grad_gamma->matrix_data, bn->grad_gamma->matrix_data, bytes);
+  memcpy(copy->grad_beta->matrix_data, bn->grad_beta->matrix_data, bytes);
+  copy->momentum = bn->momentum;
+  copy->epsilon = bn->epsilon;
+  return copy;
+}
+
+/**
+ * @brief Frees batch normalization state.
+ * @param bn A pointer to the BatchNorm to free.
+ */
+void free_batch_norm(BatchNorm* bn) {
+  if (bn == NULL) {
+    return;
+  }
+  free_matrix(bn->gamma);
+  free_matrix(bn->beta);
+  free_matrix(bn->running_mean);
+  free_matrix(bn->running_var);
+  free_matrix(bn->grad_gamma);
+  free_matrix(bn->grad_beta);
+  free(bn);
+}
+
+/**
+ * @brief Computes per-column mean and biased variance in one pass over the
+ * rows. Each row updates every column's running mean and sum of squared
+ * deviations, so the inner loop is contiguous and vectorizes.
+ * @param z A pointer to the input matrix.
+ * @param mean Receives the column means.
+ * @param var Receives the column variances.
+ */
+void batch_norm_statistics(const Matrix* z, double* mean, double* var) {
+  ASSERT(z != NULL && z->rows > 0, "Statistics need a non-empty matrix.");
+  size_t cols = z->cols;
+  memset(mean, 0, cols * sizeof(double));
+  memset(var, 0, cols * sizeof(double));
+
+  for (size_t r = 0; r < z->rows; r++) {
+    const double* row = z->matrix_data + r * cols;
+    double inv_count = 1.0 / (double)(r + 1);
+#ifdef USE_OPENMP
+#pragma omp simd
+#endif
+    for (size_t j = 0; j < cols; j++) {
+      double delta = row[j] - mean[j];
+      mean[j] += delta * inv_count;
+      var[j] += delta * (row[j] - mean[j]);
+    }
+  }
+  for (size_t j = 0; j < cols; j++) {
+    var[j] /= (double)z->rows;
+  }
+}
+
+/**
+ * @brief Normalizes z in place: xhat = (z - mean) * inv_std and
+ * z = gamma * xhat + beta.
+ * @param bn The batch normalization parameters.
+ * @param z The pre-activation, updated in place.
+ * @param mean The per-column mean.
+ * @param inv_std The per-column 1 / sqrt(var + epsilon).
+ * @param xhat Receives the normalized values, or NULL.
+ */
+static void normalize(const BatchNorm* bn, Matrix* z, const double* mean,
+                      const double* inv_std, Matrix* xhat) {
+  size_t cols = z->cols;
+  const double* gamma = bn->gamma->matrix_data;
+  const double* beta = bn->beta->matrix_data;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t r = 0; r < z->rows; r++) {
+    double* row = z->matrix_data + r * cols;
+    for (size_t j = 0; j < cols; j++) {
+      double x = (row[j] - mean[j]) * inv_std[j];
+      if (xhat != NULL) {
+        xhat->matrix_data[r * cols + j] = x;
+      }
+      row[j] = gamma[j] * x + beta[j];
+    }
+  }
+}
+
+/**
+ * @brief Normalizes a layer's pre-activation and caches xhat and inv_std.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param layer_index The layer index.
+ * @param z The layer's pre-activation, updated in place.
+ */
+void batch_norm_forward(const NeuralNetwork* nn, size_t layer_index,
+                        Matrix* z) {
+  BatchNorm* bn = nn->layers[layer_index]->batch_norm;
+  if (bn == NULL) {
+    return;
+  }
+  size_t cols = z->cols;
+  ASSERT(cols == bn->gamma->cols, "Batch normalization width mismatch.");
+
+  Matrix* inv_std = create_matrix(1, cols);
+  Matrix* xhat = create_matrix(z->rows, cols);
+  CHECK_MALLOC(inv_std, "Failed to allocate batch normalization buffers.");
+  CHECK_MALLOC(xhat, "Failed to allocate batch normalization buffers.");
+
+  if (nn->training) {
+    double* mean = (double*)malloc(2 * cols * sizeof(double));
+    CHECK_MALLOC(mean, "Failed to allocate batch statistics.");
+    double* var = mean + cols;
+    batch_norm_statistics(z, mean, var);
+
+    // Running variance is the unbiased estimate, as at inference time the
+    // batch is a sample of the population.
+    double correction =
+        z->rows > 1 ? (double)z->rows / (double)(z->rows - 1) : 1.0;
+    for (size_t j = 0; j < cols; j++) {
+      inv_std->matrix_data[j] = 1.0 / sqrt(var[j] + bn->epsilon);
+      bn->running_mean->matrix_data[j] +=
+          bn->momentum * (mean[j] - bn->running_mean->matrix_data[j]);
+      bn->running_var->matrix_data[j] +=
+          bn->momentum *
+          (var[j] * correction - bn->running_var->matrix_data[j]);
+    }
+    normalize(bn, z, mean, inv_std->matrix_data, xhat);
+    free(mean);
+  } else {
+    for (size_t j = 0; j < cols; j++) {
+      inv_std->matrix_data[j] =
+          1.0 / sqrt(bn->running_var->matrix_data[j] + bn->epsilon);
+    }
+    normalize(bn, z, bn->running_mean->matrix_data, inv_std->matrix_data,
+              xhat);
+  }
+
+  char key[32];
+  sprintf(key, "bn_xhat_%zu", layer_index);
+  cache_put(nn->cache, key, xhat);
+  sprintf(key, "bn_inv_std_%zu", layer_index);
+  cache_put(nn->cache, key, inv_std);
+}
+
+/**
+ * @brief Normalizes with the running averages, without caching.
+ * @param bn A pointer to the BatchNorm.
+ * @param z The pre-activation, updated in place.
+ */
+void batch_norm_inference(const BatchNorm* bn, Matrix* z) {
+  ASSERT(bn != NULL, "Batch normalization cannot be NULL.");
+  ASSERT(z->cols == bn->gamma->cols, "Batch normalization width mismatch.");
+
+  double* inv_std = (double*)malloc(z->cols * sizeof(double));
+  CHECK_MALLOC(inv_std, "Failed to allocate batch normalization buffer.");
+  for (size_t j = 0; j < z->cols; j++) {
+    inv_std[j] = 1.0 / sqrt(bn->running_var->matrix_data[j] + bn->epsilon);
+  }
+  normalize(bn, z, bn->running_mean->matrix_data, inv_std, NULL);
+  free(inv_std);
+}
+
+/**
+ * @brief Back-propagates through a layer's batch normalization.
+ *
+ * With g = dL/dz_out, dbeta = sum(g) and dgamma = sum(g * xhat) over the
+ * batch, training mode gives dL/dz_in = gamma * inv_std / N *
+ * (N * g - dbeta - xhat * dgamma); inference mode is a fixed affine map, so
+ * dL/dz_in = g * gamma * inv_std.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param layer_index The layer index.
+ * @param delta dL/dz of the normalized pre-activation, updated in place.
+ * @param beta 0 to overwrite the parameter gradients, 1 to add to them.
+ */
+void batch_norm_backward(const NeuralNetwork* nn, size_t layer_index,
+                         Matrix* delta, double beta) {
+  BatchNorm* bn = nn->layers[layer_index]->batch_norm;
+  if (bn == NULL) {
+    return;
+  }
+  char key[32];
+  sprintf(key, "bn_xhat_%zu", layer_index);
+  const Matrix* xhat = cache_peek(nn->cache, key);
+  sprintf(key, "bn_inv_std_%zu", layer_index);
+  const Matrix* inv_std = cache_peek(nn->cache, key);
+  ASSERT(xhat != NULL && inv_std != NULL,
+         "Cached batch normalization values not found.");
+  ASSERT(xhat->rows == delta->rows && xhat->cols == delta->cols,
+         "Delta does not match the cached batch.");
+
+  size_t rows = delta->rows;
+  size_t cols = delta->cols;
+  double* sums = (double*)calloc(2 * cols, sizeof(double));
+  CHECK_MALLOC(sums, "Failed to allocate batch normalization sums.");
+  double* dbeta = sums;
+  double* dgamma = sums + cols;
+  for (size_t r = 0; r < rows; r++) {
+    const double* g = delta->matrix_data + r * cols;
+    const double* x = xhat->matrix_data + r * cols;
+    for (size_t j = 0; j < cols; j++) {
+      dbeta[j] += g[j];
+      dgamma[j] += g[j] * x[j];
+    }
+  }
+  for (size_t j = 0; j < cols; j++) {
+    bn->grad_beta->matrix_data[j] =
+        beta * bn->grad_beta->matrix_data[j] + dbeta[j];
+    bn->grad_gamma->matrix_data[j] =
+        beta * bn->grad_gamma->matrix_data[j] + dgamma[j];
+  }
+
+  const double* gamma = bn->gamma->matrix_data;
+  const double* s = inv_std->matrix_data;
+  double n = (double)rows;
+  int training = nn->training;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t r = 0; r < rows; r++) {
+    double* g = delta->matrix_data + r * cols;
+    const double* x = xhat->matrix_data + r * cols;
+    for (size_t j = 0; j < cols; j++) {
+      if (training) {
+        g[j] = gamma[j] * s[j] / n * (n * g[j] - dbeta[j] - x[j] * dgamma[j]);
+      } else {
+        g[j] *= gamma[j] * s[j];
+      }
+    }
+  }
+  free(sums);
+}
+
+/**
+ * @brief Folds a layer's inference-mode normalization into its weights and
+ * bias and frees it.
+ * @param layer A pointer to the Layer.
+ */
+void fold_batch_norm(Layer* layer) {
+  ASSERT(layer != NULL, "Layer cannot be NULL.");
+  ASSERT(layer->conv == NULL && layer->pool == NULL,
+         "Only dense layers can fold batch normalization.");
+  BatchNorm* bn = layer->batch_norm;
+  if (bn == NULL) {
+    return;
+  }
+  Matrix* w = layer->weights;
+  double* scale = (double*)malloc(w->cols * sizeof(double));
+  CHECK_MALLOC(scale, "Failed to allocate folding scales.");
+  for (size_t j = 0; j < w->cols; j++) {
+    scale[j] = bn->gamma->matrix_data[j] /
+               sqrt(bn->running_var->matrix_data[j] + bn->epsilon);
+    double* b = &layer->bias->matrix_data[j];
+    *b = (*b - bn->running_mean->matrix_data[j]) * scale[j] +
+         bn->beta->matrix_data[j];
+  }
+  for (size_t r = 0; r < w->rows; r++) {
+    double* row = w->matrix_data + r * w->cols;
+    for (size_t j = 0; j < w->cols; j++) {
+      row[j] *= scale[j];
+    }
+  }
+  free(scale);
+  free_batch_norm(bn);
+  layer->batch_norm = NULL;
+}
+
+/**
+ * @brief Folds every layer's batch normalization into its weights.
+ * @param nn A pointer to the NeuralNetwork.
+ */
+void fold_network_batch_norm(NeuralNetwork* nn) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    fold_batch_norm(nn->layers[i]);
+  }
+}
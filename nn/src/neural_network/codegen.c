@@ -0,0 +1,221 @@
+/**
+ * @file codegen.c
+ * @brief Generation of shape-specialized C source from a trained network.
+ */
+#include "codegen.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "activation.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/**
+ * @brief Checks that a string is a valid C identifier.
+ * @param name The candidate identifier.
+ * @return 1 if valid, 0 otherwise.
+ */
+static int is_c_identifier(const char* name) {
+  if (name == NULL || name[0] == '\0' ||
+      !(isalpha((unsigned char)name[0]) || name[0] == '_')) {
+    return 0;
+  }
+  for (size_t i = 1; name[i] != '\0'; i++) {
+    if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Writes one value as a C constant. Non-finite values use the
+ * `<math.h>` macros, since printf spells them as `nan` and `inf`.
+ * @param stream The output stream.
+ * @param value The value to emit.
+ */
+static void emit_double(FILE* stream, double value) {
+  if (isnan(value)) {
+    fprintf(stream, "NAN");
+  } else if (isinf(value)) {
+    fprintf(stream, "%sINFINITY", value < 0.0 ? "-" : "");
+  } else {
+    fprintf(stream, "%.17g", value);
+  }
+}
+
+/**
+ * @brief Writes a row-major matrix as the initializer of a static const array.
+ * @param stream The output stream.
+ * @param prefix Symbol prefix.
+ * @param name Array name suffix.
+ * @param m The matrix to emit.
+ */
+static void emit_array(FILE* stream, const char* prefix, const char* name,
+                       const Matrix* m) {
+  size_t total_elements = m->rows * m->cols;
+  fprintf(stream, "static const double %s_%s[%zu] = {", prefix, name,
+          total_elements);
+  for (size_t i = 0; i < total_elements; i++) {
+    fprintf(stream, "%s", (i % 4 == 0) ? "\n    " : " ");
+    emit_double(stream, m->matrix_data[i]);
+    fprintf(stream, ",");
+  }
+  fprintf(stream, "\n};\n\n");
+}
+
+/**
+ * @brief Writes the statement applying a layer's activation to `z`, storing
+ * the result in `out`. Both buffers have `n` elements.
+ * @param stream The output stream.
+ * @param layer The layer whose activation is emitted.
+ * @param n The layer width.
+ * @param z Name of the pre-activation buffer.
+ * @param out Name of the destination buffer.
+ */
+static void emit_activation(FILE* stream, const Layer* layer, size_t n,
+                            const char* z, const char* out) {
+  if (layer->activation_type == SOFTMAX) {
+    fprintf(stream,
+            "  {\n"
+            "    double max_val = %s[0];\n"
+            "    for (int j = 1; j < %zu; j++) {\n"
+            "      if (%s[j] > max_val) max_val = %s[j];\n"
+            "    }\n"
+            "    double sum = 0.0;\n"
+            "    for (int j = 0; j < %zu; j++) {\n"
+            "      %s[j] = exp(%s[j] - max_val);\n"
+            "      sum += %s[j];\n"
+            "    }\n"
+            "    for (int j = 0; j < %zu; j++) {\n"
+            "      %s[j] /= sum;\n"
+            "    }\n"
+            "  }\n",
+            z, n, z, z, n, out, z, out, n, out);
+    return;
+  }
+
+  fprintf(stream, "  for (int j = 0; j < %zu; j++) {\n    %s[j] = ", n, out);
+  switch (layer->activation_type) {
+    case SIGMOID:
+      fprintf(stream, "1.0 / (1.0 + exp(-%s[j]));\n", z);
+      break;
+    case RELU:
+      fprintf(stream, "%s[j] > 0.0 ? %s[j] : 0.0;\n", z, z);
+      break;
+    case TANH:
+      fprintf(stream, "tanh(%s[j]);\n", z);
+      break;
+    case LEAKY_RELU:
+      fprintf(stream, "%s[j] > 0.0 ? %s[j] : ", z, z);
+      emit_double(stream, layer->leak_parameter);
+      fprintf(stream, " * %s[j];\n", z);
+      break;
+    case SIGN:
+      fprintf(stream, "(%s[j] > 0.0) - (%s[j] < 0.0);\n", z, z);
+      break;
+    case HARD_TANH:
+      fprintf(stream, "%s[j] > 1.0 ? 1.0 : (%s[j] < -1.0 ? -1.0 : %s[j]);\n",
+              z, z, z);
+      break;
+    case IDENTITY:
+    default:
+      fprintf(stream, "%s[j];\n", z);
+      break;
+  }
+  fprintf(stream, "  }\n");
+}
+
+/**
+ * @brief Writes standalone C source implementing the forward pass of a
+ * trained network for a single sample.
+ * @param stream The output stream.
+ * @param nn A pointer to the trained NeuralNetwork.
+ * @param prefix C identifier used to prefix every generated symbol.
+ * @return 0 on success, -1 if writing to the stream failed.
+ */
+int export_network_c(FILE* stream, const NeuralNetwork* nn,
+                     const char* prefix) {
+  ASSERT(stream != NULL, "Output stream cannot be NULL.");
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "C export supports dense layers only; fold batch norm first.");
+  ASSERT(nn->num_layers > 0, "Network must have at least one layer.");
+  ASSERT(is_c_identifier(prefix), "Prefix must be a valid C identifier.");
+
+  size_t input_size = nn->layers[0]->weights->rows;
+  size_t output_size = nn->layers[nn->num_layers - 1]->weights->cols;
+  LOG_INFO("Exporting %zu-layer network as C source with prefix '%s'.",
+           nn->num_layers, prefix);
+
+  fprintf(stream,
+          "/* Generated by export_network_c. Do not edit. */\n"
+          "#include <math.h>\n\n"
+          "#define %s_INPUT_SIZE %zu\n"
+          "#define %s_OUTPUT_SIZE %zu\n\n",
+          prefix, input_size, prefix, output_size);
+
+  char name[32];
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    ASSERT(i == 0 || layer->weights->rows == nn->layers[i - 1]->weights->cols,
+           "Shape mismatch between consecutive layers.");
+    sprintf(name, "w%zu", i);
+    emit_array(stream, prefix, name, layer->weights);
+    sprintf(name, "b%zu", i);
+    emit_array(stream, prefix, name, layer->bias);
+  }
+
+  fprintf(stream,
+          "void %s_forward(const double* input, double* output) {\n"
+          "  const double* x = input;\n",
+          prefix);
+
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    size_t rows = layer->weights->rows;
+    size_t cols = layer->weights->cols;
+    int is_last = (i == nn->num_layers - 1);
+
+    // Accumulate row by row so the innermost loop is contiguous in both the
+    // weights and the accumulator.
+    fprintf(stream,
+            "\n  /* Layer %zu: %zu -> %zu, %s */\n"
+            "  double z%zu[%zu];\n"
+            "  for (int j = 0; j < %zu; j++) z%zu[j] = %s_b%zu[j];\n"
+            "  for (int k = 0; k < %zu; k++) {\n"
+            "    const double xk = x[k];\n"
+            "    for (int j = 0; j < %zu; j++) {\n"
+            "      z%zu[j] += xk * %s_w%zu[k * %zu + j];\n"
+            "    }\n"
+            "  }\n",
+            i, rows, cols, activation_to_string(layer->activation_type), i,
+            cols, cols, i, prefix, i, rows, cols, i, prefix, i, cols);
+
+    char z_name[32];
+    char out_name[32];
+    sprintf(z_name, "z%zu", i);
+    if (is_last) {
+      sprintf(out_name, "output");
+    } else {
+      sprintf(out_name, "a%zu", i);
+      fprintf(stream, "  double a%zu[%zu];\n", i, cols);
+    }
+    emit_activation(stream, layer, cols, z_name, out_name);
+    if (!is_last) {
+      fprintf(stream, "  x = a%zu;\n", i);
+    }
+  }
+  fprintf(stream, "}\n");
+
+  if (ferror(stream)) {
+    LOG_ERROR("Failed to write generated source.");
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file conv.c
+ * @brief im2col/col2im packing and GEMM-based convolution kernels.
+ */
+#include "conv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "activation.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/**
+ * @brief Creates a convolutional layer.
+ * @param in_height The input height.
+ * @param in_width The input width.
+ * @param in_channels The input channels.
+ * @param out_channels The number of filters.
+ * @param kernel_size The square kernel side.
+ * @param stride The step between windows.
+ * @param padding The zero padding on every border.
+ * @param activation The activation function.
+ * @return A pointer to the new Layer, or NULL if allocation fails.
+ */
+Layer* create_conv2d_layer(size_t in_height, size_t in_width,
+                           size_t in_channels, size_t out_channels,
+                           size_t kernel_size, size_t stride, size_t padding,
+                           activation_function activation) {
+  ASSERT(in_channels > 0 && out_channels > 0, "Channels must be positive.");
+  ASSERT(kernel_size > 0 && stride > 0, "Kernel and stride must be positive.");
+  ASSERT(kernel_size <= in_height + 2 * padding &&
+             kernel_size <= in_width + 2 * padding,
+         "Kernel does not fit the padded input.");
+  ASSERT(activation != SOFTMAX, "Convolutions do not support SOFTMAX.");
+
+  Layer* layer = (Layer*)calloc(1, sizeof(Layer));
+  CHECK_ALLOC(layer);
+  Conv2D* conv = (Conv2D*)malloc(sizeof(Conv2D));
+  if (conv == NULL) {
+    free(layer);
+    return NULL;
+  }
+  conv->in_height = in_height;
+  conv->in_width = in_width;
+  conv->in_channels = in_channels;
+  conv->out_channels = out_channels;
+  conv->kernel_size = kernel_size;
+  conv->stride = stride;
+  conv->padding = padding;
+  conv->out_height = (in_height + 2 * padding - kernel_size) / stride + 1;
+  conv->out_width = (in_width + 2 * padding - kernel_size) / stride + 1;
+  layer->conv = conv;
+
+  layer->weights =
+      create_matrix(kernel_size * kernel_size * in_channels, out_channels);
+  layer->bias = create_matrix(1, out_channels);
+  if (layer->weights == NULL || layer->bias == NULL) {
+    LOG_ERROR("Memory allocation failed for convolution parameters.");
+    free_layer(layer);
+    return NULL;
+  }
+  fill_matrix(layer->weights, 0.0);
+  fill_matrix(layer->bias, 0.0);
+  layer->activation_type = activation;
+  layer->leak_parameter = 0.01;
+  return layer;
+}
+
+/**
+ * @brief Packs receptive fields into rows. With channels last, each kernel
+ * tap reads in_channels contiguous values, copied as one block.
+ * @param conv The convolution geometry.
+ * @param input The input batch.
+ * @param col The packed matrix to fill.
+ */
+void im2col(const Conv2D* conv, const Matrix* input, Matrix* col) {
+  size_t channels = conv->in_channels;
+  size_t k = conv->kernel_size;
+  size_t positions = conv->out_height * conv->out_width;
+  ASSERT(input->cols == conv->in_height * conv->in_width * channels,
+         "Input does not match the convolution geometry.");
+  ASSERT(col->rows == input->rows * positions &&
+             col->cols == k * k * channels,
+         "im2col buffer has the wrong shape.");
+
+#ifdef USE_OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for (size_t n = 0; n < input->rows; n++) {
+    for (size_t p = 0; p < positions; p++) {
+      const double* image = input->matrix_data + n * input->cols;
+      double* row = col->matrix_data + (n * positions + p) * col->cols;
+      size_t oh = p / conv->out_width;
+      size_t ow = p % conv->out_width;
+      for (size_t kh = 0; kh < k; kh++) {
+        // Unsigned wrap-around puts padding rows and columns out of range.
+        size_t ih = oh * conv->stride + kh - conv->padding;
+        for (size_t kw = 0; kw < k; kw++) {
+          size_t iw = ow * conv->stride + kw - conv->padding;
+          double* dst = row + (kh * k + kw) * channels;
+          if (ih < conv->in_height && iw < conv->in_width) {
+            memcpy(dst, image + (ih * conv->in_width + iw) * channels,
+                   channels * sizeof(double));
+          } else {
+            memset(dst, 0, channels * sizeof(double));
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Scatters packed receptive fields back into an input-shaped batch,
+ * summing overlapping windows.
+ * @param conv The convolution geometry.
+ * @param col The packed values.
+ * @param output The batch to fill.
+ */
+void col2im(const Conv2D* conv, const Matrix* col, Matrix* output) {
+  size_t channels = conv->in_channels;
+  size_t k = conv->kernel_size;
+  size_t positions = conv->out_height * conv->out_width;
+  ASSERT(output->cols == conv->in_height * conv->in_width * channels,
+         "Output does not match the convolution geometry.");
+  ASSERT(col->rows == output->rows * positions &&
+             col->cols == k * k * channels,
+         "col2im buffer has the wrong shape.");
+
+  // Windows of one sample overlap, so parallelize over samples only.
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t n = 0; n < output->rows; n++) {
+    double* image = output->matrix_data + n * output->cols;
+    memset(image, 0, output->cols * sizeof(double));
+    for (size_t p = 0; p < positions; p++) {
+      const double* row = col->matrix_data + (n * positions + p) * col->cols;
+      size_t oh = p / conv->out_width;
+      size_t ow = p % conv->out_width;
+      for (size_t kh = 0; kh < k; kh++) {
+        size_t ih = oh * conv->stride + kh - conv->padding;
+        if (ih >= conv->in_height) {
+          continue;
+        }
+        for (size_t kw = 0; kw < k; kw++) {
+          size_t iw = ow * conv->stride + kw - conv->padding;
+          if (iw >= conv->in_width) {
+            continue;
+          }
+          double* dst = image + (ih * conv->in_width + iw) * channels;
+          const double* src = row + (kh * k + kw) * channels;
+          for (size_t c = 0; c < channels; c++) {
+            dst[c] += src[c];
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Checks whether im2col would copy the input unchanged (1x1 kernel,
+ * stride 1, no padding), in which case the input is used as is.
+ * @param conv The convolution geometry.
+ * @return 1 if packing is the identity.
+ */
+static int is_pointwise(const Conv2D* conv) {
+  return conv->kernel_size == 1 && conv->stride == 1 && conv->padding == 0;
+}
+
+/**
+ * @brief Packs a batch for the layer's GEMM.
+ * @param conv The convolution geometry.
+ * @param input The input batch.
+ * @return The packed matrix, or a view of the input for pointwise kernels.
+ * Release with release_columns.
+ */
+static Matrix* pack_columns(const Conv2D* conv, const Matrix* input) {
+  size_t rows = input->rows * conv->out_height * conv->out_width;
+  size_t cols = conv->kernel_size * conv->kernel_size * conv->in_channels;
+  if (is_pointwise(conv)) {
+    ASSERT(input->cols == conv->in_height * conv->in_width * cols,
+           "Input does not match the convolution geometry.");
+    return create_matrix_view(input->matrix_data, rows, cols);
+  }
+  Matrix* col = create_matrix(rows, cols);
+  CHECK_MALLOC(col, "Failed to allocate im2col buffer.");
+  im2col(conv, input, col);
+  return col;
+}
+
+/**
+ * @brief Frees a matrix returned by pack_columns.
+ * @param conv The convolution geometry.
+ * @param col The packed matrix.
+ */
+static void release_columns(const Conv2D* conv, Matrix* col) {
+  if (is_pointwise(conv)) {
+    free_matrix_view(col);
+  } else {
+    free_matrix(col);
+  }
+}
+
+/**
+ * @brief Convolves a batch: the output, viewed as (N·H_out·W_out)×C_out, is
+ * seeded with the bias and accumulated by one GEMM over the packed input.
+ * @param layer A pointer to the convolutional Layer.
+ * @param input A pointer to the input batch.
+ * @return A new matrix holding the pre-activation of the layer.
+ */
+Matrix* conv2d_forward(const Layer* layer, const Matrix* input) {
+  ASSERT(layer != NULL && layer->conv != NULL,
+         "Layer must be a convolution.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  const Conv2D* conv = layer->conv;
+  size_t positions = conv->out_height * conv->out_width;
+
+  Matrix* col = pack_columns(conv, input);
+  Matrix* output = create_matrix(input->rows, positions * conv->out_channels);
+  CHECK_MALLOC(output, "Failed to allocate convolution output.");
+  Matrix* view = create_matrix_view(output->matrix_data,
+                                    input->rows * positions,
+                                    conv->out_channels);
+  for (size_t r = 0; r < view->rows; r++) {
+    memcpy(view->matrix_data + r * view->cols, layer->bias->matrix_data,
+           view->cols * sizeof(double));
+  }
+  gemm_matrix(0, 0, 1.0, col, layer->weights, 1.0, view);
+
+  free_matrix_view(view);
+  release_columns(conv, col);
+  return output;
+}
+
+/**
+ * @brief Computes a convolutional layer's weight and bias gradients.
+ * @param layer A pointer to the convolutional Layer.
+ * @param input The batch the forward pass was run on; only read for dW.
+ * @param delta dL/dz of the layer output.
+ * @param beta 0 to overwrite the gradients, 1 to add to them.
+ * @param dW The weight gradient, or NULL to skip it.
+ * @param db The bias gradient, or NULL to skip it.
+ */
+void conv2d_parameter_gradients(const Layer* layer, const Matrix* input,
+                                const Matrix* delta, double beta, Matrix* dW,
+                                Matrix* db) {
+  ASSERT(layer != NULL && layer->conv != NULL,
+         "Layer must be a convolution.");
+  const Conv2D* conv = layer->conv;
+  size_t positions = conv->out_height * conv->out_width;
+  ASSERT(delta->cols == positions * conv->out_channels,
+         "Delta does not match the convolution output.");
+  ASSERT(dW == NULL || delta->rows == input->rows,
+         "Delta does not match the input batch.");
+
+  Matrix* view = create_matrix_view(delta->matrix_data,
+                                    delta->rows * positions,
+                                    conv->out_channels);
+  if (dW != NULL) {
+    Matrix* col = pack_columns(conv, input);
+    gemm_matrix(1, 0, 1.0, col, view, beta, dW);
+    release_columns(conv, col);
+  }
+  if (db != NULL) {
+    sum_matrix_columns_into(view, beta, db);
+  }
+  free_matrix_view(view);
+}
+
+/**
+ * @brief Propagates a convolutional layer's delta to its input.
+ * @param layer A pointer to the convolutional Layer.
+ * @param delta dL/dz of the layer output.
+ * @param delta_input Receives dL/d(layer input).
+ */
+void conv2d_input_gradient(const Layer* layer, const Matrix* delta,
+                           Matrix* delta_input) {
+  ASSERT(layer != NULL && layer->conv != NULL,
+         "Layer must be a convolution.");
+  const Conv2D* conv = layer->conv;
+  size_t positions = conv->out_height * conv->out_width;
+  ASSERT(delta->cols == positions * conv->out_channels,
+         "Delta does not match the convolution output.");
+  ASSERT(delta_input->rows == delta->rows,
+         "Input gradient has the wrong number of rows.");
+
+  Matrix* view = create_matrix_view(delta->matrix_data,
+                                    delta->rows * positions,
+                                    conv->out_channels);
+  if (is_pointwise(conv)) {
+    ASSERT(delta_input->cols == positions * conv->in_channels,
+           "Input gradient does not match the convolution geometry.");
+    Matrix* out = create_matrix_view(delta_input->matrix_data, view->rows,
+                                     conv->in_channels);
+    gemm_matrix(0, 1, 1.0, view, layer->weights, 0.0, out);
+    free_matrix_view(out);
+  } else {
+    Matrix* dcol = create_matrix(view->rows, layer->weights->rows);
+    CHECK_MALLOC(dcol, "Failed to allocate col2im buffer.");
+    gemm_matrix(0, 1, 1.0, view, layer->weights, 0.0, dcol);
+    col2im(conv, dcol, delta_input);
+    free_matrix(dcol);
+  }
+  free_matrix_view(view);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file dropout.c
+ * @brief Inverted dropout with packed bit masks.
+ */
+#include "dropout.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cache.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "rng.h"
+#include "utils.h"
+
+/**
+ * @brief Applies a packed mask and the inverted-dropout scale in place.
+ * @param data The values (n).
+ * @param mask The packed keep bits ((n + 63) / 64 words).
+ * @param n Number of values.
+ * @param scale 1 / (1 - p).
+ */
+static void apply_mask(double* data, const uint64_t* mask, size_t n,
+                       double scale) {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t w = 0; w < (n + 63) / 64; w++) {
+    uint64_t bits = mask[w];
+    size_t end = (w + 1) * 64 < n ? (w + 1) * 64 : n;
+    for (size_t i = w * 64; i < end; i++) {
+      data[i] = ((bits >> (i % 64)) & 1) ? data[i] * scale : 0.0;
+    }
+  }
+}
+
+/**
+ * @brief Checks whether a layer applies dropout in the current mode.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param layer_index The layer index.
+ * @return 1 in training mode for a hidden layer with a positive rate.
+ */
+int dropout_active(const NeuralNetwork* nn, size_t layer_index) {
+  return nn->training && layer_index + 1 < nn->num_layers &&
+         nn->layers[layer_index]->dropout_rate > 0.0;
+}
+
+/**
+ * @brief Draws a keep-mask for a layer, caches it and applies it to the
+ * layer's activations.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param layer_index The layer index.
+ * @param a The layer's activations, updated in place.
+ */
+void dropout_forward(const NeuralNetwork* nn, size_t layer_index, Matrix* a) {
+  if (!dropout_active(nn, layer_index)) {
+    return;
+  }
+  double rate = nn->layers[layer_index]->dropout_rate;
+  ASSERT(rate < 1.0, "Dropout rate must be below 1.");
+
+  size_t n = a->rows * a->cols;
+  size_t words = (n + 63) / 64;
+  char key[32];
+  sprintf(key, "mask_%zu", layer_index);
+  uint64_t* mask = (uint64_t*)cache_reserve_buffer(nn->cache, key,
+                                                   words * sizeof(uint64_t));
+  CHECK_MALLOC(mask, "Failed to allocate dropout mask.");
+
+  // 16 blocks (32 stream offsets) per mask word; reservations start on a
+  // block boundary.
+  uint64_t offset = rng_reserve(words * 32);
+  rng_fill_keep_mask(rng_seed(), offset / 2, 1.0 - rate, mask, n);
+  apply_mask(a->matrix_data, mask, n, 1.0 / (1.0 - rate));
+}
+
+/**
+ * @brief Applies a layer's cached keep-mask and scale to its delta.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param layer_index The layer index.
+ * @param delta The layer's delta, updated in place.
+ */
+void dropout_backward(const NeuralNetwork* nn, size_t layer_index,
+                      Matrix* delta) {
+  if (!dropout_active(nn, layer_index)) {
+    return;
+  }
+  char key[32];
+  sprintf(key, "mask_%zu", layer_index);
+  const uint64_t* mask = (const uint64_t*)cache_peek_buffer(nn->cache, key);
+  ASSERT(mask != NULL, "Cached dropout mask not found.");
+  apply_mask(delta->matrix_data, mask, delta->rows * delta->cols,
+             1.0 / (1.0 - nn->layers[layer_index]->dropout_rate));
+}
@@ -9,10 +9,115 @@
 #include <string.h>
 
 #include "activation.h"
+#include "batch_norm.h"
+#include "conv.h"
+#include "dropout.h"
 #include "linalg.h"
 #include "neural_network.h"
+#include "pool.h"
 #include "utils.h"
 
+// Alignment of contiguous parameter buffers; one cache line.
+#define PARAMETER_ALIGNMENT 64
+
+/**
+ * @brief Applies a layer's activation function to its pre-activation values.
+ * @param layer A pointer to the Layer whose activation should be applied.
+ * @param z A pointer to the pre-activation matrix.
+ * @return A new matrix containing the activation of z.
+ */
+Matrix* apply_layer_activation(const Layer* layer, Matrix* z) {
+  switch (layer->activation_type) {
+    case SIGMOID:
+      return sigmoid(z);
+    case RELU:
+      return relu(z);
+    case TANH:
+      return tanh_activation(z);
+    case LEAKY_RELU:
+      return leaky_relu(z, layer->leak_parameter);
+    case SIGN:
+      return sign_activation(z);
+    case IDENTITY:
+      return identity_activation(z);
+    case HARD_TANH:
+      return hard_tanh(z);
+    case SOFTMAX:
+      return softmax(z);
+    default:
+      LOG_WARN("Unknown activation function, defaulting to identity.");
+      return identity_activation(z);
+  }
+}
+
+/**
+ * @brief Returns the number of input values per sample of a layer.
+ * @param layer A pointer to the Layer.
+ * @return D_in, or in_height * in_width * in_channels for a convolution or
+ * a max-pool.
+ */
+size_t layer_input_size(const Layer* layer) {
+  const Conv2D* conv = layer->conv;
+  if (conv != NULL) {
+    return conv->in_height * conv->in_width * conv->in_channels;
+  }
+  const Pool2D* pool = layer->pool;
+  if (pool != NULL) {
+    return pool->in_height * pool->in_width * pool->channels;
+  }
+  return layer->weights->rows;
+}
+
+/**
+ * @brief Returns the number of output values per sample of a layer.
+ * @param layer A pointer to the Layer.
+ * @return D_out, or out_height * out_width * out_channels for a convolution
+ * or a max-pool.
+ */
+size_t layer_output_size(const Layer* layer) {
+  const Conv2D* conv = layer->conv;
+  if (conv != NULL) {
+    return conv->out_height * conv->out_width * conv->out_channels;
+  }
+  const Pool2D* pool = layer->pool;
+  if (pool != NULL) {
+    return pool->out_height * pool->out_width * pool->channels;
+  }
+  return layer->weights->cols;
+}
+
+/**
+ * @brief Checks whether every layer is a plain fully connected layer.
+ * @param nn A pointer to the NeuralNetwork.
+ * @return 1 if no layer has a convolution, a max-pool or batch
+ * normalization.
+ */
+int network_is_dense(const NeuralNetwork* nn) {
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    if (layer != NULL && (layer->conv != NULL || layer->pool != NULL ||
+                          layer->batch_norm != NULL)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Checks whether any layer has dropout configured.
+ * @param nn A pointer to the NeuralNetwork.
+ * @return 1 if some layer has a positive dropout rate.
+ */
+int network_has_dropout(const NeuralNetwork* nn) {
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    if (layer != NULL && layer->dropout_rate > 0.0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
 NeuralNetwork* create_network(size_t num_layers) {
   NeuralNetwork* nn = (NeuralNetwork*)malloc(sizeof(NeuralNetwork));
   if (nn == NULL) {
@@ -32,6 +137,9 @@ NeuralNetwork* create_network(size_t num_layers) {
   }
 
   nn->num_layers = num_layers;
+  nn->parameters = NULL;
+  nn->num_parameters = 0;
+  nn->training = 0;
   nn->cache = create_cache();
   if (nn->cache == NULL) {
     LOG_ERROR("Failed to initialize cache.");
@@ -42,6 +150,100 @@ NeuralNetwork* create_network(size_t num_layers) {
   return nn;
 }
 
+/**
+ * @brief Allocates a zeroed, 64-byte aligned buffer of doubles.
+ * @param count Number of doubles.
+ * @return The buffer (release with free), or NULL if allocation fails.
+ */
+double* create_parameter_buffer(size_t count) {
+  // aligned_alloc requires the size to be a positive multiple of the
+  // alignment.
+  size_t bytes = count * sizeof(double);
+  bytes = (bytes + PARAMETER_ALIGNMENT - 1) / PARAMETER_ALIGNMENT *
+          PARAMETER_ALIGNMENT;
+  if (bytes == 0) {
+    bytes = PARAMETER_ALIGNMENT;
+  }
+  double* buffer = (double*)aligned_alloc(PARAMETER_ALIGNMENT, bytes);
+  if (buffer != NULL) {
+    memset(buffer, 0, bytes);
+  }
+  return buffer;
+}
+
+/**
+ * @brief Creates a fully connected network whose weights and biases are views
+ * into one contiguous, 64-byte aligned parameter buffer.
+ * @param layer_sizes Array of num_layers + 1 layer widths, input first.
+ * @param activations Array of num_layers activation types.
+ * @param num_layers Number of layers.
+ * @return A pointer to the new NeuralNetwork, or NULL if allocation fails.
+ */
+NeuralNetwork* create_contiguous_network(const size_t* layer_sizes,
+                                         const activation_function* activations,
+                                         size_t num_layers) {
+  ASSERT(layer_sizes != NULL, "Layer sizes cannot be NULL.");
+  ASSERT(activations != NULL, "Activations cannot be NULL.");
+
+  NeuralNetwork* nn = create_network(num_layers);
+  CHECK_ALLOC(nn);
+
+  size_t total = 0;
+  for (size_t i = 0; i < num_layers; i++) {
+    total += (layer_sizes[i] + 1) * layer_sizes[i + 1];
+  }
+
+  nn->parameters = create_parameter_buffer(total);
+  if (nn->parameters == NULL) {
+    LOG_ERROR("Memory allocation failed for parameter buffer.");
+    free_network(nn);
+    return NULL;
+  }
+  nn->num_parameters = total;
+
+  double* cursor = nn->parameters;
+  for (size_t i = 0; i < num_layers; i++) {
+    Layer* layer = (Layer*)calloc(1, sizeof(Layer));
+    if (layer == NULL) {
+      LOG_ERROR("Failed to allocate memory for layer %zu.", i);
+      free_network(nn);
+      return NULL;
+    }
+    layer->weights =
+        create_matrix_view(cursor, layer_sizes[i], layer_sizes[i + 1]);
+    cursor += layer_sizes[i] * layer_sizes[i + 1];
+    layer->bias = create_matrix_view(cursor, 1, layer_sizes[i + 1]);
+    cursor += layer_sizes[i + 1];
+    layer->activation_type = activations[i];
+    layer->leak_parameter = 0.01;
+    nn->layers[i] = layer;
+  }
+
+  LOG_INFO("Created contiguous network with %zu parameters.", total);
+  return nn;
+}
+
+/**
+ * @brief Frees a layer that owns its weights and bias, along with its
+ * optional descriptors.
+ * @param layer A pointer to the Layer to be freed.
+ */
+void free_layer(Layer* layer) {
+  if (layer == NULL) {
+    return;
+  }
+  if (layer->weights != NULL) {
+    free_matrix(layer->weights);
+  }
+  if (layer->bias != NULL) {
+    free_matrix(layer->bias);
+  }
+  free_batch_norm(layer->batch_norm);
+  free(layer->conv);
+  free(layer->pool);
+  free(layer);
+}
+
 /**
  * @brief Frees all memory associated with a neural network.
  * This includes layers, weights, biases, and the cache.
@@ -54,24 +256,201 @@ void free_network(NeuralNetwork* nn) {
 
   if (nn->layers != NULL) {
     for (size_t i = 0; i < nn->num_layers; i++) {
-      if (nn->layers[i] != NULL) {
-        if (nn->layers[i]->weights != NULL) {
-          free_matrix(nn->layers[i]->weights);
-        }
-        if (nn->layers[i]->bias != NULL) {
-          free_matrix(nn->layers[i]->bias);
-        }
-        free(nn->layers[i]);
+      Layer* layer = nn->layers[i];
+      if (layer != NULL && nn->parameters != NULL) {
+        // Views into nn->parameters, which is freed below.
+        free_matrix_view(layer->weights);
+        free_matrix_view(layer->bias);
+        layer->weights = NULL;
+        layer->bias = NULL;
       }
+      free_layer(layer);
     }
     free(nn->layers);
   }
+  free(nn->parameters);
   if (nn->cache != NULL) {
     free_cache(nn->cache);
   }
   free(nn);
 }
 
+/**
+ * @brief Creates a deep copy of a network's layers with a fresh, empty cache.
+ * @param nn A pointer to the NeuralNetwork to copy.
+ * @return A new network with copied weights, biases and activation settings,
+ * or NULL if allocation fails.
+ */
+NeuralNetwork* copy_network(const NeuralNetwork* nn) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+
+  NeuralNetwork* copy = create_network(nn->num_layers);
+  CHECK_ALLOC(copy);
+  copy->training = nn->training;
+
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    if (layer == NULL) {
+      continue;
+    }
+    Layer* new_layer = (Layer*)calloc(1, sizeof(Layer));
+    if (new_layer == NULL) {
+      LOG_ERROR("Memory allocation failed for layer %zu copy.", i);
+      free_network(copy);
+      return NULL;
+    }
+    *new_layer = *layer;
+    new_layer->weights = copy_matrix(layer->weights);
+    new_layer->bias = copy_matrix(layer->bias);
+    new_layer->batch_norm = copy_batch_norm(layer->batch_norm);
+    new_layer->conv = NULL;
+    new_layer->pool = NULL;
+    copy->layers[i] = new_layer;
+    if (layer->conv != NULL) {
+      new_layer->conv = (Conv2D*)malloc(sizeof(Conv2D));
+      if (new_layer->conv == NULL) {
+        LOG_ERROR("Memory allocation failed for layer %zu copy.", i);
+        free_network(copy);
+        return NULL;
+      }
+      *new_layer->conv = *layer->conv;
+    }
+    if (layer->pool != NULL) {
+      new_layer->pool = (Pool2D*)malloc(sizeof(Pool2D));
+      if (new_layer->pool == NULL) {
+        LOG_ERROR("Memory allocation failed for layer %zu copy.", i);
+        free_network(copy);
+        return NULL;
+      }
+      *new_layer->pool = *layer->pool;
+    }
+  }
+  return copy;
+}
+
+/**
+ * @brief Creates a network that shares another network's layers but owns a
+ * separate cache, so forward and backward passes can run on it concurrently
+ * with passes on `nn` or on other replicas. The training flag is copied once;
+ * owners of long-lived replicas copy it again before every step.
+ * @param nn A pointer to the NeuralNetwork whose layers are shared.
+ * @return A new replica, or NULL if allocation fails. Free with
+ * free_network_replica.
+ */
+NeuralNetwork* create_network_replica(const NeuralNetwork* nn) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+
+  NeuralNetwork* replica = create_network(nn->num_layers);
+  CHECK_ALLOC(replica);
+  replica->training = nn->training;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    replica->layers[i] = nn->layers[i];
+  }
+  return replica;
+}
+
+/**
+ * @brief Frees a replica and its cache without touching the shared layers.
+ * @param replica A pointer to the replica to free.
+ */
+void free_network_replica(NeuralNetwork* replica) {
+  if (replica == NULL) {
+    return;
+  }
+  free_cache(replica->cache);
+  free(replica->layers);
+  free(replica);
+}
+
+/**
+ * @brief Computes a layer's affine transform: input · W + b, or the
+ * convolution of the input plus the per-channel bias. Max-pool layers pool
+ * their input instead, without recording the argmax.
+ * @param layer A pointer to the Layer.
+ * @param input A pointer to the layer input.
+ * @return A new matrix containing the layer's pre-activation.
+ */
+static Matrix* affine_transform(const Layer* layer, const Matrix* input) {
+  ASSERT(input->cols == layer_input_size(layer),
+         "Shape mismatch: output cols != layer input size.");
+  if (layer->conv != NULL) {
+    return conv2d_forward(layer, input);
+  }
+  if (layer->pool != NULL) {
+    return max_pool_forward(layer->pool, input, NULL);
+  }
+
+  Matrix* z_linear = dot_matrix((Matrix*)input, layer->weights);
+  ASSERT(z_linear != NULL && z_linear->rows == input->rows,
+         "Unexpected shape from dot product.");
+  Matrix* z = add_bias_to_matrix(z_linear, layer->bias);
+  ASSERT(z != NULL, "Bias add failed.");
+  free_matrix(z_linear);
+  return z;
+}
+
+/**
+ * @brief Normalizes and activates a layer's pre-activation, caching z_i and
+ * a_i.
+ * @param nn A pointer to the NeuralNetwork structure.
+ * @param i The layer index.
+ * @param z The layer's affine transform of its input. Freed by this call.
+ * @param activate 0 to stop after caching z_i and return it as is.
+ * @return A new matrix containing the layer activation, or z itself.
+ */
+static Matrix* finish_cached_layer(const NeuralNetwork* nn, size_t i,
+                                   Matrix* z, int activate) {
+  Layer* current_layer = nn->layers[i];
+  ASSERT(z != NULL, "Affine transform failed.");
+  ASSERT(z->cols == layer_output_size(current_layer),
+         "Unexpected shape from affine transform.");
+  batch_norm_forward(nn, i, z);
+
+  // Cache the intermediate pre-activation value (z).
+  char z_key[32];
+  sprintf(z_key, "z_%zu", i);
+  cache_put(nn->cache, z_key, copy_matrix(z));
+  if (!activate) {
+    return z;
+  }
+
+  Matrix* a = apply_layer_activation(current_layer, z);
+  ASSERT(a != NULL, "Activation failed.");
+  ASSERT(a->rows == z->rows && a->cols == z->cols,
+         "Unexpected shape from activation.");
+  dropout_forward(nn, i, a);
+
+  char a_key[32];
+  sprintf(a_key, "a_%zu", i);
+  cache_put(nn->cache, a_key, copy_matrix(a));
+
+  free_matrix(z);
+  return a;
+}
+
+/**
+ * @brief Runs layers `first` to the end, caching their intermediates.
+ * @param nn A pointer to the NeuralNetwork structure.
+ * @param first Index of the first layer to run.
+ * @param current_output Input of layer `first`. Freed by this call.
+ * @param activate_output 0 to return the last layer's pre-activation.
+ * @return A new matrix containing the output of the last layer.
+ */
+static Matrix* feedforward_from(const NeuralNetwork* nn, size_t first,
+                                Matrix* current_output, int activate_output) {
+  for (size_t i = first; i < nn->num_layers; i++) {
+    Matrix* z = nn->layers[i]->pool != NULL
+                    ? max_pool_forward_cached(nn, i, current_output)
+                    : affine_transform(nn->layers[i], current_output);
+    int activate = activate_output || i + 1 < nn->num_layers;
+    Matrix* a = finish_cached_layer(nn, i, z, activate);
+
+    free_matrix(current_output);
+    current_output = a;
+  }
+  return current_output;
+}
+
 /**
  * @brief Performs a forward pass through the neural network.
  * Computes the output of the network for a given input and caches intermediate
@@ -84,7 +463,7 @@ void free_network(NeuralNetwork* nn) {
 Matrix* feedforward(const NeuralNetwork* nn, const Matrix* input) {
   ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
   ASSERT(input != NULL, "Input matrix cannot be NULL.");
-  ASSERT(input->cols == nn->layers[0]->weights->rows,
+  ASSERT(input->cols == layer_input_size(nn->layers[0]),
          "Input dimensions must match network dimensions.");
 
   Matrix* current_output = copy_matrix(input);
@@ -92,71 +471,116 @@ Matrix* feedforward(const NeuralNetwork* nn, const Matrix* input) {
 
   cache_put(nn->cache, "input", copy_matrix(current_output));
 
-  for (size_t i = 0; i < nn->num_layers; i++) {
-    Layer* current_layer = nn->layers[i];
-    ASSERT(current_output->cols == current_layer->weights->rows,
-           "Shape mismatch: output cols != weights rows.");
-
-    Matrix* z_linear = dot_matrix(current_output, current_layer->weights);
-    ASSERT(z_linear != NULL, "Dot product failed.");
-    ASSERT(z_linear->rows == current_output->rows &&
-               z_linear->cols == current_layer->weights->cols,
-           "Unexpected shape from dot product.");
-
-    Matrix* z = add_bias_to_matrix(z_linear, current_layer->bias);
-    ASSERT(z != NULL, "Bias add failed.");
-    ASSERT(z->rows == z_linear->rows && z->cols == z_linear->cols,
-           "Unexpected shape from bias add.");
-
-    // Cache the intermediate pre-activation value (z).
-    char z_key[32];
-    sprintf(z_key, "z_%zu", i);
-    cache_put(nn->cache, z_key, copy_matrix(z));
-
-    Matrix* a = NULL;
-    switch (current_layer->activation_type) {
-      case SIGMOID:
-        a = sigmoid(z);
-        break;
-      case RELU:
-        a = relu(z);
-        break;
-      case TANH:
-        a = tanh_activation(z);
-        break;
-      case LEAKY_RELU:
-        a = leaky_relu(z, current_layer->leak_parameter);
-        break;
-      case SIGN:
-        a = sign_activation(z);
-        break;
-      case IDENTITY:
-        a = identity_activation(z);
-        break;
-      case HARD_TANH:
-        a = hard_tanh(z);
-        break;
-      case SOFTMAX:
-        a = softmax(z);
-        break;
-      default:
-        LOG_WARN("Unknown activation function, defaulting to identity.");
-        a = identity_activation(z);
-        break;
-    }
-    ASSERT(a != NULL, "Activation failed.");
-    ASSERT(a->rows == z->rows && a->cols == z->cols,
-           "Unexpected shape from activation.");
+  return feedforward_from(nn, 0, current_output, 1);
+}
 
-    char a_key[32];
-    sprintf(a_key, "a_%zu", i);
-    cache_put(nn->cache, a_key, copy_matrix(a));
+/**
+ * @brief Performs a forward pass that stops before the output activation,
+ * for losses fused with it. Every intermediate is cached as in feedforward
+ * except the output activation, which is never computed.
+ * @param nn A pointer to the NeuralNetwork structure.
+ * @param input A pointer to the input Matrix.
+ * @return A new matrix containing the pre-activation of the last layer.
+ * The caller is responsible for freeing this matrix.
+ */
+Matrix* feedforward_logits(const NeuralNetwork* nn, const Matrix* input) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  ASSERT(input->cols == layer_input_size(nn->layers[0]),
+         "Input dimensions must match network dimensions.");
 
-    free_matrix(z_linear);
-    free_matrix(z);
-    free_matrix(current_output);
+  // An output activation left over from an earlier pass must not be mistaken
+  // for this one by an unfused backward pass.
+  char a_key[32];
+  sprintf(a_key, "a_%zu", nn->num_layers - 1);
+  cache_remove(nn->cache, a_key);
+
+  Matrix* current_output = copy_matrix(input);
+  ASSERT(current_output != NULL, "Failed to copy input matrix.");
+  cache_put(nn->cache, "input", copy_matrix(current_output));
+
+  return feedforward_from(nn, 0, current_output, 0);
+}
+
+/**
+ * @brief Performs a forward pass on a CSR input. The first layer's product is
+ * a sparse-dense GEMM that only reads the weight rows of non-zero features.
+ * The input is not cached; pass it again to the sparse backward pass.
+ * @param nn A pointer to the NeuralNetwork structure.
+ * @param input A pointer to the sparse input.
+ * @return A new matrix containing the output of the last layer of the network.
+ * The caller is responsible for freeing this matrix.
+ */
+Matrix* feedforward_sparse(const NeuralNetwork* nn, const SparseMatrix* input) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  ASSERT(nn->layers[0]->conv == NULL && nn->layers[0]->pool == NULL,
+         "Sparse inputs need a fully connected first layer.");
+  ASSERT(input->cols == nn->layers[0]->weights->rows,
+         "Input dimensions must match network dimensions.");
+
+  // A dense input left over from an earlier pass must not be mistaken for
+  // this one by the backward pass.
+  cache_remove(nn->cache, "input");
+
+  Matrix* z_linear =
+      create_matrix(input->rows, nn->layers[0]->weights->cols);
+  ASSERT(z_linear != NULL, "Failed to allocate first layer output.");
+  sparse_gemm(input, nn->layers[0]->weights, 0.0, z_linear);
+  Matrix* z = add_bias_to_matrix(z_linear, nn->layers[0]->bias);
+  ASSERT(z != NULL, "Bias add failed.");
+  free_matrix(z_linear);
+  Matrix* current_output = finish_cached_layer(nn, 0, z, 1);
+
+  return feedforward_from(nn, 1, current_output, 1);
+}
+
+/**
+ * @brief Runs a single layer forward without touching any cache.
+ * @param layer A pointer to the Layer to apply.
+ * @param input A pointer to the layer input (batch_size x D_in).
+ * @return A new matrix containing the layer activation (batch_size x D_out).
+ * The caller is responsible for freeing this matrix.
+ */
+Matrix* layer_forward(const Layer* layer, const Matrix* input) {
+  ASSERT(layer != NULL, "Layer cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+
+  Matrix* z = affine_transform(layer, input);
+  if (layer->batch_norm != NULL) {
+    batch_norm_inference(layer->batch_norm, z);
+  }
+  Matrix* a = apply_layer_activation(layer, z);
+  ASSERT(a != NULL, "Activation failed.");
+
+  free_matrix(z);
+  return a;
+}
+
+/**
+ * @brief Performs a forward pass without touching the network cache.
+ * Intermediate values are freed as soon as the next layer has consumed them,
+ * so any number of threads may call this concurrently on the same network as
+ * long as nobody mutates the layers at the same time.
+ * @param nn A pointer to the NeuralNetwork structure.
+ * @param input A pointer to the input Matrix.
+ * @return A new matrix containing the output of the last layer of the network.
+ * The caller is responsible for freeing this matrix.
+ */
+Matrix* predict(const NeuralNetwork* nn, const Matrix* input) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  ASSERT(input->cols == layer_input_size(nn->layers[0]),
+         "Input dimensions must match network dimensions.");
+
+  const Matrix* current_output = input;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    Matrix* a = layer_forward(nn->layers[i], current_output);
+    if (current_output != input) {
+      free_matrix((Matrix*)current_output);
+    }
     current_output = a;
   }
 
-  return current_output;
+  return (Matrix*)current_output;
 }
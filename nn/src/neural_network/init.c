@@ -0,0 +1,87 @@
+/**
+ * @file init.c
+ * @brief Xavier and He weight initialization on the counter-based RNG.
+ */
+#include "init.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "linalg.h"
+#include "neural_network.h"
+#include "rng.h"
+#include "utils.h"
+
+/**
+ * @brief Fills a matrix according to an initialization scheme.
+ * @param m A pointer to the Matrix to fill.
+ * @param scheme The initialization scheme.
+ * @param fan_in The number of inputs per unit.
+ * @param fan_out The number of outputs per unit.
+ */
+void initialize_matrix(Matrix* m, InitScheme scheme, size_t fan_in,
+                       size_t fan_out) {
+  ASSERT(m != NULL, "Matrix cannot be NULL.");
+  ASSERT(fan_in > 0, "fan_in must be greater than 0.");
+
+  size_t count = m->rows * m->cols;
+  // Reserve exactly the offsets the fill reads: two per normal value.
+  int normal = scheme == INIT_XAVIER_NORMAL || scheme == INIT_HE_NORMAL;
+  uint64_t offset = rng_reserve(normal ? 2 * count : count);
+  double fan_avg = (double)(fan_in + fan_out);
+  switch (scheme) {
+    case INIT_XAVIER_UNIFORM: {
+      double limit = sqrt(6.0 / fan_avg);
+      rng_fill_uniform(rng_seed(), offset, m->matrix_data, count, -limit,
+                       limit);
+      break;
+    }
+    case INIT_XAVIER_NORMAL:
+      rng_fill_normal(rng_seed(), offset, m->matrix_data, count, 0.0,
+                      sqrt(2.0 / fan_avg));
+      break;
+    case INIT_HE_UNIFORM: {
+      double limit = sqrt(6.0 / (double)fan_in);
+      rng_fill_uniform(rng_seed(), offset, m->matrix_data, count, -limit,
+                       limit);
+      break;
+    }
+    case INIT_HE_NORMAL:
+      rng_fill_normal(rng_seed(), offset, m->matrix_data, count, 0.0,
+                      sqrt(2.0 / (double)fan_in));
+      break;
+    default:
+      ASSERT(0, "Unknown initialization scheme.");
+  }
+}
+
+/**
+ * @brief Initializes a layer's weights with a scheme and zeroes its bias.
+ * @param layer A pointer to the Layer to initialize.
+ * @param scheme The initialization scheme.
+ */
+void initialize_layer(Layer* layer, InitScheme scheme) {
+  ASSERT(layer != NULL, "Layer cannot be NULL.");
+  if (layer->pool != NULL) {
+    return;  // No parameters.
+  }
+  size_t fan_out = layer->weights->cols;
+  if (layer->conv != NULL) {
+    // Each input value reaches every filter at kernel² positions.
+    fan_out *= layer->conv->kernel_size * layer->conv->kernel_size;
+  }
+  initialize_matrix(layer->weights, scheme, layer->weights->rows, fan_out);
+  fill_matrix(layer->bias, 0.0);
+}
+
+/**
+ * @brief Initializes every layer of a network with the same scheme.
+ * @param nn A pointer to the NeuralNetwork to initialize.
+ * @param scheme The initialization scheme.
+ */
+void initialize_network(NeuralNetwork* nn, InitScheme scheme) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    initialize_layer(nn->layers[i], scheme);
+  }
+}
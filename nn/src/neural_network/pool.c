@@ -0,0 +1,193 @@
+/**
+ * @file pool.c
+ * @brief Max-pool forward with argmax recording and scatter backward.
+ */
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "activation.h"
+#include "cache.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+/**
+ * @brief Creates a max-pool layer with empty parameters.
+ * @param in_height The input height.
+ * @param in_width The input width.
+ * @param channels The number of channels.
+ * @param window The square window side.
+ * @param stride The step between windows.
+ * @return A pointer to the new Layer, or NULL if allocation fails.
+ */
+Layer* create_max_pool_layer(size_t in_height, size_t in_width,
+                             size_t channels, size_t window, size_t stride) {
+  ASSERT(channels > 0, "Channels must be positive.");
+  ASSERT(window > 0 && window <= MAX_POOL_MAX_WINDOW,
+         "Window must be between 1 and MAX_POOL_MAX_WINDOW.");
+  ASSERT(window <= in_height && window <= in_width,
+         "Window does not fit the input.");
+  ASSERT(stride > 0, "Stride must be positive.");
+
+  Layer* layer = (Layer*)calloc(1, sizeof(Layer));
+  CHECK_ALLOC(layer);
+  Pool2D* pool = (Pool2D*)malloc(sizeof(Pool2D));
+  if (pool == NULL) {
+    free(layer);
+    return NULL;
+  }
+  pool->in_height = in_height;
+  pool->in_width = in_width;
+  pool->channels = channels;
+  pool->window = window;
+  pool->stride = stride;
+  pool->out_height = (in_height - window) / stride + 1;
+  pool->out_width = (in_width - window) / stride + 1;
+  layer->pool = pool;
+
+  // Empty parameters keep gradient buffers and optimizer offsets uniform.
+  layer->weights = create_matrix(0, 0);
+  layer->bias = create_matrix(1, 0);
+  if (layer->weights == NULL || layer->bias == NULL) {
+    LOG_ERROR("Memory allocation failed for max-pool parameters.");
+    free_layer(layer);
+    return NULL;
+  }
+  layer->activation_type = IDENTITY;
+  return layer;
+}
+
+/**
+ * @brief Max-pools a batch. Each window tap is a contiguous run of channels,
+ * so the comparison loop runs over channels for every tap.
+ * @param pool The pool geometry.
+ * @param input The input batch.
+ * @param argmax Receives the winning tap of every output value, or NULL.
+ * @return A new matrix with the pooled batch.
+ */
+Matrix* max_pool_forward(const Pool2D* pool, const Matrix* input,
+                         uint8_t* argmax) {
+  ASSERT(pool != NULL, "Pool geometry cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  size_t channels = pool->channels;
+  size_t positions = pool->out_height * pool->out_width;
+  ASSERT(input->cols == pool->in_height * pool->in_width * channels,
+         "Input does not match the pool geometry.");
+
+  Matrix* output = create_matrix(input->rows, positions * channels);
+  CHECK_MALLOC(output, "Failed to allocate pool output.");
+
+#ifdef USE_OPENMP
+#pragma omp parallel for collapse(2)
+#endif
+  for (size_t n = 0; n < input->rows; n++) {
+    for (size_t p = 0; p < positions; p++) {
+      const double* image = input->matrix_data + n * input->cols;
+      size_t out_offset = (n * positions + p) * channels;
+      double* out = output->matrix_data + out_offset;
+      uint8_t* idx = argmax != NULL ? argmax + out_offset : NULL;
+      size_t top = p / pool->out_width * pool->stride;
+      size_t left = p % pool->out_width * pool->stride;
+
+      for (size_t t = 0; t < pool->window * pool->window; t++) {
+        size_t ih = top + t / pool->window;
+        size_t iw = left + t % pool->window;
+        const double* src = image + (ih * pool->in_width + iw) * channels;
+        for (size_t c = 0; c < channels; c++) {
+          if (t == 0 || src[c] > out[c]) {
+            out[c] = src[c];
+            if (idx != NULL) {
+              idx[c] = (uint8_t)t;
+            }
+          }
+        }
+      }
+    }
+  }
+  return output;
+}
+
+/**
+ * @brief Scatters output deltas to the recorded winning taps.
+ * @param pool The pool geometry.
+ * @param delta The output delta.
+ * @param argmax The winning taps.
+ * @param delta_input Receives the input delta.
+ */
+void max_pool_backward(const Pool2D* pool, const Matrix* delta,
+                       const uint8_t* argmax, Matrix* delta_input) {
+  ASSERT(pool != NULL && argmax != NULL, "Pool and argmax cannot be NULL.");
+  size_t channels = pool->channels;
+  size_t positions = pool->out_height * pool->out_width;
+  ASSERT(delta->cols == positions * channels,
+         "Delta does not match the pool output.");
+  ASSERT(delta_input->rows == delta->rows &&
+             delta_input->cols == pool->in_height * pool->in_width * channels,
+         "Input gradient does not match the pool geometry.");
+
+  // Overlapping windows of one sample write the same inputs, so parallelize
+  // over samples only.
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t n = 0; n < delta->rows; n++) {
+    double* image = delta_input->matrix_data + n * delta_input->cols;
+    memset(image, 0, delta_input->cols * sizeof(double));
+    for (size_t p = 0; p < positions; p++) {
+      size_t offset = (n * positions + p) * channels;
+      const double* g = delta->matrix_data + offset;
+      const uint8_t* idx = argmax + offset;
+      size_t top = p / pool->out_width * pool->stride;
+      size_t left = p % pool->out_width * pool->stride;
+      for (size_t c = 0; c < channels; c++) {
+        size_t ih = top + idx[c] / pool->window;
+        size_t iw = left + idx[c] % pool->window;
+        image[(ih * pool->in_width + iw) * channels + c] += g[c];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Max-pools a layer's input and caches the winning taps.
+ * @param nn A pointer to the NeuralNetwork.
+ * @param layer_index The layer index.
+ * @param input The layer's input.
+ * @return A new matrix with the pooled batch.
+ */
+Matrix* max_pool_forward_cached(const NeuralNetwork* nn, size_t layer_index,
+                                const Matrix* input) {
+  const Pool2D* pool = nn->layers[layer_index]->pool;
+  ASSERT(pool != NULL, "Layer must be a max-pool.");
+  char key[32];
+  sprintf(key, "argmax_%zu", layer_index);
+  size_t count =
+      input->rows * pool->out_height * pool->out_width * pool->channels;
+  uint8_t* argmax = (uint8_t*)cache_reserve_buffer(nn->cache, key, count);
+  CHECK_MALLOC(argmax, "Failed to allocate argmax buffer.");
+  return max_pool_forward(pool, input, argmax);
+}
+
+/**
+ * @brief Propagates a max-pool layer's delta to its input using the cached
+ * winning taps.
+ * @param nn A pointer to the NeuralNetwork after feedforward.
+ * @param layer_index The layer index.
+ * @param delta The layer's output delta.
+ * @param delta_input Receives the input delta.
+ */
+void max_pool_input_gradient(const NeuralNetwork* nn, size_t layer_index,
+                             const Matrix* delta, Matrix* delta_input) {
+  const Pool2D* pool = nn->layers[layer_index]->pool;
+  ASSERT(pool != NULL, "Layer must be a max-pool.");
+  char key[32];
+  sprintf(key, "argmax_%zu", layer_index);
+  const uint8_t* argmax = (const uint8_t*)cache_peek_buffer(nn->cache, key);
+  ASSERT(argmax != NULL, "Cached argmax not found.");
+  max_pool_backward(pool, delta, argmax, delta_input);
+}
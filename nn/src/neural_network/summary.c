@@ -20,6 +20,22 @@ void fprint_network_summary(FILE* stream, const NeuralNetwork* nn) {
     Layer* layer = nn->layers[i];
     fprintf(stream, "----------------------------------\n");
     fprintf(stream, "Layer %zu:\n", i + 1);
+    if (layer->conv != NULL) {
+      const Conv2D* conv = layer->conv;
+      fprintf(stream, "  Convolution:    %zux%zux%zu -> %zux%zux%zu\n",
+              conv->in_height, conv->in_width, conv->in_channels,
+              conv->out_height, conv->out_width, conv->out_channels);
+      fprintf(stream, "  Kernel:         %zu (stride %zu, padding %zu)\n",
+              conv->kernel_size, conv->stride, conv->padding);
+    }
+    if (layer->pool != NULL) {
+      const Pool2D* pool = layer->pool;
+      fprintf(stream, "  Max-pool:       %zux%zux%zu -> %zux%zux%zu\n",
+              pool->in_height, pool->in_width, pool->channels,
+              pool->out_height, pool->out_width, pool->channels);
+      fprintf(stream, "  Window:         %zu (stride %zu)\n", pool->window,
+              pool->stride);
+    }
     fprintf(stream, "  Weights matrix: %zu x %zu\n", layer->weights->rows,
             layer->weights->cols);
     fprintf(stream, "  Bias matrix:    %zu x %zu\n", layer->bias->rows,
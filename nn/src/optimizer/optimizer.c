@@ -0,0 +1,401 @@
+/**
+ * @file optimizer.c
+ * @brief Fused, in-place parameter update kernels.
+ *
+ * Every optimizer has one kernel that reads the gradient once and updates the
+ * state and the parameters in the same loop.
+ */
+#include "optimizer.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+// Below this many parameters the cost of waking threads outweighs the update.
+#define OPTIMIZER_PARALLEL_THRESHOLD 16384
+
+//============================
+// Update Kernels
+//============================
+
+/**
+ * @brief Fused SGD kernel: param[i] -= learning_rate * grad[i].
+ * @param param Parameters, updated in place.
+ * @param grad Gradients.
+ * @param learning_rate Step size.
+ * @param n Number of elements.
+ */
+static void sgd_kernel(double* restrict param, const double* restrict grad,
+                       double learning_rate, size_t n) {
+#ifdef USE_OPENMP
+#pragma omp parallel for simd if (n >= OPTIMIZER_PARALLEL_THRESHOLD)
+#endif
+  for (size_t i = 0; i < n; i++) {
+    param[i] -= learning_rate * grad[i];
+  }
+}
+
+/**
+ * @brief Fused momentum kernel: v = momentum * v + g; param -= lr * v.
+ * @param param Parameters, updated in place.
+ * @param grad Gradients.
+ * @param velocity Velocity state, updated in place.
+ * @param learning_rate Step size.
+ * @param momentum Velocity decay.
+ * @param n Number of elements.
+ */
+static void momentum_kernel(double* restrict param, const double* restrict grad,
+                            double* restrict velocity, double learning_rate,
+                            double momentum, size_t n) {
+#ifdef USE_OPENMP
+#pragma omp parallel for simd if (n >= OPTIMIZER_PARALLEL_THRESHOLD)
+#endif
+  for (size_t i = 0; i < n; i++) {
+    double v = momentum * velocity[i] + grad[i];
+    velocity[i] = v;
+    param[i] -= learning_rate * v;
+  }
+}
+
+/**
+ * @brief Fused RMSProp kernel: s = rho * s + (1 - rho) * g^2;
+ * param -= lr * g / (sqrt(s) + epsilon).
+ * @param param Parameters, updated in place.
+ * @param grad Gradients.
+ * @param sq_avg Running average of squared gradients, updated in place.
+ * @param learning_rate Step size.
+ * @param rho Squared gradient decay.
+ * @param epsilon Denominator guard.
+ * @param n Number of elements.
+ */
+static void rmsprop_kernel(double* restrict param, const double* restrict grad,
+                           double* restrict sq_avg, double learning_rate,
+                           double rho, double epsilon, size_t n) {
+#ifdef USE_OPENMP
+#pragma omp parallel for simd if (n >= OPTIMIZER_PARALLEL_THRESHOLD)
+#endif
+  for (size_t i = 0; i < n; i++) {
+    double g = grad[i];
+    double s = rho * sq_avg[i] + (1.0 - rho) * g * g;
+    sq_avg[i] = s;
+    param[i] -= learning_rate * g / (sqrt(s) + epsilon);
+  }
+}
+
+/**
+ * @brief Fused Adam kernel. Bias correction is folded into the step size and
+ * epsilon, so the corrected moments are never materialized.
+ * @param param Parameters, updated in place.
+ * @param grad Gradients.
+ * @param m First moment, updated in place.
+ * @param v Second moment, updated in place.
+ * @param step_size learning_rate * sqrt(1 - beta2^t) / (1 - beta1^t).
+ * @param beta1 First moment decay.
+ * @param beta2 Second moment decay.
+ * @param epsilon Bias-corrected denominator guard.
+ * @param n Number of elements.
+ */
+static void adam_kernel(double* restrict param, const double* restrict grad,
+                        double* restrict m, double* restrict v,
+                        double step_size, double beta1, double beta2,
+                        double epsilon, size_t n) {
+#ifdef USE_OPENMP
+#pragma omp parallel for simd if (n >= OPTIMIZER_PARALLEL_THRESHOLD)
+#endif
+  for (size_t i = 0; i < n; i++) {
+    double g = grad[i];
+    double m_i = beta1 * m[i] + (1.0 - beta1) * g;
+    double v_i = beta2 * v[i] + (1.0 - beta2) * g * g;
+    m[i] = m_i;
+    v[i] = v_i;
+    param[i] -= step_size * m_i / (sqrt(v_i) + epsilon);
+  }
+}
+
+/**
+ * @brief Applies the optimizer's update rule to one contiguous parameter
+ * block.
+ * @param opt The optimizer.
+ * @param param Parameters, updated in place.
+ * @param grad Gradients.
+ * @param state_offset Offset of this block in the state buffers.
+ * @param n Number of elements.
+ */
+static void apply_update(const Optimizer* opt, double* param,
+                         const double* grad, size_t state_offset, size_t n) {
+  switch (opt->type) {
+    case OPTIMIZER_SGD:
+      sgd_kernel(param, grad, opt->learning_rate, n);
+      break;
+    case OPTIMIZER_MOMENTUM:
+      momentum_kernel(param, grad, opt->state1 + state_offset,
+                      opt->learning_rate, opt->momentum, n);
+      break;
+    case OPTIMIZER_RMSPROP:
+      rmsprop_kernel(param, grad, opt->state1 + state_offset,
+                     opt->learning_rate, opt->rho, opt->epsilon, n);
+      break;
+    case OPTIMIZER_ADAM: {
+      double t = (double)opt->step;
+      double correction1 = 1.0 - pow(opt->beta1, t);
+      double correction2 = sqrt(1.0 - pow(opt->beta2, t));
+      adam_kernel(param, grad, opt->state1 + state_offset,
+                  opt->state2 + state_offset,
+                  opt->learning_rate * correction2 / correction1, opt->beta1,
+                  opt->beta2, opt->epsilon * correction2, n);
+      break;
+    }
+    default:
+      LOG_ERROR("Unknown optimizer type.");
+      break;
+  }
+}
+
+/**
+ * @brief Applies the optimizer's update rule to a layer's batch normalization
+ * scale and shift, if it has one. Their gradients are left in the BatchNorm by
+ * the backward pass; their state follows the network parameters.
+ * @param opt The optimizer.
+ * @param layer_index Index of the layer in the network.
+ * @param layer The layer.
+ */
+static void update_batch_norm(const Optimizer* opt, size_t layer_index,
+                              Layer* layer) {
+  BatchNorm* bn = layer->batch_norm;
+  size_t offset = opt->bn_offsets[layer_index];
+  size_t features = bn != NULL ? bn->gamma->cols : 0;
+  ASSERT(offset + 2 * features == opt->bn_offsets[layer_index + 1],
+         "Batch normalization changed since the optimizer was created.");
+  if (bn == NULL) {
+    return;
+  }
+  apply_update(opt, bn->gamma->matrix_data, bn->grad_gamma->matrix_data,
+               offset, features);
+  apply_update(opt, bn->beta->matrix_data, bn->grad_beta->matrix_data,
+               offset + features, features);
+}
+
+//============================
+// Public API
+//============================
+
+/**
+ * @brief Applies a plain SGD step to a layer's weights, bias and batch
+ * normalization scale and shift in place.
+ * @param layer A pointer to the Layer to update.
+ * @param dW The weight gradient.
+ * @param db The bias gradient.
+ * @param learning_rate The step size.
+ */
+void sgd_update(Layer* layer, const Matrix* dW, const Matrix* db,
+                double learning_rate) {
+  ASSERT(layer != NULL, "Layer cannot be NULL.");
+  ASSERT(dW != NULL && db != NULL, "Gradients cannot be NULL.");
+  ASSERT(dW->rows == layer->weights->rows && dW->cols == layer->weights->cols,
+         "Weight gradient shape must match weights.");
+  ASSERT(db->rows == layer->bias->rows && db->cols == layer->bias->cols,
+         "Bias gradient shape must match bias.");
+
+  sgd_kernel(layer->weights->matrix_data, dW->matrix_data, learning_rate,
+             dW->rows * dW->cols);
+  sgd_kernel(layer->bias->matrix_data, db->matrix_data, learning_rate,
+             db->rows * db->cols);
+  BatchNorm* bn = layer->batch_norm;
+  if (bn != NULL) {
+    sgd_kernel(bn->gamma->matrix_data, bn->grad_gamma->matrix_data,
+               learning_rate, bn->gamma->cols);
+    sgd_kernel(bn->beta->matrix_data, bn->grad_beta->matrix_data,
+               learning_rate, bn->beta->cols);
+  }
+}
+
+/**
+ * @brief Creates an optimizer for a network, allocating its state once.
+ * @param type The update rule.
+ * @param nn A pointer to the NeuralNetwork whose layers will be updated.
+ * @param learning_rate The step size.
+ * @return A pointer to the new Optimizer, or NULL if allocation fails.
+ */
+Optimizer* create_optimizer(OptimizerType type, const NeuralNetwork* nn,
+                            double learning_rate) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+
+  Optimizer* opt = (Optimizer*)calloc(1, sizeof(Optimizer));
+  CHECK_ALLOC(opt);
+  opt->type = type;
+  opt->learning_rate = learning_rate;
+  opt->momentum = 0.9;
+  opt->beta1 = 0.9;
+  opt->beta2 = 0.999;
+  opt->rho = 0.9;
+  opt->epsilon = 1e-8;
+  opt->num_layers = nn->num_layers;
+
+  opt->offsets = (size_t*)malloc(sizeof(size_t) * (nn->num_layers + 1));
+  opt->bn_offsets = (size_t*)malloc(sizeof(size_t) * (nn->num_layers + 1));
+  if (opt->offsets == NULL || opt->bn_offsets == NULL) {
+    free_optimizer(opt);
+    return NULL;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    opt->offsets[i] = total;
+    total += layer->weights->rows * layer->weights->cols +
+             layer->bias->rows * layer->bias->cols;
+  }
+  opt->offsets[nn->num_layers] = total;
+  opt->num_parameters = total;
+
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const BatchNorm* bn = nn->layers[i]->batch_norm;
+    opt->bn_offsets[i] = total;
+    total += bn != NULL ? 2 * bn->gamma->cols : 0;
+  }
+  opt->bn_offsets[nn->num_layers] = total;
+
+  if (type != OPTIMIZER_SGD) {
+    opt->state1 = create_parameter_buffer(total);
+    if (opt->state1 == NULL) {
+      free_optimizer(opt);
+      return NULL;
+    }
+  }
+  if (type == OPTIMIZER_ADAM) {
+    opt->state2 = create_parameter_buffer(total);
+    if (opt->state2 == NULL) {
+      free_optimizer(opt);
+      return NULL;
+    }
+  }
+
+  LOG_INFO("Created optimizer for %zu parameters.", total);
+  return opt;
+}
+
+/**
+ * @brief Starts a new optimization step.
+ * @param opt A pointer to the Optimizer.
+ */
+void optimizer_begin_step(Optimizer* opt) {
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  opt->step++;
+}
+
+/**
+ * @brief Updates one layer's weights, bias and optimizer state in place.
+ * @param opt A pointer to the Optimizer.
+ * @param layer_index The index of the layer in the network.
+ * @param layer A pointer to the Layer to update.
+ * @param dW The weight gradient.
+ * @param db The bias gradient.
+ */
+void optimizer_update_layer(Optimizer* opt, size_t layer_index, Layer* layer,
+                            const Matrix* dW, const Matrix* db) {
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(layer != NULL, "Layer cannot be NULL.");
+  ASSERT(dW != NULL && db != NULL, "Gradients cannot be NULL.");
+  ASSERT(layer_index < opt->num_layers, "layer_index out of bounds.");
+  ASSERT(opt->step > 0, "optimizer_begin_step must be called first.");
+
+  size_t weight_count = dW->rows * dW->cols;
+  size_t bias_count = db->rows * db->cols;
+  ASSERT(dW->rows == layer->weights->rows && dW->cols == layer->weights->cols,
+         "Weight gradient shape must match weights.");
+  ASSERT(db->rows == layer->bias->rows && db->cols == layer->bias->cols,
+         "Bias gradient shape must match bias.");
+  ASSERT(opt->offsets[layer_index] + weight_count + bias_count ==
+             opt->offsets[layer_index + 1],
+         "Layer shape changed since the optimizer was created.");
+
+  size_t offset = opt->offsets[layer_index];
+  apply_update(opt, layer->weights->matrix_data, dW->matrix_data, offset,
+               weight_count);
+  apply_update(opt, layer->bias->matrix_data, db->matrix_data,
+               offset + weight_count, bias_count);
+  update_batch_norm(opt, layer_index, layer);
+}
+
+/**
+ * @brief Applies one layer's gradients as they are emitted by
+ * backpropagate_gradients.
+ * @param layer_index Index of the layer in the network.
+ * @param layer A pointer to the Layer to update.
+ * @param dW A pointer to the weight gradient.
+ * @param db A pointer to the bias gradient.
+ * @param user_data A pointer to the Optimizer.
+ */
+void optimizer_layer_callback(size_t layer_index, Layer* layer,
+                              const Matrix* dW, const Matrix* db,
+                              void* user_data) {
+  optimizer_update_layer((Optimizer*)user_data, layer_index, layer, dW, db);
+}
+
+/**
+ * @brief Starts a step and updates every layer of a network.
+ * @param opt A pointer to the Optimizer.
+ * @param nn A pointer to the NeuralNetwork to update.
+ * @param dW Array of per-layer weight gradients.
+ * @param db Array of per-layer bias gradients.
+ */
+void optimizer_step(Optimizer* opt, NeuralNetwork* nn, Matrix* const* dW,
+                    Matrix* const* db) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(dW != NULL && db != NULL, "Gradient arrays cannot be NULL.");
+
+  optimizer_begin_step(opt);
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    optimizer_update_layer(opt, i, nn->layers[i], dW[i], db[i]);
+  }
+}
+
+/**
+ * @brief Starts a step and applies a full set of gradients. Contiguous
+ * networks are updated with one kernel call over the whole parameter buffer.
+ * @param opt A pointer to the Optimizer.
+ * @param nn A pointer to the NeuralNetwork to update.
+ * @param grads A pointer to the NetworkGradients to apply.
+ */
+void optimizer_apply_gradients(Optimizer* opt, NeuralNetwork* nn,
+                               const NetworkGradients* grads) {
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+  ASSERT(grads->size == opt->num_parameters,
+         "Gradients do not match the optimizer state.");
+
+  if (nn->parameters != NULL && nn->num_parameters == grads->size) {
+    optimizer_begin_step(opt);
+    apply_update(opt, nn->parameters, grads->data, 0, grads->size);
+    for (size_t i = 0; i < nn->num_layers; i++) {
+      update_batch_norm(opt, i, nn->layers[i]);
+    }
+    return;
+  }
+  optimizer_step(opt, nn, grads->weights, grads->bias);
+}
+
+/**
+ * @brief Frees an optimizer and its state buffers.
+ * @param opt A pointer to the Optimizer to free.
+ */
+void free_optimizer(Optimizer* opt) {
+  if (opt == NULL) {
+    return;
+  }
+  free(opt->offsets);
+  free(opt->bn_offsets);
+  free(opt->state1);
+  free(opt->state2);
+  free(opt);
+}
@@ -0,0 +1,325 @@
+/**
+ * @file quantize.c
+ * @brief Post-training int8 quantization and int8 inference kernels.
+ */
+#include "quantize.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "activation.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+//============================
+// Helpers
+//============================
+
+/**
+ * @brief Computes a symmetric scale so that `max_abs` maps to QUANT_INT8_MAX.
+ * @param max_abs Largest magnitude to represent.
+ * @return The scale; 1.0 when the range is empty.
+ */
+static double symmetric_scale(double max_abs) {
+  return (max_abs > 0.0) ? max_abs / QUANT_INT8_MAX : 1.0;
+}
+
+/**
+ * @brief Rounds and saturates a real value to symmetric int8.
+ * @param x The value in quantized units.
+ * @return The int8 value in [-QUANT_INT8_MAX, QUANT_INT8_MAX].
+ */
+static inline int8_t saturate_int8(double x) {
+  long q = lround(x);
+  if (q > QUANT_INT8_MAX) {
+    q = QUANT_INT8_MAX;
+  } else if (q < -QUANT_INT8_MAX) {
+    q = -QUANT_INT8_MAX;
+  }
+  return (int8_t)q;
+}
+
+/**
+ * @brief Returns the largest absolute value in a buffer.
+ * @param data The buffer.
+ * @param n Number of elements.
+ * @return The maximum magnitude.
+ */
+static double max_abs(const double* data, size_t n) {
+  double result = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double v = fabs(data[i]);
+    if (v > result) {
+      result = v;
+    }
+  }
+  return result;
+}
+
+//============================
+// int8 GEMM
+//============================
+
+/**
+ * @brief Dot product of two int8 vectors with int32 accumulation.
+ * With AVX2 the operands are sign-extended to int16 and combined with
+ * `_mm256_madd_epi16`, which is exact for symmetric int8 data. (The
+ * `maddubs` instruction needs one unsigned operand, which symmetric
+ * activations are not.)
+ * @param a First vector.
+ * @param b Second vector.
+ * @param k Vector length.
+ * @return The dot product.
+ */
+static inline int32_t dot_int8(const int8_t* a, const int8_t* b, size_t k) {
+  int32_t sum = 0;
+  size_t i = 0;
+#ifdef __AVX2__
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= k; i += 16) {
+    __m256i va =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+    __m256i vb =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  __m128i lanes = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+  lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0x4E));
+  lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0xB1));
+  sum = _mm_cvtsi128_si32(lanes);
+#endif
+  for (; i < k; i++) {
+    sum += (int32_t)a[i] * (int32_t)b[i];
+  }
+  return sum;
+}
+
+void gemm_int8(const int8_t* a, const int8_t* b_t, int32_t* c, size_t m,
+               size_t n, size_t k) {
+  ASSERT(a != NULL && b_t != NULL && c != NULL,
+         "int8 GEMM operands cannot be NULL.");
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < m; i++) {
+    for (size_t j = 0; j < n; j++) {
+      c[i * n + j] = dot_int8(a + i * k, b_t + j * k, k);
+    }
+  }
+}
+
+//============================
+// Quantization
+//============================
+
+/**
+ * @brief Quantizes a layer's weights per output channel.
+ * @param layer The source layer.
+ * @param q The quantized layer to fill. Its buffers must be allocated.
+ */
+static void quantize_layer_weights(const Layer* layer, QuantizedLayer* q) {
+  const Matrix* w = layer->weights;
+  for (size_t j = 0; j < w->cols; j++) {
+    double channel_max = 0.0;
+    for (size_t k = 0; k < w->rows; k++) {
+      double v = fabs(w->matrix_data[k * w->cols + j]);
+      if (v > channel_max) {
+        channel_max = v;
+      }
+    }
+    double scale = symmetric_scale(channel_max);
+    q->weight_scales[j] = scale;
+    for (size_t k = 0; k < w->rows; k++) {
+      q->weights[j * w->rows + k] =
+          saturate_int8(w->matrix_data[k * w->cols + j] / scale);
+    }
+    q->bias[j] = layer->bias->matrix_data[j];
+  }
+}
+
+/**
+ * @brief Quantizes a trained network, calibrating each layer's input scale on
+ * sample data.
+ * @param nn A pointer to the trained NeuralNetwork.
+ * @param calibration_data Representative inputs.
+ * @return A pointer to the new QuantizedNetwork, or NULL if allocation fails.
+ */
+QuantizedNetwork* quantize_network(const NeuralNetwork* nn,
+                                   const Matrix* calibration_data) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Quantization supports dense layers only; fold batch norm first.");
+  ASSERT(calibration_data != NULL, "Calibration data cannot be NULL.");
+  ASSERT(calibration_data->cols == nn->layers[0]->weights->rows,
+         "Calibration data dimensions must match network dimensions.");
+  // quantized_predict applies softmax to the output rows only.
+  for (size_t i = 0; i + 1 < nn->num_layers; i++) {
+    ASSERT(nn->layers[i]->activation_type != SOFTMAX,
+           "Only the last layer of a quantized network may use SOFTMAX.");
+  }
+
+  QuantizedNetwork* qnn = (QuantizedNetwork*)malloc(sizeof(QuantizedNetwork));
+  CHECK_ALLOC(qnn);
+  qnn->num_layers = nn->num_layers;
+  qnn->layers =
+      (QuantizedLayer*)calloc(nn->num_layers, sizeof(QuantizedLayer));
+  if (qnn->layers == NULL) {
+    free(qnn);
+    return NULL;
+  }
+
+  const Matrix* activation = calibration_data;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Layer* layer = nn->layers[i];
+    QuantizedLayer* q = &qnn->layers[i];
+    q->input_size = layer->weights->rows;
+    q->output_size = layer->weights->cols;
+    q->activation_type = layer->activation_type;
+    q->leak_parameter = layer->leak_parameter;
+    q->weights = (int8_t*)malloc(q->input_size * q->output_size);
+    q->weight_scales = (double*)malloc(sizeof(double) * q->output_size);
+    q->bias = (double*)malloc(sizeof(double) * q->output_size);
+    if (q->weights == NULL || q->weight_scales == NULL || q->bias == NULL) {
+      LOG_ERROR("Memory allocation failed for quantized layer %zu.", i);
+      if (activation != calibration_data) {
+        free_matrix((Matrix*)activation);
+      }
+      free_quantized_network(qnn);
+      return NULL;
+    }
+
+    quantize_layer_weights(layer, q);
+    q->input_scale = symmetric_scale(
+        max_abs(activation->matrix_data, activation->rows * activation->cols));
+
+    Matrix* next = layer_forward(layer, activation);
+    if (activation != calibration_data) {
+      free_matrix((Matrix*)activation);
+    }
+    activation = next;
+  }
+  free_matrix((Matrix*)activation);
+
+  LOG_INFO("Quantized %zu-layer network to int8.", qnn->num_layers);
+  return qnn;
+}
+
+//============================
+// Quantized Inference
+//============================
+
+/**
+ * @brief Runs int8 inference. Each intermediate layer's int32 accumulators are
+ * rescaled, biased, activated and requantized for the next layer in a single
+ * pass.
+ * @param qnn A pointer to the QuantizedNetwork.
+ * @param input A pointer to the input Matrix.
+ * @return A new matrix containing the output of the last layer. The caller is
+ * responsible for freeing this matrix.
+ */
+Matrix* quantized_predict(const QuantizedNetwork* qnn, const Matrix* input) {
+  ASSERT(qnn != NULL, "Quantized network cannot be NULL.");
+  ASSERT(input != NULL, "Input matrix cannot be NULL.");
+  ASSERT(input->cols == qnn->layers[0].input_size,
+         "Input dimensions must match network dimensions.");
+
+  size_t batch = input->rows;
+  size_t widest = input->cols;
+  for (size_t i = 0; i < qnn->num_layers; i++) {
+    if (qnn->layers[i].output_size > widest) {
+      widest = qnn->layers[i].output_size;
+    }
+  }
+
+  int8_t* x = (int8_t*)malloc(batch * widest);
+  int8_t* x_next = (int8_t*)malloc(batch * widest);
+  int32_t* acc = (int32_t*)malloc(sizeof(int32_t) * batch * widest);
+  CHECK_MALLOC(x, "Failed to allocate quantized activations.");
+  CHECK_MALLOC(x_next, "Failed to allocate quantized activations.");
+  CHECK_MALLOC(acc, "Failed to allocate int32 accumulators.");
+
+  double inv_scale = 1.0 / qnn->layers[0].input_scale;
+  for (size_t i = 0; i < batch * input->cols; i++) {
+    x[i] = saturate_int8(input->matrix_data[i] * inv_scale);
+  }
+
+  const QuantizedLayer* last = &qnn->layers[qnn->num_layers - 1];
+  Matrix* output = create_matrix(batch, last->output_size);
+
+  for (size_t l = 0; l < qnn->num_layers; l++) {
+    const QuantizedLayer* q = &qnn->layers[l];
+    size_t n = q->output_size;
+    gemm_int8(x, q->weights, acc, batch, n, q->input_size);
+
+    if (q == last) {
+      for (size_t r = 0; r < batch; r++) {
+        double* out = &output->matrix_data[r * n];
+        for (size_t j = 0; j < n; j++) {
+          double y = acc[r * n + j] * q->input_scale * q->weight_scales[j] +
+                     q->bias[j];
+          // Softmax passes through here and is applied to whole rows below.
+          out[j] = activate_scalar(q->activation_type, y, q->leak_parameter);
+        }
+      }
+      break;
+    }
+
+    double next_inv_scale = 1.0 / qnn->layers[l + 1].input_scale;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t r = 0; r < batch; r++) {
+      for (size_t j = 0; j < n; j++) {
+        double y = acc[r * n + j] * q->input_scale * q->weight_scales[j] +
+                   q->bias[j];
+        double a = activate_scalar(q->activation_type, y, q->leak_parameter);
+        x_next[r * n + j] = saturate_int8(a * next_inv_scale);
+      }
+    }
+    int8_t* tmp = x;
+    x = x_next;
+    x_next = tmp;
+  }
+
+  if (last->activation_type == SOFTMAX) {
+    Matrix* probabilities = softmax(output);
+    free_matrix(output);
+    output = probabilities;
+  }
+
+  free(x);
+  free(x_next);
+  free(acc);
+  return output;
+}
+
+/**
+ * @brief Frees a quantized network and all of its layers.
+ * @param qnn A pointer to the QuantizedNetwork to free.
+ */
+void free_quantized_network(QuantizedNetwork* qnn) {
+  if (qnn == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < qnn->num_layers; i++) {
+    free(qnn->layers[i].weights);
+    free(qnn->layers[i].weight_scales);
+    free(qnn->layers[i].bias);
+  }
+  free(qnn->layers);
+  free(qnn);
+}
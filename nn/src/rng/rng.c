@@ -0,0 +1,192 @@
+/**
+ * @file rng.c
+ * @brief Philox4x32-10 counter-based generator and bulk fills.
+ *
+ * Offset i of a stream lives in 64-bit half (i & 1) of block i / 2, whose
+ * counter is (i / 2) as a 128-bit integer. Every fill reads offsets in that
+ * one space; a Box-Muller normal takes two consecutive offsets.
+ */
+#include "rng.h"
+
+#include <math.h>
+#include <stdatomic.h>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+// 2^-53: maps the top 53 bits of a 64-bit value to [0, 1).
+#define RNG_DOUBLE_SCALE (1.0 / 9007199254740992.0)
+#define RNG_TWO_PI 6.28318530717958647692
+
+static atomic_uint_fast64_t global_seed = RNG_DEFAULT_SEED;
+static atomic_uint_fast64_t global_offset = 0;
+
+/**
+ * @brief 32x32 -> 64-bit multiply split into high and low words.
+ * @param a The first factor.
+ * @param b The second factor.
+ * @param hi Receives the high word.
+ * @return The low word.
+ */
+static inline uint32_t mulhilo32(uint32_t a, uint32_t b, uint32_t* hi) {
+  uint64_t product = (uint64_t)a * (uint64_t)b;
+  *hi = (uint32_t)(product >> 32);
+  return (uint32_t)product;
+}
+
+void philox4x32(const uint32_t counter[4], const uint32_t key[2],
+                uint32_t out[4]) {
+  uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < PHILOX_ROUNDS; round++) {
+    uint32_t hi0, hi1;
+    uint32_t lo0 = mulhilo32(PHILOX_M0, c0, &hi0);
+    uint32_t lo1 = mulhilo32(PHILOX_M1, c2, &hi1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/**
+ * @brief Computes the Philox block with counter `block` for `seed`.
+ * @param seed The stream seed (key).
+ * @param block The block index (counter).
+ * @param out Receives the block's two 64-bit values.
+ */
+static inline void philox_block(uint64_t seed, uint64_t block,
+                                uint64_t out[2]) {
+  uint32_t counter[4] = {(uint32_t)block, (uint32_t)(block >> 32), 0, 0};
+  uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+  uint32_t words[4];
+  philox4x32(counter, key, words);
+  out[0] = ((uint64_t)words[1] << 32) | words[0];
+  out[1] = ((uint64_t)words[3] << 32) | words[2];
+}
+
+uint64_t rng_u64(uint64_t seed, uint64_t offset) {
+  uint64_t block[2];
+  philox_block(seed, offset >> 1, block);
+  return block[offset & 1];
+}
+
+double rng_uniform(uint64_t seed, uint64_t offset) {
+  return (double)(rng_u64(seed, offset) >> 11) * RNG_DOUBLE_SCALE;
+}
+
+void rng_fill_uniform(uint64_t seed, uint64_t offset, double* out, size_t n,
+                      double low, double high) {
+  if (n == 0) {
+    return;
+  }
+  double range = high - low;
+  uint64_t first = offset >> 1;
+  uint64_t last = (offset + n - 1) >> 1;
+  // One block yields two values; only the ends can fall outside the range.
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (uint64_t b = first; b <= last; b++) {
+    uint64_t block[2];
+    philox_block(seed, b, block);
+    for (uint64_t h = 0; h < 2; h++) {
+      uint64_t index = 2 * b + h;
+      if (index >= offset && index < offset + n) {
+        out[index - offset] =
+            low + range * (double)(block[h] >> 11) * RNG_DOUBLE_SCALE;
+      }
+    }
+  }
+}
+
+void rng_fill_normal(uint64_t seed, uint64_t offset, double* out, size_t n,
+                     double mean, double stddev) {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < n; i++) {
+    uint64_t first = offset + 2 * (uint64_t)i;
+    uint64_t block[2];
+    philox_block(seed, first >> 1, block);
+    uint64_t bits1 = block[first & 1];
+    uint64_t bits2;
+    if ((first & 1) == 0) {
+      bits2 = block[1];
+    } else {
+      // An odd start straddles two blocks.
+      philox_block(seed, (first >> 1) + 1, block);
+      bits2 = block[0];
+    }
+    // u1 in (0, 1] keeps the log finite.
+    double u1 = ((double)(bits1 >> 11) + 1.0) * RNG_DOUBLE_SCALE;
+    double u2 = (double)(bits2 >> 11) * RNG_DOUBLE_SCALE;
+    out[i] = mean + stddev * sqrt(-2.0 * log(u1)) * cos(RNG_TWO_PI * u2);
+  }
+}
+
+void rng_fill_keep_mask(uint64_t seed, uint64_t block_offset, double keep_prob,
+                        uint64_t* mask, size_t n) {
+  // Bit set when the 32-bit word is below keep_prob * 2^32.
+  uint64_t threshold = (uint64_t)(keep_prob * 4294967296.0);
+  size_t words = (n + 63) / 64;
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t w = 0; w < words; w++) {
+    uint64_t bits = 0;
+    uint32_t key[2] = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+    for (uint64_t q = 0; q < 16; q++) {
+      uint64_t block = block_offset + (uint64_t)w * 16 + q;
+      uint32_t counter[4] = {(uint32_t)block, (uint32_t)(block >> 32), 0, 0};
+      uint32_t out[4];
+      philox4x32(counter, key, out);
+      for (uint64_t k = 0; k < 4; k++) {
+        bits |= (uint64_t)((uint64_t)out[k] < threshold) << (q * 4 + k);
+      }
+    }
+    if (w == words - 1 && n % 64 != 0) {
+      bits &= (UINT64_C(1) << (n % 64)) - 1;
+    }
+    mask[w] = bits;
+  }
+}
+
+void rng_permutation(uint64_t seed, uint64_t offset, size_t* indices,
+                     size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    indices[i] = i;
+  }
+  for (size_t i = n; i > 1; i--) {
+    size_t j = (size_t)(rng_u64(seed, offset++) % i);
+    size_t tmp = indices[i - 1];
+    indices[i - 1] = indices[j];
+    indices[j] = tmp;
+  }
+}
+
+void rng_set_seed(uint64_t seed) {
+  atomic_store(&global_seed, seed);
+  atomic_store(&global_offset, 0);
+}
+
+uint64_t rng_seed(void) { return atomic_load(&global_seed); }
+
+uint64_t rng_reserve(size_t n) {
+  // Whole blocks only, so no two reservations read the same block.
+  uint64_t rounded = ((uint64_t)n + 1) & ~UINT64_C(1);
+  return atomic_fetch_add(&global_offset, rounded);
+}
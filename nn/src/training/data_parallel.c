@@ -0,0 +1,317 @@
+/**
+ * @file data_parallel.c
+ * @brief Data-parallel training over a persistent pool of worker threads.
+ *
+ * A step runs in three phases separated by barriers: every worker computes
+ * the gradients of its shard into a private buffer, then every worker sums
+ * its own slice of the parameter range across all buffers into the first
+ * buffer, and finally the calling thread applies one optimizer update from
+ * that buffer. The calling thread only coordinates, so the per-op OpenMP
+ * loops of the update keep the whole machine while workers run single
+ * threaded.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel_training.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+#include "utils.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+// Reduction slices are rounded to a cache line of doubles to avoid false
+// sharing between workers.
+#define REDUCE_SLICE_ALIGNMENT 8
+
+/** @brief Per-thread state. */
+typedef struct {
+  DataParallelTrainer* trainer;
+  size_t index;            /**< Worker index. */
+  NeuralNetwork* replica;  /**< Shares the trainer's layers. */
+  NetworkGradients* grads; /**< Gradients of this worker's shard. */
+  double loss;             /**< Row-weighted loss of the shard. */
+  pthread_t thread;
+} DataParallelWorker;
+
+struct DataParallelTrainer {
+  NeuralNetwork* nn;
+  size_t num_workers;
+  LossFunctionType loss_type;
+  LossFunction loss_func;
+  LossFunctionGrad loss_func_grad;
+  DataParallelWorker* workers;
+
+  pthread_mutex_t launch;    /**< Held while the workers are being started. */
+  pthread_barrier_t start;   /**< Workers and caller: a step is posted. */
+  pthread_barrier_t reduce;  /**< Workers only: all shard gradients ready. */
+  pthread_barrier_t finish;  /**< Workers and caller: reduction complete. */
+  const Matrix* x;           /**< Current batch inputs. */
+  const Matrix* y;           /**< Current batch targets. */
+  size_t slice;              /**< Reduction slice length per worker. */
+  int stop;                  /**< Set to shut the workers down. */
+};
+
+/**
+ * @brief Runs forward and backward passes over one worker's shard of the
+ * batch and stores the shard gradients.
+ * @param worker The worker.
+ */
+static void compute_shard(DataParallelWorker* worker) {
+  DataParallelTrainer* trainer = worker->trainer;
+  const Matrix* x = trainer->x;
+  const Matrix* y = trainer->y;
+  size_t per_worker = (x->rows + trainer->num_workers - 1) /
+                      trainer->num_workers;
+  size_t begin = worker->index * per_worker;
+  size_t end = begin + per_worker;
+  if (end > x->rows) {
+    end = x->rows;
+  }
+
+  worker->loss = 0.0;
+  if (begin >= end) {
+    zero_gradients(worker->grads);
+    return;
+  }
+
+  // Shards are contiguous row ranges, so they can alias the batch.
+  Matrix* x_shard =
+      create_matrix_view(x->matrix_data + begin * x->cols, end - begin,
+                         x->cols);
+  Matrix* y_shard =
+      create_matrix_view(y->matrix_data + begin * y->cols, end - begin,
+                         y->cols);
+
+  Matrix* y_hat = feedforward(worker->replica, x_shard);
+  if (trainer->loss_func != NULL) {
+    worker->loss = trainer->loss_func(y_hat, y_shard) * (double)(end - begin);
+  }
+  backpropagate_gradients(worker->replica, y_shard, trainer->loss_type,
+                          trainer->loss_func_grad, worker->grads, NULL, NULL);
+
+  free_matrix(y_hat);
+  free_matrix_view(x_shard);
+  free_matrix_view(y_shard);
+}
+
+/**
+ * @brief Sums this worker's slice of every worker's gradients into the first
+ * worker's buffer.
+ * @param worker The worker.
+ */
+static void reduce_slice(DataParallelWorker* worker) {
+  DataParallelTrainer* trainer = worker->trainer;
+  size_t size = trainer->workers[0].grads->size;
+  size_t begin = worker->index * trainer->slice;
+  size_t end = begin + trainer->slice;
+  if (end > size) {
+    end = size;
+  }
+  if (begin >= end) {
+    return;
+  }
+
+  double* restrict total = trainer->workers[0].grads->data;
+  for (size_t w = 1; w < trainer->num_workers; w++) {
+    const double* restrict part = trainer->workers[w].grads->data;
+    for (size_t i = begin; i < end; i++) {
+      total[i] += part[i];
+    }
+  }
+}
+
+/**
+ * @brief Worker thread main loop.
+ * @param arg A pointer to the DataParallelWorker.
+ * @return Always NULL.
+ */
+static void* data_parallel_worker(void* arg) {
+  DataParallelWorker* worker = (DataParallelWorker*)arg;
+  DataParallelTrainer* trainer = worker->trainer;
+
+#ifdef USE_OPENMP
+  // Parallelism comes from the workers; nested teams would oversubscribe.
+  omp_set_num_threads(1);
+#endif
+
+  // Wait until every worker was started; on failure `stop` is already set and
+  // the barriers are never entered.
+  pthread_mutex_lock(&trainer->launch);
+  int stop = trainer->stop;
+  pthread_mutex_unlock(&trainer->launch);
+  if (stop) {
+    return NULL;
+  }
+
+  for (;;) {
+    pthread_barrier_wait(&trainer->start);
+    if (trainer->stop) {
+      break;
+    }
+    compute_shard(worker);
+    pthread_barrier_wait(&trainer->reduce);
+    reduce_slice(worker);
+    pthread_barrier_wait(&trainer->finish);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Stops and joins the first `started` workers and frees the trainer.
+ * When not every worker was started, `stop` must already be set.
+ * @param trainer The trainer.
+ * @param started Number of worker threads that were started.
+ */
+static void shutdown_trainer(DataParallelTrainer* trainer, size_t started) {
+  if (started == trainer->num_workers) {
+    trainer->stop = 1;
+    pthread_barrier_wait(&trainer->start);
+  }
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(trainer->workers[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < trainer->num_workers; i++) {
+    free_network_replica(trainer->workers[i].replica);
+    free_gradients(trainer->workers[i].grads);
+  }
+  pthread_mutex_destroy(&trainer->launch);
+  pthread_barrier_destroy(&trainer->start);
+  pthread_barrier_destroy(&trainer->reduce);
+  pthread_barrier_destroy(&trainer->finish);
+  free(trainer->workers);
+  free(trainer);
+}
+
+/**
+ * @brief Creates a data-parallel trainer and starts its worker threads.
+ * @param nn A pointer to the NeuralNetwork to train.
+ * @param num_workers The number of worker threads.
+ * @param loss_type The loss type passed to backpropagate.
+ * @param loss_func The loss reported by data_parallel_step, or NULL.
+ * @param loss_func_grad The gradient of the loss.
+ * @return A pointer to the new trainer, or NULL on failure.
+ */
+DataParallelTrainer* create_data_parallel_trainer(
+    NeuralNetwork* nn, size_t num_workers, LossFunctionType loss_type,
+    LossFunction loss_func, LossFunctionGrad loss_func_grad) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Data-parallel training supports dense layers only.");
+  ASSERT(num_workers > 0, "Number of workers must be greater than 0.");
+  ASSERT(loss_func_grad != NULL, "Loss gradient function cannot be NULL.");
+
+  DataParallelTrainer* trainer =
+      (DataParallelTrainer*)calloc(1, sizeof(DataParallelTrainer));
+  CHECK_ALLOC(trainer);
+  trainer->nn = nn;
+  trainer->num_workers = num_workers;
+  trainer->loss_type = loss_type;
+  trainer->loss_func = loss_func;
+  trainer->loss_func_grad = loss_func_grad;
+  trainer->workers =
+      (DataParallelWorker*)calloc(num_workers, sizeof(DataParallelWorker));
+  if (trainer->workers == NULL) {
+    LOG_ERROR("Memory allocation failed for training workers.");
+    free(trainer);
+    return NULL;
+  }
+  pthread_mutex_init(&trainer->launch, NULL);
+  pthread_barrier_init(&trainer->start, NULL, (unsigned)num_workers + 1);
+  pthread_barrier_init(&trainer->reduce, NULL, (unsigned)num_workers);
+  pthread_barrier_init(&trainer->finish, NULL, (unsigned)num_workers + 1);
+
+  for (size_t i = 0; i < num_workers; i++) {
+    DataParallelWorker* worker = &trainer->workers[i];
+    worker->trainer = trainer;
+    worker->index = i;
+    worker->replica = create_network_replica(nn);
+    worker->grads = create_gradients(nn);
+    if (worker->replica == NULL || worker->grads == NULL) {
+      LOG_ERROR("Failed to set up training worker %zu.", i);
+      shutdown_trainer(trainer, 0);
+      return NULL;
+    }
+  }
+
+  size_t size = trainer->workers[0].grads->size;
+  size_t slice = (size + num_workers - 1) / num_workers;
+  trainer->slice = (slice + REDUCE_SLICE_ALIGNMENT - 1) /
+                   REDUCE_SLICE_ALIGNMENT * REDUCE_SLICE_ALIGNMENT;
+
+  pthread_mutex_lock(&trainer->launch);
+  size_t started = 0;
+  while (started < num_workers &&
+         pthread_create(&trainer->workers[started].thread, NULL,
+                        data_parallel_worker,
+                        &trainer->workers[started]) == 0) {
+    started++;
+  }
+  if (started < num_workers) {
+    LOG_ERROR("Failed to start training worker %zu.", started);
+    trainer->stop = 1;
+  }
+  pthread_mutex_unlock(&trainer->launch);
+  if (started < num_workers) {
+    shutdown_trainer(trainer, started);
+    return NULL;
+  }
+
+  LOG_INFO("Started data-parallel trainer with %zu workers.", num_workers);
+  return trainer;
+}
+
+/**
+ * @brief Runs one training step with the batch split across the workers.
+ * @param trainer A pointer to the DataParallelTrainer.
+ * @param opt A pointer to the Optimizer for the trainer's network.
+ * @param x A pointer to the batch inputs.
+ * @param y A pointer to the batch targets.
+ * @return The batch loss before the update, or 0 if no loss was given.
+ */
+double data_parallel_step(DataParallelTrainer* trainer, Optimizer* opt,
+                          const Matrix* x, const Matrix* y) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(x != NULL && y != NULL, "Batch matrices cannot be NULL.");
+  ASSERT(x->rows == y->rows, "Inputs and targets must have the same rows.");
+  ASSERT(x->rows > 0, "Batch cannot be empty.");
+
+  trainer->x = x;
+  trainer->y = y;
+  // Replicas follow train/eval switches made on the master since last step.
+  for (size_t i = 0; i < trainer->num_workers; i++) {
+    trainer->workers[i].replica->training = trainer->nn->training;
+  }
+  pthread_barrier_wait(&trainer->start);
+  pthread_barrier_wait(&trainer->finish);
+
+  double loss = 0.0;
+  for (size_t i = 0; i < trainer->num_workers; i++) {
+    loss += trainer->workers[i].loss;
+  }
+  optimizer_apply_gradients(opt, trainer->nn, trainer->workers[0].grads);
+  return loss / (double)x->rows;
+}
+
+/**
+ * @brief Stops the worker threads and frees the trainer.
+ * @param trainer A pointer to the DataParallelTrainer to free.
+ */
+void free_data_parallel_trainer(DataParallelTrainer* trainer) {
+  if (trainer == NULL) {
+    return;
+  }
+  shutdown_trainer(trainer, trainer->num_workers);
+}
@@ -0,0 +1,208 @@
+/**
+ * @file hogwild.c
+ * @brief Lock-free asynchronous SGD over shared layer weights.
+ *
+ * The only shared mutable state besides the weights is the atomic batch
+ * counter. Weight reads and writes from different workers race by design;
+ * each worker's forward and backward scratch lives in its own replica cache
+ * and gradient buffer, so nothing else is shared.
+ */
+#include "parallel_training.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "utils.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+/** @brief State shared by all Hogwild workers. */
+typedef struct {
+  NeuralNetwork* nn;
+  const Matrix* x;
+  const Matrix* y;
+  size_t batch_size;
+  size_t num_batches;   /**< Mini-batches per epoch. */
+  size_t total_batches; /**< Mini-batches over all epochs. */
+  double learning_rate;
+  LossFunctionType loss_type;
+  LossFunctionGrad loss_func_grad;
+  atomic_size_t next_batch; /**< Next mini-batch to hand out. */
+  atomic_size_t updates;    /**< Updates applied so far. */
+} HogwildShared;
+
+/** @brief Per-thread state. */
+typedef struct {
+  HogwildShared* shared;
+  NeuralNetwork* replica;  /**< Shares the trained network's layers. */
+  NetworkGradients* grads; /**< Scratch gradients of the current batch. */
+  pthread_t thread;
+} HogwildWorker;
+
+/**
+ * @brief Applies param -= lr * grad, skipping zero gradients so sparse
+ * updates leave untouched weights (and their cache lines) alone.
+ * @param param The shared parameters.
+ * @param grad The gradients.
+ * @param learning_rate The step size.
+ * @param n Number of elements.
+ */
+static void hogwild_apply(double* param, const double* grad,
+                          double learning_rate, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (grad[i] != 0.0) {
+      param[i] -= learning_rate * grad[i];
+    }
+  }
+}
+
+/**
+ * @brief Worker thread main loop: claims mini-batches until none are left.
+ * @param arg A pointer to the HogwildWorker.
+ * @return Always NULL.
+ */
+static void* hogwild_worker(void* arg) {
+  HogwildWorker* worker = (HogwildWorker*)arg;
+  HogwildShared* shared = worker->shared;
+  const Matrix* x = shared->x;
+  const Matrix* y = shared->y;
+
+#ifdef USE_OPENMP
+  // Parallelism comes from the workers; nested teams would oversubscribe.
+  omp_set_num_threads(1);
+#endif
+
+  for (;;) {
+    size_t batch = atomic_fetch_add_explicit(&shared->next_batch, 1,
+                                             memory_order_relaxed);
+    if (batch >= shared->total_batches) {
+      break;
+    }
+    size_t begin = (batch % shared->num_batches) * shared->batch_size;
+    size_t end = begin + shared->batch_size;
+    if (end > x->rows) {
+      end = x->rows;
+    }
+
+    Matrix* x_batch = create_matrix_view(x->matrix_data + begin * x->cols,
+                                         end - begin, x->cols);
+    Matrix* y_batch = create_matrix_view(y->matrix_data + begin * y->cols,
+                                         end - begin, y->cols);
+    Matrix* y_hat = feedforward(worker->replica, x_batch);
+    backpropagate_gradients(worker->replica, y_batch, shared->loss_type,
+                            shared->loss_func_grad, worker->grads, NULL, NULL);
+
+    for (size_t i = 0; i < shared->nn->num_layers; i++) {
+      Layer* layer = shared->nn->layers[i];
+      hogwild_apply(layer->weights->matrix_data,
+                    worker->grads->weights[i]->matrix_data,
+                    shared->learning_rate,
+                    layer->weights->rows * layer->weights->cols);
+      hogwild_apply(layer->bias->matrix_data,
+                    worker->grads->bias[i]->matrix_data,
+                    shared->learning_rate,
+                    layer->bias->rows * layer->bias->cols);
+    }
+    atomic_fetch_add_explicit(&shared->updates, 1, memory_order_relaxed);
+
+    free_matrix(y_hat);
+    free_matrix_view(x_batch);
+    free_matrix_view(y_batch);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Trains a network with Hogwild-style asynchronous SGD.
+ * @param nn A pointer to the NeuralNetwork to train.
+ * @param x A pointer to the training inputs.
+ * @param y A pointer to the training targets.
+ * @param batch_size The number of rows per mini-batch.
+ * @param epochs The number of passes over the data.
+ * @param learning_rate The SGD step size.
+ * @param num_workers The number of worker threads.
+ * @param loss_type The loss type passed to backpropagate.
+ * @param loss_func_grad The gradient of the loss.
+ * @return The number of updates applied, or -1 if allocation failed or a
+ * worker could not start. Workers that did start may already have updated
+ * the weights.
+ */
+long hogwild_train(NeuralNetwork* nn, const Matrix* x, const Matrix* y,
+                   size_t batch_size, size_t epochs, double learning_rate,
+                   size_t num_workers, LossFunctionType loss_type,
+                   LossFunctionGrad loss_func_grad) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Hogwild training supports dense layers only.");
+  ASSERT(x != NULL && y != NULL, "Training matrices cannot be NULL.");
+  ASSERT(x->rows == y->rows, "Inputs and targets must have the same rows.");
+  ASSERT(x->rows > 0, "Training data cannot be empty.");
+  ASSERT(batch_size > 0, "Batch size must be greater than 0.");
+  ASSERT(num_workers > 0, "Number of workers must be greater than 0.");
+  ASSERT(loss_func_grad != NULL, "Loss gradient function cannot be NULL.");
+
+  HogwildShared shared;
+  shared.nn = nn;
+  shared.x = x;
+  shared.y = y;
+  shared.batch_size = batch_size;
+  shared.num_batches = (x->rows + batch_size - 1) / batch_size;
+  shared.total_batches = shared.num_batches * epochs;
+  shared.learning_rate = learning_rate;
+  shared.loss_type = loss_type;
+  shared.loss_func_grad = loss_func_grad;
+  atomic_init(&shared.next_batch, 0);
+  atomic_init(&shared.updates, 0);
+
+  HogwildWorker* workers =
+      (HogwildWorker*)calloc(num_workers, sizeof(HogwildWorker));
+  if (workers == NULL) {
+    LOG_ERROR("Memory allocation failed for Hogwild workers.");
+    return -1;
+  }
+
+  size_t started = 0;
+  for (; started < num_workers; started++) {
+    HogwildWorker* worker = &workers[started];
+    worker->shared = &shared;
+    worker->replica = create_network_replica(nn);
+    worker->grads = create_gradients(nn);
+    if (worker->replica == NULL || worker->grads == NULL ||
+        pthread_create(&worker->thread, NULL, hogwild_worker, worker) != 0) {
+      LOG_ERROR("Failed to start Hogwild worker %zu.", started);
+      free_network_replica(worker->replica);
+      free_gradients(worker->grads);
+      break;
+    }
+  }
+  if (started < num_workers) {
+    // Let the running workers drain nothing and exit.
+    atomic_store(&shared.next_batch, shared.total_batches);
+  }
+
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    free_network_replica(workers[i].replica);
+    free_gradients(workers[i].grads);
+  }
+  free(workers);
+
+  if (started < num_workers) {
+    LOG_ERROR("Hogwild training stopped: only %zu of %zu workers started; "
+              "the weights are partially updated.",
+              started, num_workers);
+    return -1;
+  }
+  size_t updates = atomic_load(&shared.updates);
+  LOG_INFO("Hogwild training applied %zu updates with %zu workers.", updates,
+           num_workers);
+  return (long)updates;
+}
@@ -0,0 +1,491 @@
+/**
+ * @file mixed_precision.c
+ * @brief Mixed-precision training with float32 compute and dynamic loss
+ * scaling.
+ *
+ * The trainer keeps float32 copies of the weights, of every layer's z and
+ * activation, and of the gradients, laid out like NetworkGradients (weights
+ * then bias per layer). The double master weights are only read when they are
+ * cast at the start of a step and only written by the optimizer.
+ */
+#include "mixed_precision.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "activation.h"
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+#include "utils.h"
+
+struct MixedPrecisionTrainer {
+  NeuralNetwork* nn;
+  LossFunctionType loss_type;
+  LossFunction loss_func;
+  LossFunctionGrad loss_func_grad;
+
+  float* params;        /**< float32 weights and biases (num_parameters). */
+  float** weights;      /**< Per-layer views into params. */
+  float** bias;         /**< Per-layer views into params. */
+  float* grad_data;     /**< Scaled float32 gradients (num_parameters). */
+  float** grad_weights; /**< Per-layer views into grad_data. */
+  float** grad_bias;    /**< Per-layer views into grad_data. */
+  size_t num_parameters;
+  NetworkGradients* grads; /**< Unscaled gradients for the optimizer. */
+
+  size_t capacity;  /**< Batch rows the activation buffers can hold. */
+  size_t max_width; /**< Widest layer input or output. */
+  float* input;     /**< float32 copy of the batch inputs. */
+  float** z;        /**< Per-layer pre-activations. */
+  float** a;        /**< Per-layer activations. */
+  float* delta;
+  float* delta_prev;
+
+  double loss_scale;
+  size_t good_steps; /**< Clean steps since the scale last changed. */
+  size_t skipped;    /**< Steps skipped because of overflow. */
+};
+
+//============================
+// float32 kernels
+//============================
+
+/**
+ * @brief z = x · W + b followed by the layer's activation, in float32.
+ * @param layer The layer (for shape and activation).
+ * @param w Weights (in x out).
+ * @param b Bias (out).
+ * @param x Inputs (rows x in).
+ * @param z Receives the pre-activations (rows x out).
+ * @param a Receives the activations (rows x out).
+ * @param rows Batch rows.
+ */
+static void layer_forward_f32(const Layer* layer, const float* w,
+                              const float* b, const float* x, float* z,
+                              float* a, size_t rows) {
+  size_t in = layer->weights->rows;
+  size_t out = layer->weights->cols;
+
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t r = 0; r < rows; r++) {
+    float* z_row = z + r * out;
+    float* a_row = a + r * out;
+    memcpy(z_row, b, out * sizeof(float));
+    for (size_t k = 0; k < in; k++) {
+      float x_rk = x[r * in + k];
+      const float* w_row = w + k * out;
+      for (size_t j = 0; j < out; j++) {
+        z_row[j] += x_rk * w_row[j];
+      }
+    }
+
+    if (layer->activation_type == SOFTMAX) {
+      float max = z_row[0];
+      for (size_t j = 1; j < out; j++) {
+        max = z_row[j] > max ? z_row[j] : max;
+      }
+      float sum = 0.0f;
+      for (size_t j = 0; j < out; j++) {
+        a_row[j] = expf(z_row[j] - max);
+        sum += a_row[j];
+      }
+      for (size_t j = 0; j < out; j++) {
+        a_row[j] /= sum;
+      }
+    } else {
+      for (size_t j = 0; j < out; j++) {
+        a_row[j] = (float)activate_scalar(layer->activation_type, z_row[j],
+                                          layer->leak_parameter);
+      }
+    }
+  }
+}
+
+/**
+ * @brief dW = x^T · delta and db = column sums of delta, in float32.
+ * @param in Layer inputs.
+ * @param out Layer outputs.
+ * @param x Inputs (rows x in).
+ * @param delta Output deltas (rows x out).
+ * @param dw Receives the weight gradients (in x out).
+ * @param db Receives the bias gradients (out).
+ * @param rows Batch rows.
+ */
+static void layer_gradients_f32(size_t in, size_t out, const float* x,
+                                const float* delta, float* dw, float* db,
+                                size_t rows) {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t i = 0; i < in; i++) {
+    float* dw_row = dw + i * out;
+    memset(dw_row, 0, out * sizeof(float));
+    for (size_t r = 0; r < rows; r++) {
+      float x_ri = x[r * in + i];
+      const float* delta_row = delta + r * out;
+      for (size_t j = 0; j < out; j++) {
+        dw_row[j] += x_ri * delta_row[j];
+      }
+    }
+  }
+
+  memset(db, 0, out * sizeof(float));
+  for (size_t r = 0; r < rows; r++) {
+    for (size_t j = 0; j < out; j++) {
+      db[j] += delta[r * out + j];
+    }
+  }
+}
+
+/**
+ * @brief delta_prev = (delta · W^T) .* a'(z_prev), in float32.
+ * @param prev_layer The layer whose pre-activations are z_prev.
+ * @param in Layer inputs (width of delta_prev).
+ * @param out Layer outputs (width of delta).
+ * @param w Weights (in x out).
+ * @param delta Output deltas (rows x out).
+ * @param z_prev Pre-activations of the previous layer (rows x in).
+ * @param delta_prev Receives the deltas of the previous layer (rows x in).
+ * @param rows Batch rows.
+ */
+static void propagate_delta_f32(const Layer* prev_layer, size_t in, size_t out,
+                                const float* w, const float* delta,
+                                const float* z_prev, float* delta_prev,
+                                size_t rows) {
+#ifdef USE_OPENMP
+#pragma omp parallel for
+#endif
+  for (size_t r = 0; r < rows; r++) {
+    const float* delta_row = delta + r * out;
+    for (size_t i = 0; i < in; i++) {
+      const float* w_row = w + i * out;
+      float sum = 0.0f;
+      for (size_t j = 0; j < out; j++) {
+        sum += delta_row[j] * w_row[j];
+      }
+      delta_prev[r * in + i] =
+          sum * (float)activation_prime_scalar(prev_layer->activation_type,
+                                               z_prev[r * in + i],
+                                               prev_layer->leak_parameter);
+    }
+  }
+}
+
+//============================
+// Trainer
+//============================
+
+/**
+ * @brief Frees the per-layer activation buffers.
+ * @param trainer The trainer.
+ */
+static void free_activation_buffers(MixedPrecisionTrainer* trainer) {
+  for (size_t l = 0; l < trainer->nn->num_layers; l++) {
+    free(trainer->z[l]);
+    free(trainer->a[l]);
+    trainer->z[l] = NULL;
+    trainer->a[l] = NULL;
+  }
+  free(trainer->input);
+  free(trainer->delta);
+  free(trainer->delta_prev);
+  trainer->input = NULL;
+  trainer->delta = NULL;
+  trainer->delta_prev = NULL;
+  trainer->capacity = 0;
+}
+
+/**
+ * @brief Grows the activation buffers to hold `rows` batch rows.
+ * @param trainer The trainer.
+ * @param rows The batch rows.
+ * @return 1 on success, 0 on allocation failure.
+ */
+static int reserve_rows(MixedPrecisionTrainer* trainer, size_t rows) {
+  if (rows <= trainer->capacity) {
+    return 1;
+  }
+  free_activation_buffers(trainer);
+
+  NeuralNetwork* nn = trainer->nn;
+  size_t in = nn->layers[0]->weights->rows;
+  trainer->input = (float*)malloc(rows * in * sizeof(float));
+  trainer->delta = (float*)malloc(rows * trainer->max_width * sizeof(float));
+  trainer->delta_prev =
+      (float*)malloc(rows * trainer->max_width * sizeof(float));
+  int ok = trainer->input != NULL && trainer->delta != NULL &&
+           trainer->delta_prev != NULL;
+  for (size_t l = 0; ok && l < nn->num_layers; l++) {
+    size_t out = nn->layers[l]->weights->cols;
+    trainer->z[l] = (float*)malloc(rows * out * sizeof(float));
+    trainer->a[l] = (float*)malloc(rows * out * sizeof(float));
+    ok = trainer->z[l] != NULL && trainer->a[l] != NULL;
+  }
+  if (!ok) {
+    LOG_ERROR("Memory allocation failed for mixed-precision activations.");
+    free_activation_buffers(trainer);
+    return 0;
+  }
+  trainer->capacity = rows;
+  return 1;
+}
+
+MixedPrecisionTrainer* create_mixed_precision_trainer(
+    NeuralNetwork* nn, LossFunctionType loss_type, LossFunction loss_func,
+    LossFunctionGrad loss_func_grad, double initial_scale) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Mixed-precision training supports dense layers only.");
+  ASSERT(nn->num_layers > 0, "Network must have at least one layer.");
+  ASSERT(loss_func_grad != NULL, "Loss gradient function cannot be NULL.");
+  ASSERT(initial_scale >= 1.0, "Loss scale must be at least 1.");
+  if (initial_scale > MIXED_PRECISION_MAX_SCALE) {
+    LOG_WARN("Initial loss scale %g clamped to %g.", initial_scale,
+             MIXED_PRECISION_MAX_SCALE);
+    initial_scale = MIXED_PRECISION_MAX_SCALE;
+  }
+
+  MixedPrecisionTrainer* trainer =
+      (MixedPrecisionTrainer*)calloc(1, sizeof(MixedPrecisionTrainer));
+  if (trainer == NULL) {
+    LOG_ERROR("Memory allocation failed for mixed-precision trainer.");
+    return NULL;
+  }
+  trainer->nn = nn;
+  trainer->loss_type = loss_type;
+  trainer->loss_func = loss_func;
+  trainer->loss_func_grad = loss_func_grad;
+  trainer->loss_scale = initial_scale;
+
+  size_t n = nn->num_layers;
+  trainer->weights = (float**)calloc(n, sizeof(float*));
+  trainer->bias = (float**)calloc(n, sizeof(float*));
+  trainer->grad_weights = (float**)calloc(n, sizeof(float*));
+  trainer->grad_bias = (float**)calloc(n, sizeof(float*));
+  trainer->z = (float**)calloc(n, sizeof(float*));
+  trainer->a = (float**)calloc(n, sizeof(float*));
+  trainer->grads = create_gradients(nn);
+  if (trainer->weights == NULL || trainer->bias == NULL ||
+      trainer->grad_weights == NULL || trainer->grad_bias == NULL ||
+      trainer->z == NULL || trainer->a == NULL || trainer->grads == NULL) {
+    LOG_ERROR("Memory allocation failed for mixed-precision trainer.");
+    free_mixed_precision_trainer(trainer);
+    return NULL;
+  }
+
+  trainer->num_parameters = trainer->grads->size;
+  trainer->params = (float*)malloc(trainer->num_parameters * sizeof(float));
+  trainer->grad_data =
+      (float*)malloc(trainer->num_parameters * sizeof(float));
+  if (trainer->params == NULL || trainer->grad_data == NULL) {
+    LOG_ERROR("Memory allocation failed for mixed-precision parameters.");
+    free_mixed_precision_trainer(trainer);
+    return NULL;
+  }
+
+  size_t offset = 0;
+  trainer->max_width = nn->layers[0]->weights->rows;
+  for (size_t l = 0; l < n; l++) {
+    const Layer* layer = nn->layers[l];
+    size_t weight_count = layer->weights->rows * layer->weights->cols;
+    size_t bias_count = layer->bias->rows * layer->bias->cols;
+    trainer->weights[l] = trainer->params + offset;
+    trainer->grad_weights[l] = trainer->grad_data + offset;
+    offset += weight_count;
+    trainer->bias[l] = trainer->params + offset;
+    trainer->grad_bias[l] = trainer->grad_data + offset;
+    offset += bias_count;
+    if (layer->weights->cols > trainer->max_width) {
+      trainer->max_width = layer->weights->cols;
+    }
+  }
+  ASSERT(offset == trainer->num_parameters,
+         "Gradient layout does not match the network.");
+  return trainer;
+}
+
+/**
+ * @brief Computes the scaled float32 delta of the output layer. The loss and
+ * its gradient are evaluated in double on the float32 outputs.
+ * @param trainer The trainer, after the float32 forward pass.
+ * @param y The targets.
+ * @return The loss of the batch, or 0 if the trainer has no loss function.
+ */
+static double output_delta_f32(MixedPrecisionTrainer* trainer,
+                               const Matrix* y) {
+  NeuralNetwork* nn = trainer->nn;
+  size_t last = nn->num_layers - 1;
+  const Layer* layer = nn->layers[last];
+  size_t rows = y->rows;
+  size_t out = layer->weights->cols;
+  size_t count = rows * out;
+
+  Matrix* y_hat = create_matrix(rows, out);
+  Matrix* delta = create_matrix(rows, out);
+  CHECK_MALLOC(y_hat, "Failed to allocate output for mixed precision.");
+  CHECK_MALLOC(delta, "Failed to allocate delta for mixed precision.");
+  for (size_t i = 0; i < count; i++) {
+    y_hat->matrix_data[i] = (double)trainer->a[last][i];
+  }
+  double loss =
+      (trainer->loss_func != NULL) ? trainer->loss_func(y_hat, y) : 0.0;
+
+  Matrix* z = create_matrix(rows, out);
+  CHECK_MALLOC(z, "Failed to allocate logits for mixed precision.");
+  for (size_t i = 0; i < count; i++) {
+    z->matrix_data[i] = (double)trainer->z[last][i];
+  }
+  if (layer->activation_type == SOFTMAX && trainer->loss_type == CCE) {
+    softmax_cross_entropy(z, y, delta);
+  } else {
+    Matrix* dL_da = trainer->loss_func_grad(y_hat, y);
+    ASSERT(dL_da != NULL, "Loss gradient returned NULL.");
+    Matrix* act_prime = activation_derivative_for_layer(layer, z);
+    for (size_t i = 0; i < count; i++) {
+      delta->matrix_data[i] =
+          dL_da->matrix_data[i] * act_prime->matrix_data[i];
+    }
+    free_matrix(dL_da);
+    free_matrix(act_prime);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    trainer->delta[i] = (float)(delta->matrix_data[i] * trainer->loss_scale);
+  }
+  free_matrix(z);
+  free_matrix(y_hat);
+  free_matrix(delta);
+  return loss;
+}
+
+double mixed_precision_step(MixedPrecisionTrainer* trainer, Optimizer* opt,
+                            const Matrix* x, const Matrix* y) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(x != NULL && y != NULL, "Batch matrices cannot be NULL.");
+  ASSERT(x->rows == y->rows, "Inputs and targets must have the same rows.");
+  ASSERT(x->rows > 0, "Batch cannot be empty.");
+
+  NeuralNetwork* nn = trainer->nn;
+  size_t rows = x->rows;
+  ASSERT(x->cols == nn->layers[0]->weights->rows,
+         "Input columns do not match the first layer.");
+  ASSERT(!network_has_dropout(nn),
+         "Mixed-precision training does not implement dropout.");
+  if (!reserve_rows(trainer, rows)) {
+    LOG_ERROR("Memory allocation failed for %zu-row activation buffers.",
+              rows);
+    return -1.0;
+  }
+
+  // Cast the master weights and the batch to float32.
+  for (size_t l = 0; l < nn->num_layers; l++) {
+    const Layer* layer = nn->layers[l];
+    size_t weight_count = layer->weights->rows * layer->weights->cols;
+    size_t bias_count = layer->bias->rows * layer->bias->cols;
+    for (size_t i = 0; i < weight_count; i++) {
+      trainer->weights[l][i] = (float)layer->weights->matrix_data[i];
+    }
+    for (size_t i = 0; i < bias_count; i++) {
+      trainer->bias[l][i] = (float)layer->bias->matrix_data[i];
+    }
+  }
+  for (size_t i = 0; i < rows * x->cols; i++) {
+    trainer->input[i] = (float)x->matrix_data[i];
+  }
+
+  const float* input = trainer->input;
+  for (size_t l = 0; l < nn->num_layers; l++) {
+    layer_forward_f32(nn->layers[l], trainer->weights[l], trainer->bias[l],
+                      input, trainer->z[l], trainer->a[l], rows);
+    input = trainer->a[l];
+  }
+
+  double loss = output_delta_f32(trainer, y);
+
+  for (size_t l = nn->num_layers - 1; l != SIZE_MAX; l--) {
+    const Layer* layer = nn->layers[l];
+    size_t in = layer->weights->rows;
+    size_t out = layer->weights->cols;
+    const float* a_prev = (l == 0) ? trainer->input : trainer->a[l - 1];
+    layer_gradients_f32(in, out, a_prev, trainer->delta,
+                        trainer->grad_weights[l], trainer->grad_bias[l], rows);
+    if (l > 0) {
+      propagate_delta_f32(nn->layers[l - 1], in, out, trainer->weights[l],
+                          trainer->delta, trainer->z[l - 1],
+                          trainer->delta_prev, rows);
+      float* swap = trainer->delta;
+      trainer->delta = trainer->delta_prev;
+      trainer->delta_prev = swap;
+    }
+  }
+
+  int overflow = 0;
+  for (size_t i = 0; i < trainer->num_parameters; i++) {
+    if (!isfinite(trainer->grad_data[i])) {
+      overflow = 1;
+      break;
+    }
+  }
+  if (overflow) {
+    trainer->skipped++;
+    trainer->good_steps = 0;
+    if (trainer->loss_scale > 1.0) {
+      trainer->loss_scale *= 0.5;
+    }
+    LOG_INFO("Gradient overflow; skipping step, loss scale now %g.",
+             trainer->loss_scale);
+    return loss;
+  }
+
+  double inv_scale = 1.0 / trainer->loss_scale;
+  for (size_t i = 0; i < trainer->num_parameters; i++) {
+    trainer->grads->data[i] = (double)trainer->grad_data[i] * inv_scale;
+  }
+  optimizer_apply_gradients(opt, nn, trainer->grads);
+
+  if (++trainer->good_steps == MIXED_PRECISION_GROWTH_INTERVAL) {
+    trainer->good_steps = 0;
+    if (trainer->loss_scale * 2.0 <= MIXED_PRECISION_MAX_SCALE) {
+      trainer->loss_scale *= 2.0;
+    }
+  }
+  return loss;
+}
+
+double mixed_precision_loss_scale(const MixedPrecisionTrainer* trainer) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  return trainer->loss_scale;
+}
+
+size_t mixed_precision_skipped_steps(const MixedPrecisionTrainer* trainer) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  return trainer->skipped;
+}
+
+void free_mixed_precision_trainer(MixedPrecisionTrainer* trainer) {
+  if (trainer == NULL) {
+    return;
+  }
+  if (trainer->z != NULL && trainer->a != NULL) {
+    free_activation_buffers(trainer);
+  }
+  free(trainer->z);
+  free(trainer->a);
+  free(trainer->params);
+  free(trainer->grad_data);
+  free(trainer->weights);
+  free(trainer->bias);
+  free(trainer->grad_weights);
+  free(trainer->grad_bias);
+  free_gradients(trainer->grads);
+  free(trainer);
+}
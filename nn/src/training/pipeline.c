@@ -0,0 +1,538 @@
+/**
+ * @file pipeline.c
+ * @brief Pipeline-parallel training with a 1F1B micro-batch schedule.
+ *
+ * Each stage thread owns a contiguous range of layers. Activations travel
+ * forward and activation gradients travel backward through per-micro-batch
+ * mailboxes. Stage s runs (num_stages - s - 1) warm-up forwards, then
+ * alternates one forward with one backward, then drains the remaining
+ * backwards, so at most (num_stages - s) micro-batches are held by a stage at
+ * once. Stages accumulate dW and db for their own layers into disjoint parts
+ * of one gradient buffer; the caller applies a single optimizer update when
+ * every stage is done.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel_training.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+#include "utils.h"
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+/** @brief Per-stage state. */
+typedef struct {
+  PipelineTrainer* trainer;
+  size_t index;       /**< Stage index. */
+  size_t first_layer; /**< First layer owned by the stage. */
+  size_t end_layer;   /**< One past the last layer owned by the stage. */
+  Matrix** inputs;    /**< Saved layer inputs [layer][micro-batch]. */
+  Matrix** zs;        /**< Saved pre-activations [layer][micro-batch]. */
+  Matrix** outputs;   /**< Last stage only: network output per micro-batch
+                         (NULL when fused, the logits are in `zs`). */
+  double loss;        /**< Last stage only: row-weighted loss of the step. */
+  pthread_t thread;
+} PipelineStage;
+
+struct PipelineTrainer {
+  NeuralNetwork* nn;
+  size_t num_stages;
+  size_t max_micro_batches;
+  LossFunctionType loss_type;
+  int fused; /**< SOFTMAX output with CCE: the loss runs on the logits. */
+  LossFunction loss_func;
+  LossFunctionGrad loss_func_grad;
+  PipelineStage* stages;
+  NetworkGradients* grads; /**< Gradients accumulated over micro-batches. */
+
+  pthread_mutex_t lock;      /**< Guards the mailboxes. */
+  pthread_cond_t delivered;  /**< Broadcast whenever a mailbox is filled. */
+  Matrix** forward_mail;     /**< Input of stage s, micro-batch k. */
+  Matrix** backward_mail;    /**< dL/d(output) of stage s, micro-batch k. */
+  pthread_barrier_t start;   /**< Stages and caller: a step is posted. */
+  pthread_barrier_t finish;  /**< Stages and caller: the step is done. */
+  const Matrix* y;           /**< Current batch targets. */
+  size_t num_micro_batches;  /**< Micro-batches in the current step. */
+  size_t micro_rows;         /**< Rows per micro-batch (last may be short). */
+  int stop;                  /**< Set to shut the stages down. */
+};
+
+/**
+ * @brief Delivers a matrix to a mailbox and wakes the waiting stage.
+ * @param trainer The trainer.
+ * @param mail The mailbox array.
+ * @param stage The receiving stage.
+ * @param micro The micro-batch.
+ * @param m The matrix to deliver; ownership passes to the receiver.
+ */
+static void post_mail(PipelineTrainer* trainer, Matrix** mail, size_t stage,
+                      size_t micro, Matrix* m) {
+  pthread_mutex_lock(&trainer->lock);
+  mail[stage * trainer->max_micro_batches + micro] = m;
+  pthread_cond_broadcast(&trainer->delivered);
+  pthread_mutex_unlock(&trainer->lock);
+}
+
+/**
+ * @brief Blocks until a mailbox is filled and empties it.
+ * @param trainer The trainer.
+ * @param mail The mailbox array.
+ * @param stage The receiving stage.
+ * @param micro The micro-batch.
+ * @return The delivered matrix.
+ */
+static Matrix* take_mail(PipelineTrainer* trainer, Matrix** mail, size_t stage,
+                         size_t micro) {
+  Matrix** slot = &mail[stage * trainer->max_micro_batches + micro];
+  pthread_mutex_lock(&trainer->lock);
+  while (*slot == NULL) {
+    pthread_cond_wait(&trainer->delivered, &trainer->lock);
+  }
+  Matrix* m = *slot;
+  *slot = NULL;
+  pthread_mutex_unlock(&trainer->lock);
+  return m;
+}
+
+/**
+ * @brief Runs the stage's layers forward on one micro-batch, saving inputs
+ * and pre-activations for the backward pass.
+ * @param stage The stage.
+ * @param micro The micro-batch.
+ */
+static void stage_forward(PipelineStage* stage, size_t micro) {
+  PipelineTrainer* trainer = stage->trainer;
+  size_t m = trainer->max_micro_batches;
+  Matrix* current =
+      take_mail(trainer, trainer->forward_mail, stage->index, micro);
+
+  for (size_t l = stage->first_layer; l < stage->end_layer; l++) {
+    const Layer* layer = trainer->nn->layers[l];
+    size_t slot = (l - stage->first_layer) * m + micro;
+    Matrix* z = create_matrix(current->rows, layer->weights->cols);
+    gemm_matrix(0, 0, 1.0, current, layer->weights, 0.0, z);
+    for (size_t r = 0; r < z->rows; r++) {
+      for (size_t j = 0; j < z->cols; j++) {
+        z->matrix_data[r * z->cols + j] += layer->bias->matrix_data[j];
+      }
+    }
+    stage->inputs[slot] = current;
+    stage->zs[slot] = z;
+    // With the fused loss the output probabilities are never materialized.
+    int logits = trainer->fused && l + 1 == trainer->nn->num_layers;
+    current = logits ? NULL : apply_layer_activation(layer, z);
+  }
+
+  if (stage->index + 1 < trainer->num_stages) {
+    post_mail(trainer, trainer->forward_mail, stage->index + 1, micro,
+              current);
+  } else {
+    stage->outputs[micro] = current;
+  }
+}
+
+/**
+ * @brief Returns the rows of the targets that belong to a micro-batch.
+ * @param trainer The trainer.
+ * @param micro The micro-batch.
+ * @return A view into the batch targets.
+ */
+static Matrix* micro_batch_targets(const PipelineTrainer* trainer,
+                                   size_t micro) {
+  const Matrix* y = trainer->y;
+  size_t begin = micro * trainer->micro_rows;
+  size_t end = begin + trainer->micro_rows;
+  if (end > y->rows) {
+    end = y->rows;
+  }
+  return create_matrix_view(y->matrix_data + begin * y->cols, end - begin,
+                            y->cols);
+}
+
+/**
+ * @brief Computes delta for the network's output layer and records the loss.
+ * @param stage The last stage.
+ * @param micro The micro-batch.
+ * @return delta = dL/dz of the output layer.
+ */
+static Matrix* output_delta(PipelineStage* stage, size_t micro) {
+  PipelineTrainer* trainer = stage->trainer;
+  const Layer* last = trainer->nn->layers[stage->end_layer - 1];
+  size_t slot = (stage->end_layer - 1 - stage->first_layer) *
+                    trainer->max_micro_batches +
+                micro;
+  Matrix* z = stage->zs[slot];
+  Matrix* y = micro_batch_targets(trainer, micro);
+
+  Matrix* delta;
+  if (trainer->fused) {
+    delta = create_matrix(z->rows, z->cols);
+    double loss = softmax_cross_entropy(z, y, delta);
+    if (trainer->loss_func != NULL) {
+      stage->loss += loss * (double)y->rows;
+    }
+  } else {
+    Matrix* y_hat = stage->outputs[micro];
+    if (trainer->loss_func != NULL) {
+      stage->loss += trainer->loss_func(y_hat, y) * (double)y->rows;
+    }
+    Matrix* dL_da = trainer->loss_func_grad(y_hat, y);
+    Matrix* act_prime = activation_derivative_for_layer(last, z);
+    delta = multiply_matrix(dL_da, act_prime);
+    free_matrix(dL_da);
+    free_matrix(act_prime);
+    free_matrix(y_hat);
+    stage->outputs[micro] = NULL;
+  }
+
+  free_matrix_view(y);
+  return delta;
+}
+
+/**
+ * @brief Runs the stage's layers backward on one micro-batch, accumulating
+ * dW and db and sending dL/d(input) to the previous stage.
+ * @param stage The stage.
+ * @param micro The micro-batch.
+ */
+static void stage_backward(PipelineStage* stage, size_t micro) {
+  PipelineTrainer* trainer = stage->trainer;
+  size_t m = trainer->max_micro_batches;
+  int is_last = stage->index + 1 == trainer->num_stages;
+  Matrix* grad_out =
+      is_last ? NULL
+              : take_mail(trainer, trainer->backward_mail, stage->index, micro);
+
+  for (size_t l = stage->end_layer; l-- > stage->first_layer;) {
+    const Layer* layer = trainer->nn->layers[l];
+    size_t slot = (l - stage->first_layer) * m + micro;
+    Matrix* input = stage->inputs[slot];
+    Matrix* z = stage->zs[slot];
+
+    Matrix* delta;
+    if (grad_out == NULL) {
+      delta = output_delta(stage, micro);
+    } else {
+      Matrix* act_prime = activation_derivative_for_layer(layer, z);
+      delta = multiply_matrix(grad_out, act_prime);
+      free_matrix(act_prime);
+      free_matrix(grad_out);
+    }
+
+    gemm_matrix(1, 0, 1.0, input, delta, 1.0, trainer->grads->weights[l]);
+    sum_matrix_columns_into(delta, 1.0, trainer->grads->bias[l]);
+
+    grad_out = NULL;
+    if (l > 0) {
+      grad_out = create_matrix(delta->rows, layer->weights->rows);
+      gemm_matrix(0, 1, 1.0, delta, layer->weights, 0.0, grad_out);
+    }
+
+    free_matrix(delta);
+    free_matrix(z);
+    if (stage->index == 0 && l == stage->first_layer) {
+      free_matrix_view(input);  // A view into the caller's batch.
+    } else {
+      free_matrix(input);
+    }
+    stage->inputs[slot] = NULL;
+    stage->zs[slot] = NULL;
+  }
+
+  if (stage->index > 0) {
+    post_mail(trainer, trainer->backward_mail, stage->index - 1, micro,
+              grad_out);
+  }
+}
+
+/**
+ * @brief Runs one step's 1F1B schedule on a stage.
+ * @param stage The stage.
+ */
+static void run_stage_schedule(PipelineStage* stage) {
+  PipelineTrainer* trainer = stage->trainer;
+  size_t micro_batches = trainer->num_micro_batches;
+  size_t warmup = trainer->num_stages - stage->index - 1;
+  if (warmup > micro_batches) {
+    warmup = micro_batches;
+  }
+
+  stage->loss = 0.0;
+  size_t forward = 0;
+  size_t backward = 0;
+  while (forward < warmup) {
+    stage_forward(stage, forward++);
+  }
+  while (forward < micro_batches) {
+    stage_forward(stage, forward++);
+    stage_backward(stage, backward++);
+  }
+  while (backward < micro_batches) {
+    stage_backward(stage, backward++);
+  }
+}
+
+/**
+ * @brief Stage thread main loop.
+ * @param arg A pointer to the PipelineStage.
+ * @return Always NULL.
+ */
+static void* pipeline_stage_thread(void* arg) {
+  PipelineStage* stage = (PipelineStage*)arg;
+  PipelineTrainer* trainer = stage->trainer;
+
+#ifdef USE_OPENMP
+  // Parallelism comes from the stages; nested teams would oversubscribe.
+  omp_set_num_threads(1);
+#endif
+
+  // Wait until every stage was started; on failure `stop` is already set and
+  // the barriers are never entered.
+  pthread_mutex_lock(&trainer->lock);
+  int stop = trainer->stop;
+  pthread_mutex_unlock(&trainer->lock);
+  if (stop) {
+    return NULL;
+  }
+
+  for (;;) {
+    pthread_barrier_wait(&trainer->start);
+    if (trainer->stop) {
+      break;
+    }
+    run_stage_schedule(stage);
+    pthread_barrier_wait(&trainer->finish);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Splits the layers into contiguous stages with roughly equal
+ * parameter counts, giving every stage at least one layer.
+ * @param trainer The trainer with `stages` allocated.
+ */
+static void partition_layers(PipelineTrainer* trainer) {
+  const NeuralNetwork* nn = trainer->nn;
+  size_t total = 0;
+  for (size_t l = 0; l < nn->num_layers; l++) {
+    total += nn->layers[l]->weights->rows * nn->layers[l]->weights->cols;
+  }
+
+  size_t layer = 0;
+  size_t seen = 0;
+  for (size_t s = 0; s < trainer->num_stages; s++) {
+    PipelineStage* stage = &trainer->stages[s];
+    size_t stages_left = trainer->num_stages - s - 1;
+    stage->first_layer = layer;
+    // Take layers until this stage's share is reached, leaving at least one
+    // layer for each remaining stage.
+    do {
+      seen += nn->layers[layer]->weights->rows *
+              nn->layers[layer]->weights->cols;
+      layer++;
+    } while (layer + stages_left < nn->num_layers &&
+             seen * trainer->num_stages < total * (s + 1));
+    if (stages_left == 0) {
+      layer = nn->num_layers;
+    }
+    stage->end_layer = layer;
+  }
+}
+
+/**
+ * @brief Stops and joins the first `started` stages and frees the trainer.
+ * When not every stage was started, `stop` must already be set.
+ * @param trainer The trainer.
+ * @param started Number of stage threads that were started.
+ */
+static void shutdown_pipeline(PipelineTrainer* trainer, size_t started) {
+  if (started == trainer->num_stages) {
+    trainer->stop = 1;
+    pthread_barrier_wait(&trainer->start);
+  }
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(trainer->stages[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < trainer->num_stages; i++) {
+    free(trainer->stages[i].inputs);
+    free(trainer->stages[i].zs);
+    free(trainer->stages[i].outputs);
+  }
+  free_gradients(trainer->grads);
+  free(trainer->forward_mail);
+  free(trainer->backward_mail);
+  pthread_mutex_destroy(&trainer->lock);
+  pthread_cond_destroy(&trainer->delivered);
+  pthread_barrier_destroy(&trainer->start);
+  pthread_barrier_destroy(&trainer->finish);
+  free(trainer->stages);
+  free(trainer);
+}
+
+/**
+ * @brief Creates a pipeline trainer and starts one thread per stage.
+ * @param nn A pointer to the NeuralNetwork to train.
+ * @param num_stages The number of stages (clamped to the number of layers).
+ * @param num_micro_batches The number of micro-batches per step.
+ * @param loss_type The loss type; SOFTMAX with CCE runs
+ * softmax_cross_entropy on the logits.
+ * @param loss_func The loss reported by pipeline_step, or NULL. With the fused
+ * SOFTMAX and CCE path any non-NULL value reports the cross-entropy.
+ * @param loss_func_grad The gradient of the loss.
+ * @return A pointer to the new trainer, or NULL on failure.
+ */
+PipelineTrainer* create_pipeline_trainer(NeuralNetwork* nn, size_t num_stages,
+                                         size_t num_micro_batches,
+                                         LossFunctionType loss_type,
+                                         LossFunction loss_func,
+                                         LossFunctionGrad loss_func_grad) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Pipeline training supports dense layers only.");
+  ASSERT(num_stages > 0, "Number of stages must be greater than 0.");
+  ASSERT(num_micro_batches > 0,
+         "Number of micro-batches must be greater than 0.");
+  ASSERT(loss_func_grad != NULL, "Loss gradient function cannot be NULL.");
+
+  if (num_stages > nn->num_layers) {
+    num_stages = nn->num_layers;
+  }
+
+  PipelineTrainer* trainer =
+      (PipelineTrainer*)calloc(1, sizeof(PipelineTrainer));
+  CHECK_ALLOC(trainer);
+  trainer->nn = nn;
+  trainer->num_stages = num_stages;
+  trainer->max_micro_batches = num_micro_batches;
+  trainer->loss_type = loss_type;
+  trainer->fused = loss_type == CCE &&
+                   nn->layers[nn->num_layers - 1]->activation_type == SOFTMAX;
+  trainer->loss_func = loss_func;
+  trainer->loss_func_grad = loss_func_grad;
+  pthread_mutex_init(&trainer->lock, NULL);
+  pthread_cond_init(&trainer->delivered, NULL);
+  pthread_barrier_init(&trainer->start, NULL, (unsigned)num_stages + 1);
+  pthread_barrier_init(&trainer->finish, NULL, (unsigned)num_stages + 1);
+
+  size_t mailboxes = num_stages * num_micro_batches;
+  trainer->stages = (PipelineStage*)calloc(num_stages, sizeof(PipelineStage));
+  trainer->forward_mail = (Matrix**)calloc(mailboxes, sizeof(Matrix*));
+  trainer->backward_mail = (Matrix**)calloc(mailboxes, sizeof(Matrix*));
+  trainer->grads = create_gradients(nn);
+  if (trainer->stages == NULL || trainer->forward_mail == NULL ||
+      trainer->backward_mail == NULL || trainer->grads == NULL) {
+    LOG_ERROR("Memory allocation failed for pipeline trainer.");
+    trainer->num_stages = (trainer->stages == NULL) ? 0 : num_stages;
+    shutdown_pipeline(trainer, 0);
+    return NULL;
+  }
+
+  partition_layers(trainer);
+  for (size_t s = 0; s < num_stages; s++) {
+    PipelineStage* stage = &trainer->stages[s];
+    size_t saved = (stage->end_layer - stage->first_layer) * num_micro_batches;
+    stage->trainer = trainer;
+    stage->index = s;
+    stage->inputs = (Matrix**)calloc(saved, sizeof(Matrix*));
+    stage->zs = (Matrix**)calloc(saved, sizeof(Matrix*));
+    stage->outputs = (Matrix**)calloc(num_micro_batches, sizeof(Matrix*));
+    if (stage->inputs == NULL || stage->zs == NULL || stage->outputs == NULL) {
+      LOG_ERROR("Memory allocation failed for pipeline stage %zu.", s);
+      shutdown_pipeline(trainer, 0);
+      return NULL;
+    }
+  }
+
+  pthread_mutex_lock(&trainer->lock);
+  size_t started = 0;
+  while (started < num_stages &&
+         pthread_create(&trainer->stages[started].thread, NULL,
+                        pipeline_stage_thread,
+                        &trainer->stages[started]) == 0) {
+    started++;
+  }
+  if (started < num_stages) {
+    LOG_ERROR("Failed to start pipeline stage %zu.", started);
+    trainer->stop = 1;
+  }
+  pthread_mutex_unlock(&trainer->lock);
+  if (started < num_stages) {
+    shutdown_pipeline(trainer, started);
+    return NULL;
+  }
+
+  LOG_INFO("Started %zu-stage pipeline trainer with %zu micro-batches.",
+           num_stages, num_micro_batches);
+  return trainer;
+}
+
+/**
+ * @brief Runs one pipelined training step on a mini-batch.
+ * @param trainer A pointer to the PipelineTrainer.
+ * @param opt A pointer to the Optimizer for the trainer's network.
+ * @param x A pointer to the batch inputs.
+ * @param y A pointer to the batch targets.
+ * @return The batch loss before the update, or 0 if no loss was given.
+ */
+double pipeline_step(PipelineTrainer* trainer, Optimizer* opt, const Matrix* x,
+                     const Matrix* y) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(x != NULL && y != NULL, "Batch matrices cannot be NULL.");
+  ASSERT(x->rows == y->rows, "Inputs and targets must have the same rows.");
+  ASSERT(x->rows > 0, "Batch cannot be empty.");
+  ASSERT(x->cols == trainer->nn->layers[0]->weights->rows,
+         "Input dimensions must match network dimensions.");
+  ASSERT(!network_has_dropout(trainer->nn),
+         "Pipeline training does not implement dropout.");
+
+  size_t micro_batches = trainer->max_micro_batches;
+  if (micro_batches > x->rows) {
+    micro_batches = x->rows;
+  }
+  trainer->micro_rows = (x->rows + micro_batches - 1) / micro_batches;
+  trainer->num_micro_batches =
+      (x->rows + trainer->micro_rows - 1) / trainer->micro_rows;
+  trainer->y = y;
+  zero_gradients(trainer->grads);
+
+  // Stage 0's inputs are views into the batch; they are freed as views.
+  for (size_t k = 0; k < trainer->num_micro_batches; k++) {
+    size_t begin = k * trainer->micro_rows;
+    size_t end = begin + trainer->micro_rows;
+    if (end > x->rows) {
+      end = x->rows;
+    }
+    trainer->forward_mail[k] = create_matrix_view(
+        x->matrix_data + begin * x->cols, end - begin, x->cols);
+  }
+
+  pthread_barrier_wait(&trainer->start);
+  pthread_barrier_wait(&trainer->finish);
+
+  optimizer_apply_gradients(opt, trainer->nn, trainer->grads);
+  return trainer->stages[trainer->num_stages - 1].loss / (double)x->rows;
+}
+
+/**
+ * @brief Stops the stage threads and frees the trainer.
+ * @param trainer A pointer to the PipelineTrainer to free.
+ */
+void free_pipeline_trainer(PipelineTrainer* trainer) {
+  if (trainer == NULL) {
+    return;
+  }
+  shutdown_pipeline(trainer, trainer->num_stages);
+}
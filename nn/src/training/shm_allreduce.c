@@ -0,0 +1,364 @@
+/**
+ * @file shm_allreduce.c
+ * @brief Ring allreduce and broadcast between processes over POSIX shared
+ * memory.
+ *
+ * The segment starts with a header (readiness flag, group shape and a
+ * process-shared barrier) followed by one cache-line aligned slot of `count`
+ * doubles per rank. A collective copies the caller's data into its own slot,
+ * runs its ring steps with a barrier after each, and copies the result back.
+ * Within a step a rank only writes its own slot and only reads its left
+ * neighbour's slot at a chunk the neighbour is not writing, so the barriers
+ * are the only synchronization needed.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "shm_allreduce.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "neural_network.h"
+#include "utils.h"
+
+// Written by rank 0 once the header is initialized.
+#define SHM_READY_MAGIC 0x4e4e5348u
+// How long other ranks wait for rank 0 to create the segment.
+#define SHM_OPEN_TIMEOUT_MS 10000
+// Slots and the header are padded to a cache line.
+#define SHM_ALIGNMENT 64
+
+/** @brief Header at the start of the shared segment. */
+typedef struct {
+  atomic_uint ready;         /**< SHM_READY_MAGIC once initialized. */
+  size_t world_size;         /**< Number of ranks. */
+  size_t count;              /**< Doubles per collective. */
+  pthread_barrier_t barrier; /**< Process-shared barrier over all ranks. */
+} ShmHeader;
+
+struct ShmCommunicator {
+  char* name;
+  size_t rank;
+  size_t world_size;
+  size_t count;
+  size_t slot_stride; /**< Doubles between consecutive slots. */
+  size_t mapped_size; /**< Bytes mapped. */
+  ShmHeader* header;
+  double* slots;
+};
+
+/**
+ * @brief Rounds a size up to SHM_ALIGNMENT.
+ * @param size The size in bytes.
+ * @return The aligned size.
+ */
+static size_t shm_align(size_t size) {
+  return (size + SHM_ALIGNMENT - 1) / SHM_ALIGNMENT * SHM_ALIGNMENT;
+}
+
+/**
+ * @brief Sleeps for one millisecond while waiting for rank 0.
+ */
+static void shm_wait_tick(void) {
+  struct timespec tick = {0, 1000000};
+  nanosleep(&tick, NULL);
+}
+
+/**
+ * @brief Returns a rank's slot.
+ * @param comm The communicator.
+ * @param rank The rank.
+ * @return A pointer to the first double of the slot.
+ */
+static double* shm_slot(const ShmCommunicator* comm, size_t rank) {
+  return comm->slots + rank * comm->slot_stride;
+}
+
+/**
+ * @brief Waits until every rank reaches the same point.
+ * @param comm The communicator.
+ */
+static void shm_barrier(ShmCommunicator* comm) {
+  pthread_barrier_wait(&comm->header->barrier);
+}
+
+/**
+ * @brief Creates and initializes the segment (rank 0).
+ * @param comm The communicator with name and sizes set.
+ * @return The file descriptor, or -1 on failure.
+ */
+static int shm_create_segment(ShmCommunicator* comm) {
+  int fd = shm_open(comm->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    LOG_ERROR("Could not create shared memory segment %s", comm->name);
+    return -1;
+  }
+  if (ftruncate(fd, (off_t)comm->mapped_size) != 0) {
+    LOG_ERROR("Could not size shared memory segment %s", comm->name);
+    close(fd);
+    shm_unlink(comm->name);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * @brief Opens the segment created by rank 0, waiting for it to appear.
+ * @param comm The communicator with name and sizes set.
+ * @return The file descriptor, or -1 on timeout.
+ */
+static int shm_attach_segment(ShmCommunicator* comm) {
+  for (int waited = 0; waited < SHM_OPEN_TIMEOUT_MS; waited++) {
+    int fd = shm_open(comm->name, O_RDWR, 0600);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && (size_t)st.st_size == comm->mapped_size) {
+        return fd;
+      }
+      close(fd);
+    }
+    shm_wait_tick();
+  }
+  LOG_ERROR("Timed out waiting for shared memory segment %s", comm->name);
+  return -1;
+}
+
+/**
+ * @brief Opens a communicator; rank 0 creates the segment.
+ * @param name The shared-memory name.
+ * @param rank This process's rank.
+ * @param world_size The number of ranks.
+ * @param count The number of doubles per collective.
+ * @return A pointer to the new ShmCommunicator, or NULL on failure.
+ */
+ShmCommunicator* shm_comm_open(const char* name, size_t rank,
+                               size_t world_size, size_t count) {
+  ASSERT(name != NULL, "Shared memory name cannot be NULL.");
+  ASSERT(world_size > 0, "World size must be greater than 0.");
+  ASSERT(rank < world_size, "Rank must be less than the world size.");
+  ASSERT(count > 0, "Collective size must be greater than 0.");
+
+  ShmCommunicator* comm = (ShmCommunicator*)calloc(1, sizeof(ShmCommunicator));
+  CHECK_ALLOC(comm);
+  comm->name = strdup(name);
+  if (comm->name == NULL) {
+    free(comm);
+    return NULL;
+  }
+  comm->rank = rank;
+  comm->world_size = world_size;
+  comm->count = count;
+  comm->slot_stride = shm_align(count * sizeof(double)) / sizeof(double);
+  comm->mapped_size = shm_align(sizeof(ShmHeader)) +
+                      world_size * comm->slot_stride * sizeof(double);
+
+  int fd = (rank == 0) ? shm_create_segment(comm) : shm_attach_segment(comm);
+  if (fd < 0) {
+    free(comm->name);
+    free(comm);
+    return NULL;
+  }
+  void* base = mmap(NULL, comm->mapped_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    LOG_ERROR("Could not map shared memory segment %s", name);
+    if (rank == 0) {
+      shm_unlink(name);
+    }
+    free(comm->name);
+    free(comm);
+    return NULL;
+  }
+  comm->header = (ShmHeader*)base;
+  comm->slots =
+      (double*)((char*)base + shm_align(sizeof(ShmHeader)));
+
+  if (rank == 0) {
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&comm->header->barrier, &attr, (unsigned)world_size);
+    pthread_barrierattr_destroy(&attr);
+    comm->header->world_size = world_size;
+    comm->header->count = count;
+    atomic_store(&comm->header->ready, SHM_READY_MAGIC);
+  } else {
+    int waited = 0;
+    while (atomic_load(&comm->header->ready) != SHM_READY_MAGIC &&
+           waited++ < SHM_OPEN_TIMEOUT_MS) {
+      shm_wait_tick();
+    }
+    if (atomic_load(&comm->header->ready) != SHM_READY_MAGIC ||
+        comm->header->world_size != world_size ||
+        comm->header->count != count) {
+      LOG_ERROR("Shared memory segment %s does not match this group.", name);
+      munmap(base, comm->mapped_size);
+      free(comm->name);
+      free(comm);
+      return NULL;
+    }
+  }
+
+  // Nobody may start a collective before every rank has mapped the segment.
+  shm_barrier(comm);
+  return comm;
+}
+
+/**
+ * @brief Ring allreduce: reduce-scatter then allgather around the ranks.
+ * @param comm A pointer to the ShmCommunicator.
+ * @param data The local buffer, replaced by the sum over all ranks.
+ */
+void shm_allreduce_sum(ShmCommunicator* comm, double* data) {
+  ASSERT(comm != NULL, "Communicator cannot be NULL.");
+  ASSERT(data != NULL, "Data cannot be NULL.");
+
+  size_t n = comm->world_size;
+  if (n == 1) {
+    return;
+  }
+  double* own = shm_slot(comm, comm->rank);
+  const double* left = shm_slot(comm, (comm->rank + n - 1) % n);
+
+  memcpy(own, data, comm->count * sizeof(double));
+  shm_barrier(comm);
+
+  // After step s, this rank holds the sum of s + 2 ranks' values for chunk
+  // (rank - s - 1); after n - 1 steps chunk (rank + 1) is complete.
+  for (size_t s = 0; s + 1 < n; s++) {
+    size_t chunk = (comm->rank + 2 * n - s - 1) % n;
+    size_t begin = chunk * comm->count / n;
+    size_t end = (chunk + 1) * comm->count / n;
+    for (size_t i = begin; i < end; i++) {
+      own[i] += left[i];
+    }
+    shm_barrier(comm);
+  }
+
+  // Pass the completed chunks around the ring.
+  for (size_t s = 0; s + 1 < n; s++) {
+    size_t chunk = (comm->rank + n - s) % n;
+    size_t begin = chunk * comm->count / n;
+    size_t end = (chunk + 1) * comm->count / n;
+    memcpy(own + begin, left + begin, (end - begin) * sizeof(double));
+    shm_barrier(comm);
+  }
+
+  memcpy(data, own, comm->count * sizeof(double));
+}
+
+/**
+ * @brief Copies a buffer from the root rank to every rank.
+ * @param comm A pointer to the ShmCommunicator.
+ * @param data The local buffer; the source on the root.
+ * @param root The rank whose data is broadcast.
+ */
+void shm_broadcast(ShmCommunicator* comm, double* data, size_t root) {
+  ASSERT(comm != NULL, "Communicator cannot be NULL.");
+  ASSERT(data != NULL, "Data cannot be NULL.");
+  ASSERT(root < comm->world_size, "Root must be a valid rank.");
+
+  double* slot = shm_slot(comm, root);
+  if (comm->rank == root) {
+    memcpy(slot, data, comm->count * sizeof(double));
+  }
+  shm_barrier(comm);
+  if (comm->rank != root) {
+    memcpy(data, slot, comm->count * sizeof(double));
+  }
+  // The root's slot may be reused by the next collective.
+  shm_barrier(comm);
+}
+
+/**
+ * @brief Broadcasts rank 0's weights and biases to every rank.
+ * @param comm A pointer to the ShmCommunicator.
+ * @param nn A pointer to this rank's copy of the NeuralNetwork.
+ */
+void shm_sync_network(ShmCommunicator* comm, NeuralNetwork* nn) {
+  ASSERT(comm != NULL, "Communicator cannot be NULL.");
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(network_is_dense(nn),
+         "Shared-memory training supports dense layers only.");
+
+  if (nn->parameters != NULL) {
+    ASSERT(nn->num_parameters == comm->count,
+           "Communicator size must match the network parameters.");
+    shm_broadcast(comm, nn->parameters, 0);
+    return;
+  }
+
+  double* packed = (double*)malloc(comm->count * sizeof(double));
+  CHECK_MALLOC(packed, "Failed to allocate parameter staging buffer.");
+  size_t offset = 0;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    const Matrix* params[2] = {nn->layers[i]->weights, nn->layers[i]->bias};
+    for (size_t p = 0; p < 2; p++) {
+      size_t n = params[p]->rows * params[p]->cols;
+      ASSERT(offset + n <= comm->count,
+             "Communicator size must match the network parameters.");
+      memcpy(packed + offset, params[p]->matrix_data, n * sizeof(double));
+      offset += n;
+    }
+  }
+  ASSERT(offset == comm->count,
+         "Communicator size must match the network parameters.");
+
+  shm_broadcast(comm, packed, 0);
+
+  offset = 0;
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    Matrix* params[2] = {nn->layers[i]->weights, nn->layers[i]->bias};
+    for (size_t p = 0; p < 2; p++) {
+      size_t n = params[p]->rows * params[p]->cols;
+      memcpy(params[p]->matrix_data, packed + offset, n * sizeof(double));
+      offset += n;
+    }
+  }
+  free(packed);
+}
+
+/**
+ * @brief Sums gradients over all ranks in place.
+ * @param comm A pointer to the ShmCommunicator.
+ * @param grads A pointer to this rank's NetworkGradients.
+ */
+void shm_allreduce_gradients(ShmCommunicator* comm, NetworkGradients* grads) {
+  ASSERT(comm != NULL, "Communicator cannot be NULL.");
+  ASSERT(grads != NULL, "Gradients cannot be NULL.");
+  ASSERT(grads->size == comm->count,
+         "Communicator size must match the gradients.");
+  for (size_t i = 0; i < grads->num_layers; i++) {
+    ASSERT(grads->batch_norm[i] == NULL,
+           "Shared-memory training does not support batch normalization.");
+  }
+  shm_allreduce_sum(comm, grads->data);
+}
+
+/**
+ * @brief Leaves the group and unmaps the segment; rank 0 removes it.
+ * @param comm A pointer to the ShmCommunicator to close.
+ */
+void shm_comm_close(ShmCommunicator* comm) {
+  if (comm == NULL) {
+    return;
+  }
+  shm_barrier(comm);
+  munmap(comm->header, comm->mapped_size);
+  if (comm->rank == 0) {
+    shm_unlink(comm->name);
+  }
+  free(comm->name);
+  free(comm);
+}
@@ -0,0 +1,244 @@
+/**
+ * @file trainer.c
+ * @brief Training loop with a double-buffered background data loader.
+ *
+ * The loader and the training thread hand two batch slots back and forth.
+ * A slot is filled by the loader only while it is empty and read by the
+ * trainer only while it is full, so the batch data itself needs no locking;
+ * the mutex only guards the full flags.
+ */
+#include "trainer.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "neural_network.h"
+#include "optimizer.h"
+#include "rng.h"
+#include "utils.h"
+
+/** @brief One prefetched batch. */
+typedef struct {
+  Matrix* x; /**< Inputs; `rows` is the current batch size. */
+  Matrix* y; /**< Targets; `rows` is the current batch size. */
+  int full;  /**< Set by the loader, cleared by the trainer. */
+} BatchSlot;
+
+struct Trainer {
+  NeuralNetwork* nn;
+  Optimizer* opt;
+  const Matrix* x;
+  const Matrix* y;
+  TrainerConfig config;
+  size_t num_batches; /**< Mini-batches per epoch. */
+  NetworkGradients* grads;
+
+  BatchSlot slots[2];
+  size_t* order;    /**< Row order of the current epoch (loader only). */
+  size_t consumed;  /**< Batches trained so far (trainer only). */
+  pthread_t loader;
+  pthread_mutex_t lock;
+  pthread_cond_t ready; /**< Signalled when a slot becomes full. */
+  pthread_cond_t space; /**< Signalled when a slot becomes empty. */
+  int stop;             /**< Set to shut the loader down. */
+};
+
+/**
+ * @brief Copies the rows of one batch into a slot and transforms them.
+ * @param trainer The trainer.
+ * @param slot The empty slot to fill.
+ * @param batch Index of the batch within the epoch.
+ */
+static void fill_slot(Trainer* trainer, BatchSlot* slot, size_t batch) {
+  const Matrix* x = trainer->x;
+  const Matrix* y = trainer->y;
+  size_t begin = batch * trainer->config.batch_size;
+  size_t end = begin + trainer->config.batch_size;
+  if (end > x->rows) {
+    end = x->rows;
+  }
+
+  gather_rows(x, trainer->order + begin, end - begin, slot->x);
+  gather_rows(y, trainer->order + begin, end - begin, slot->y);
+  if (trainer->config.transform != NULL) {
+    trainer->config.transform(slot->x, slot->y,
+                              trainer->config.transform_data);
+  }
+}
+
+/**
+ * @brief Loader thread main loop: fills slots in order, epoch after epoch,
+ * until the trainer is freed.
+ * @param arg A pointer to the Trainer.
+ * @return Always NULL.
+ */
+static void* loader_main(void* arg) {
+  Trainer* trainer = (Trainer*)arg;
+  size_t produced = 0;
+
+  for (;;) {
+    size_t batch = produced % trainer->num_batches;
+    if (batch == 0 && trainer->config.shuffle) {
+      // Each epoch draws from its own range of the stream.
+      size_t epoch = produced / trainer->num_batches;
+      rng_permutation(trainer->config.seed, (uint64_t)epoch * trainer->x->rows,
+                      trainer->order, trainer->x->rows);
+    }
+
+    BatchSlot* slot = &trainer->slots[produced % 2];
+    pthread_mutex_lock(&trainer->lock);
+    while (slot->full && !trainer->stop) {
+      pthread_cond_wait(&trainer->space, &trainer->lock);
+    }
+    int stop = trainer->stop;
+    pthread_mutex_unlock(&trainer->lock);
+    if (stop) {
+      break;
+    }
+
+    fill_slot(trainer, slot, batch);
+
+    pthread_mutex_lock(&trainer->lock);
+    slot->full = 1;
+    pthread_cond_signal(&trainer->ready);
+    pthread_mutex_unlock(&trainer->lock);
+    produced++;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Frees the trainer's buffers. The loader must not be running.
+ * @param trainer The trainer.
+ */
+static void free_trainer_buffers(Trainer* trainer) {
+  for (size_t i = 0; i < 2; i++) {
+    free_matrix(trainer->slots[i].x);
+    free_matrix(trainer->slots[i].y);
+  }
+  free(trainer->order);
+  free_gradients(trainer->grads);
+  free(trainer);
+}
+
+Trainer* create_trainer(NeuralNetwork* nn, Optimizer* opt, const Matrix* x,
+                        const Matrix* y, const TrainerConfig* config) {
+  ASSERT(nn != NULL, "Neural Network pointer cannot be NULL.");
+  ASSERT(opt != NULL, "Optimizer cannot be NULL.");
+  ASSERT(x != NULL && y != NULL, "Training matrices cannot be NULL.");
+  ASSERT(x->rows == y->rows, "Inputs and targets must have the same rows.");
+  ASSERT(x->rows > 0, "Training data cannot be empty.");
+  ASSERT(config != NULL, "Trainer config cannot be NULL.");
+  ASSERT(config->batch_size > 0, "Batch size must be greater than 0.");
+  ASSERT(config->loss_func_grad != NULL,
+         "Loss gradient function cannot be NULL.");
+
+  Trainer* trainer = (Trainer*)calloc(1, sizeof(Trainer));
+  if (trainer == NULL) {
+    LOG_ERROR("Memory allocation failed for trainer.");
+    return NULL;
+  }
+  trainer->nn = nn;
+  trainer->opt = opt;
+  trainer->x = x;
+  trainer->y = y;
+  trainer->config = *config;
+  trainer->num_batches = (x->rows + config->batch_size - 1) /
+                         config->batch_size;
+
+  size_t capacity =
+      config->batch_size < x->rows ? config->batch_size : x->rows;
+  int ok = 1;
+  for (size_t i = 0; i < 2; i++) {
+    trainer->slots[i].x = create_matrix(capacity, x->cols);
+    trainer->slots[i].y = create_matrix(capacity, y->cols);
+    ok = ok && trainer->slots[i].x != NULL && trainer->slots[i].y != NULL;
+  }
+  trainer->order = (size_t*)malloc(x->rows * sizeof(size_t));
+  trainer->grads = create_gradients(nn);
+  if (!ok || trainer->order == NULL || trainer->grads == NULL) {
+    LOG_ERROR("Memory allocation failed for trainer buffers.");
+    free_trainer_buffers(trainer);
+    return NULL;
+  }
+  for (size_t i = 0; i < x->rows; i++) {
+    trainer->order[i] = i;
+  }
+
+  pthread_mutex_init(&trainer->lock, NULL);
+  pthread_cond_init(&trainer->ready, NULL);
+  pthread_cond_init(&trainer->space, NULL);
+  if (pthread_create(&trainer->loader, NULL, loader_main, trainer) != 0) {
+    LOG_ERROR("Failed to start the trainer's loader thread.");
+    pthread_cond_destroy(&trainer->space);
+    pthread_cond_destroy(&trainer->ready);
+    pthread_mutex_destroy(&trainer->lock);
+    free_trainer_buffers(trainer);
+    return NULL;
+  }
+  return trainer;
+}
+
+double trainer_run_epoch(Trainer* trainer) {
+  ASSERT(trainer != NULL, "Trainer cannot be NULL.");
+  const TrainerConfig* config = &trainer->config;
+
+  // Dropout is only applied while the trainer runs.
+  int was_training = trainer->nn->training;
+  trainer->nn->training = 1;
+  const NeuralNetwork* nn = trainer->nn;
+  int fused = config->loss_type == CCE &&
+              nn->layers[nn->num_layers - 1]->activation_type == SOFTMAX;
+  double loss = 0.0;
+  for (size_t b = 0; b < trainer->num_batches; b++) {
+    BatchSlot* slot = &trainer->slots[trainer->consumed % 2];
+    pthread_mutex_lock(&trainer->lock);
+    while (!slot->full) {
+      pthread_cond_wait(&trainer->ready, &trainer->lock);
+    }
+    pthread_mutex_unlock(&trainer->lock);
+
+    // With the fused loss the output probabilities are never materialized.
+    Matrix* y_hat = fused ? feedforward_logits(trainer->nn, slot->x)
+                          : feedforward(trainer->nn, slot->x);
+    if (fused && config->loss_func != NULL) {
+      loss += softmax_cross_entropy(y_hat, slot->y, NULL) *
+              (double)slot->x->rows;
+    } else if (config->loss_func != NULL) {
+      loss += config->loss_func(y_hat, slot->y) * (double)slot->x->rows;
+    }
+    backpropagate_gradients(trainer->nn, slot->y, config->loss_type,
+                            config->loss_func_grad, trainer->grads, NULL,
+                            NULL);
+    optimizer_apply_gradients(trainer->opt, trainer->nn, trainer->grads);
+    free_matrix(y_hat);
+
+    pthread_mutex_lock(&trainer->lock);
+    slot->full = 0;
+    pthread_cond_signal(&trainer->space);
+    pthread_mutex_unlock(&trainer->lock);
+    trainer->consumed++;
+  }
+  trainer->nn->training = was_training;
+  return loss / (double)trainer->x->rows;
+}
+
+void free_trainer(Trainer* trainer) {
+  if (trainer == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&trainer->lock);
+  trainer->stop = 1;
+  pthread_cond_signal(&trainer->space);
+  pthread_mutex_unlock(&trainer->lock);
+  pthread_join(trainer->loader, NULL);
+
+  pthread_cond_destroy(&trainer->space);
+  pthread_cond_destroy(&trainer->ready);
+  pthread_mutex_destroy(&trainer->lock);
+  free_trainer_buffers(trainer);
+}
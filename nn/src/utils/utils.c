@@ -40,11 +40,12 @@ void log_message(LogLevel level, const char* format, ...) {
     return;
   }
 
-  // include time
+  // include time; localtime_r keeps this safe to call from worker threads
   time_t now = time(NULL);
-  const struct tm* t = localtime(&now);
+  struct tm t;
+  localtime_r(&now, &t);
   char time_str[20];
-  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", t);
+  strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &t);
 
   FILE* stream = (level >= LOG_LEVEL_WARN) ? stderr : stdout;
 
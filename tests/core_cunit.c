@@ -6,6 +6,7 @@
 
 #include "cache.h"
 #include "linalg.h"
+#include "rng.h"
 #include "test_utils.h"
 #include "utils.h"
 
@@ -22,6 +23,7 @@
 
 #include "cache.h"
 #include "linalg.h"
+#include "rng.h"
 #include "test_utils.h"
 #include "utils.h"
 
@@ -104,6 +106,124 @@ void test_cache_functionality() {
   free_cache(cache);
 }
 
+/**
+ * @brief Tests Philox against the reference known-answer vectors, that bulk
+ * fills are position-addressable, and that randomize_matrix is reproducible
+ * from the global seed.
+ */
+void test_philox_rng(void) {
+  const uint32_t zero[4] = {0, 0, 0, 0};
+  const uint32_t ones[4] = {0xffffffffU, 0xffffffffU, 0xffffffffU,
+                            0xffffffffU};
+  uint32_t out[4];
+  philox4x32(zero, zero, out);
+  CU_ASSERT_EQUAL(out[0], 0x6627e8d5U);
+  CU_ASSERT_EQUAL(out[1], 0xe169c58dU);
+  CU_ASSERT_EQUAL(out[2], 0xbc57ac4cU);
+  CU_ASSERT_EQUAL(out[3], 0x9b00dbd8U);
+  philox4x32(ones, ones, out);
+  CU_ASSERT_EQUAL(out[0], 0x408f276dU);
+  CU_ASSERT_EQUAL(out[1], 0x41c83b0eU);
+  CU_ASSERT_EQUAL(out[2], 0xa20bc7c6U);
+  CU_ASSERT_EQUAL(out[3], 0x6d5451fdU);
+
+  double full[64];
+  double part[5];
+  rng_fill_uniform(42, 100, full, 64, -1.0, 1.0);
+  rng_fill_uniform(42, 103, part, 5, -1.0, 1.0);
+  double mean = 0.0;
+  for (size_t i = 0; i < 64; i++) {
+    CU_ASSERT_TRUE(full[i] >= -1.0 && full[i] < 1.0);
+    CU_ASSERT_DOUBLE_EQUAL(full[i], 2.0 * rng_uniform(42, 100 + i) - 1.0,
+                           1e-15);
+    mean += full[i] / 64.0;
+  }
+  CU_ASSERT_TRUE(fabs(mean) < 0.3);
+  for (size_t i = 0; i < 5; i++) {
+    CU_ASSERT_EQUAL(part[i], full[3 + i]);
+  }
+
+  double normal[256];
+  rng_fill_normal(7, 0, normal, 256, 1.0, 2.0);
+  double normal_mean = 0.0;
+  for (size_t i = 0; i < 256; i++) normal_mean += normal[i] / 256.0;
+  CU_ASSERT_DOUBLE_EQUAL(normal_mean, 1.0, 0.5);
+  // Normal i is built from offsets 2i and 2i + 1, even from an odd start.
+  double shifted[4];
+  rng_fill_normal(7, 1, shifted, 4, 1.0, 2.0);
+  for (size_t i = 0; i < 4; i++) {
+    double u1 = rng_uniform(7, 1 + 2 * i) + ldexp(1.0, -53);
+    double u2 = rng_uniform(7, 2 + 2 * i);
+    double expected =
+        1.0 + 2.0 * sqrt(-2.0 * log(u1)) * cos(6.28318530717958647692 * u2);
+    CU_ASSERT_DOUBLE_EQUAL(shifted[i], expected, 1e-12);
+  }
+
+  // Reservations start on a block boundary and cover whole blocks, so the
+  // 8 normals (16 offsets) and the uniforms after them never share a block.
+  rng_set_seed(5);
+  uint64_t odd = rng_reserve(3);
+  uint64_t normals = rng_reserve(2 * 8);
+  uint64_t uniforms = rng_reserve(8);
+  CU_ASSERT_EQUAL(odd % 2, 0);
+  CU_ASSERT_EQUAL(normals % 2, 0);
+  CU_ASSERT_EQUAL(uniforms % 2, 0);
+  CU_ASSERT_TRUE((odd + 3 - 1) / 2 < normals / 2);
+  CU_ASSERT_TRUE((normals + 16 - 1) / 2 < uniforms / 2);
+
+  Matrix* a = create_matrix(3, 4);
+  Matrix* b = create_matrix(3, 4);
+  rng_set_seed(123);
+  randomize_matrix(a, 4.0);
+  randomize_matrix(b, 4.0);
+  CU_ASSERT_FALSE(compare_matrices(a, b, 0.0));
+  rng_set_seed(123);
+  randomize_matrix(b, 4.0);
+  CU_ASSERT_TRUE(compare_matrices(a, b, 0.0));
+  free_matrix(a);
+  free_matrix(b);
+}
+
+/**
+ * @brief Tests that epoch permutations are valid and differ per epoch, and
+ * that gather_rows assembles the listed rows into a reusable buffer.
+ */
+void test_shuffled_gather(void) {
+  size_t first[10];
+  size_t second[10];
+  rng_permutation(5, 0, first, 10);
+  rng_permutation(5, 10, second, 10);
+  int seen[10] = {0};
+  int same = 1;
+  for (size_t i = 0; i < 10; i++) {
+    CU_ASSERT_TRUE(first[i] < 10);
+    seen[first[i]]++;
+    same = same && first[i] == second[i];
+  }
+  for (size_t i = 0; i < 10; i++) {
+    CU_ASSERT_EQUAL(seen[i], 1);
+  }
+  CU_ASSERT_FALSE(same);
+
+  Matrix* src = create_matrix(10, 3);
+  for (size_t i = 0; i < 30; i++) src->matrix_data[i] = (double)i;
+  Matrix* batch = create_matrix(8, 3);
+  gather_rows(src, first, 8, batch);
+  CU_ASSERT_EQUAL(batch->rows, 8);
+  for (size_t r = 0; r < 8; r++) {
+    for (size_t c = 0; c < 3; c++) {
+      CU_ASSERT_EQUAL(batch->matrix_data[r * 3 + c],
+                      (double)(first[r] * 3 + c));
+    }
+  }
+  gather_rows(src, second + 8, 2, batch);
+  CU_ASSERT_EQUAL(batch->rows, 2);
+  CU_ASSERT_EQUAL(batch->matrix_data[3], (double)(second[9] * 3));
+
+  free_matrix(src);
+  free_matrix(batch);
+}
+
 /**
  * @brief Array of CU_TestInfo structures for core tests.
  */
@@ -111,4 +231,6 @@ CU_TestInfo core_tests[] = {
     {"test_create_free_matrix", test_create_free_matrix},
     {"test_add_matrix", test_add_matrix},
     {"test_cache_functionality", test_cache_functionality},
+    {"test_philox_rng", test_philox_rng},
+    {"test_shuffled_gather", test_shuffled_gather},
     CU_TEST_INFO_NULL};
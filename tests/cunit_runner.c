@@ -12,6 +12,8 @@
 // Declare test suites from other test files
 extern CU_TestInfo core_tests[];
 extern CU_TestInfo nn_tests[];
+extern CU_TestInfo inference_tests[];
+extern CU_TestInfo training_tests[];
 
 /**
  * @brief Adds a suite of tests to the CUnit registry.
@@ -51,6 +53,9 @@ int main() {
   // Add suites
   if (add_suite("Core Tests", core_tests) != 0) return CU_get_error();
   if (add_suite("Neural Network Tests", nn_tests) != 0) return CU_get_error();
+  if (add_suite("Inference Tests", inference_tests) != 0)
+    return CU_get_error();
+  if (add_suite("Training Tests", training_tests) != 0) return CU_get_error();
 
   // Run all tests using the Basic interface
   CU_basic_set_mode(CU_BRM_VERBOSE);
@@ -0,0 +1,372 @@
+/**
+ * @file inference_cunit.c
+ * @brief CUnit tests for the inference paths.
+ */
+
+#include <CUnit/Basic.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "codegen.h"
+#include "feedforward.h"
+#include "inference.h"
+#include "linalg.h"
+#include "model_slot.h"
+#include "neural_network.h"
+#include "quantize.h"
+#include "stream_inference.h"
+#include "test_utils.h"
+
+static const size_t kTestSizes[] = {3, 5, 2};
+
+/**
+ * @brief Builds a batch of inputs whose values depend on `seed`.
+ */
+static Matrix* make_input(size_t rows, double seed) {
+  Matrix* input = create_matrix(rows, kTestSizes[0]);
+  for (size_t i = 0; i < rows * kTestSizes[0]; i++) {
+    input->matrix_data[i] = seed + 0.25 * (double)i;
+  }
+  return input;
+}
+
+/**
+ * @brief Tests that the cache-free forward pass matches `feedforward`.
+ */
+void test_predict_matches_feedforward(void) {
+  NeuralNetwork* nn = create_test_network(kTestSizes, 2, RELU, SOFTMAX);
+  Matrix* input = make_input(4, -1.0);
+
+  Matrix* expected = feedforward(nn, input);
+  Matrix* actual = predict(nn, input);
+  CU_ASSERT_TRUE(compare_matrices(actual, expected, 1e-12));
+
+  free_matrix(input);
+  free_matrix(expected);
+  free_matrix(actual);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests that queued inference jobs complete with the same results as a
+ * synchronous forward pass and that the capacity bound is enforced.
+ */
+void test_inference_pool_submit_wait(void) {
+  NeuralNetwork* nn = create_test_network(kTestSizes, 2, TANH, SIGMOID);
+  enum { kJobs = 6 };
+  Matrix* inputs[kJobs];
+  Matrix* expected[kJobs];
+  for (size_t i = 0; i < kJobs; i++) {
+    inputs[i] = make_input(2, (double)i);
+    expected[i] = predict(nn, inputs[i]);
+  }
+
+  InferencePool* pool = create_inference_pool(nn, 2, kJobs);
+  CU_ASSERT_PTR_NOT_NULL(pool);
+  size_t ids[kJobs];
+  for (size_t i = 0; i < kJobs; i++) {
+    ids[i] = inference_submit(pool, inputs[i], NULL, NULL);
+  }
+  CU_ASSERT_FALSE(inference_try_submit(pool, inputs[0], NULL, NULL, NULL));
+
+  size_t collected = 0;
+  size_t job_id = 0;
+  Matrix* output = NULL;
+  while ((output = inference_wait_any(pool, &job_id)) != NULL) {
+    for (size_t i = 0; i < kJobs; i++) {
+      if (ids[i] == job_id) {
+        CU_ASSERT_TRUE(compare_matrices(output, expected[i], 1e-12));
+      }
+    }
+    free_matrix(output);
+    collected++;
+  }
+  CU_ASSERT_EQUAL(collected, kJobs);
+  CU_ASSERT_PTR_NULL(inference_poll(pool, NULL));
+
+  free_inference_pool(pool);
+  for (size_t i = 0; i < kJobs; i++) {
+    free_matrix(inputs[i]);
+    free_matrix(expected[i]);
+  }
+  free_network(nn);
+}
+
+/** @brief Arguments for the background publisher in the model slot test. */
+typedef struct {
+  ModelSlot* slot;
+  NeuralNetwork* next;
+  atomic_int done;
+} PublishArgs;
+
+/** @brief Thread body that publishes a new network into a slot. */
+static void* publish_in_background(void* arg) {
+  PublishArgs* args = (PublishArgs*)arg;
+  model_slot_publish(args->slot, args->next);
+  atomic_store(&args->done, 1);
+  return NULL;
+}
+
+/**
+ * @brief Tests that publishing a new network waits for pinned readers, and
+ * that readers arriving afterwards see the new weights.
+ */
+void test_model_slot_hot_swap(void) {
+  NeuralNetwork* old_nn = create_test_network(kTestSizes, 2, RELU, IDENTITY);
+  NeuralNetwork* new_nn = copy_network(old_nn);
+  fill_matrix(new_nn->layers[1]->bias, 3.0);
+
+  Matrix* input = make_input(2, 0.5);
+  Matrix* old_expected = predict(old_nn, input);
+  Matrix* new_expected = predict(new_nn, input);
+  CU_ASSERT_FALSE(compare_matrices(old_expected, new_expected, 1e-9));
+
+  ModelSlot* slot = create_model_slot(old_nn);
+  ModelSnapshot pinned = model_slot_acquire(slot);
+  CU_ASSERT_PTR_EQUAL(pinned.nn, old_nn);
+
+  PublishArgs args = {slot, new_nn, 0};
+  pthread_t publisher;
+  pthread_create(&publisher, NULL, publish_in_background, &args);
+
+  // New readers switch to the new network while the old one is still pinned.
+  ModelSnapshot fresh;
+  do {
+    fresh = model_slot_acquire(slot);
+    if (fresh.nn != new_nn) {
+      model_slot_release(slot, fresh);
+    }
+  } while (fresh.nn != new_nn);
+
+  Matrix* old_output = predict(pinned.nn, input);
+  CU_ASSERT_TRUE(compare_matrices(old_output, old_expected, 1e-12));
+  CU_ASSERT_EQUAL(atomic_load(&args.done), 0);
+  model_slot_release(slot, fresh);
+  model_slot_release(slot, pinned);
+  pthread_join(publisher, NULL);
+  CU_ASSERT_EQUAL(atomic_load(&args.done), 1);
+
+  Matrix* new_output = model_slot_predict(slot, input);
+  CU_ASSERT_TRUE(compare_matrices(new_output, new_expected, 1e-12));
+
+  free_matrix(input);
+  free_matrix(old_expected);
+  free_matrix(new_expected);
+  free_matrix(old_output);
+  free_matrix(new_output);
+  free_model_slot(slot);
+}
+
+/**
+ * @brief Tests the generated C source: it compiles on its own and its forward
+ * function matches `predict`, and non-finite weights are spelled with the
+ * `<math.h>` macros.
+ */
+void test_export_network_c(void) {
+  NeuralNetwork* nn = create_test_network(kTestSizes, 2, RELU, SOFTMAX);
+  Matrix* input = make_input(4, -1.0);
+  Matrix* expected = predict(nn, input);
+
+  char dir[] = "/tmp/nn_codegen_XXXXXX";
+  char path[64];
+  FILE* stream = NULL;
+  if (mkdtemp(dir) != NULL) {
+    snprintf(path, sizeof(path), "%s/tnet.c", dir);
+    stream = fopen(path, "w+");
+  }
+  CU_ASSERT_PTR_NOT_NULL(stream);
+  if (stream == NULL) {
+    free_matrix(expected);
+    free_matrix(input);
+    free_network(nn);
+    return;
+  }
+  CU_ASSERT_EQUAL(export_network_c(stream, nn, "tnet"), 0);
+
+  long size = ftell(stream);
+  CU_ASSERT_TRUE(size > 0);
+  char* source = (char*)calloc((size_t)size + 1, 1);
+  rewind(stream);
+  CU_ASSERT_EQUAL(fread(source, 1, (size_t)size, stream), (size_t)size);
+  CU_ASSERT_PTR_NOT_NULL(strstr(source, "#define tnet_INPUT_SIZE 3"));
+  CU_ASSERT_PTR_NOT_NULL(strstr(source, "#define tnet_OUTPUT_SIZE 2"));
+  CU_ASSERT_PTR_NULL(strstr(source, "malloc"));
+
+  // Append a driver that runs the test inputs through the generated code.
+  fseek(stream, 0, SEEK_END);
+  fprintf(stream,
+          "#include <stdio.h>\n"
+          "static const double inputs[] = {");
+  for (size_t i = 0; i < input->rows * input->cols; i++) {
+    fprintf(stream, "%.17g,", input->matrix_data[i]);
+  }
+  fprintf(stream,
+          "};\n"
+          "int main(void) {\n"
+          "  double out[tnet_OUTPUT_SIZE];\n"
+          "  for (int n = 0; n < %zu; n++) {\n"
+          "    tnet_forward(inputs + n * tnet_INPUT_SIZE, out);\n"
+          "    for (int j = 0; j < tnet_OUTPUT_SIZE; j++) {\n"
+          "      printf(\"%%.17g\\n\", out[j]);\n"
+          "    }\n"
+          "  }\n"
+          "  return 0;\n"
+          "}\n",
+          input->rows);
+  fclose(stream);
+
+  const char* cc = getenv("CC") != NULL ? getenv("CC") : "cc";
+  char command[256];
+  snprintf(command, sizeof(command), "%s -std=c99 -o %s/tnet %s -lm", cc, dir,
+           path);
+  int compiled = system(command) == 0;
+  CU_ASSERT_TRUE(compiled);
+  snprintf(command, sizeof(command), "%s/tnet", dir);
+  FILE* run = compiled ? popen(command, "r") : NULL;
+  if (run != NULL) {
+    for (size_t i = 0; i < expected->rows * expected->cols; i++) {
+      double value = 0.0;
+      CU_ASSERT_EQUAL(fscanf(run, "%lf", &value), 1);
+      CU_ASSERT_DOUBLE_EQUAL(value, expected->matrix_data[i], 1e-12);
+    }
+    CU_ASSERT_EQUAL(pclose(run), 0);
+  }
+  remove(command);
+  remove(path);
+  rmdir(dir);
+
+  // Non-finite weights must still produce valid C.
+  nn->layers[0]->weights->matrix_data[0] = NAN;
+  nn->layers[0]->bias->matrix_data[1] = -INFINITY;
+  FILE* special = tmpfile();
+  CU_ASSERT_PTR_NOT_NULL(special);
+  if (special == NULL) {
+    free(source);
+    free_matrix(expected);
+    free_matrix(input);
+    free_network(nn);
+    return;
+  }
+  CU_ASSERT_EQUAL(export_network_c(special, nn, "tnet"), 0);
+  size = ftell(special);
+  char* special_source = (char*)calloc((size_t)size + 1, 1);
+  rewind(special);
+  CU_ASSERT_EQUAL(fread(special_source, 1, (size_t)size, special),
+                  (size_t)size);
+  CU_ASSERT_PTR_NOT_NULL(strstr(special_source, " NAN,"));
+  CU_ASSERT_PTR_NOT_NULL(strstr(special_source, " -INFINITY,"));
+  CU_ASSERT_PTR_NULL(strstr(special_source, "nan"));
+  CU_ASSERT_PTR_NULL(strstr(special_source, "inf,"));
+
+  free(special_source);
+  fclose(special);
+  free(source);
+  free_matrix(expected);
+  free_matrix(input);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests the int8 GEMM against a straightforward reference, including a
+ * reduction length that is not a multiple of the SIMD width.
+ */
+void test_gemm_int8(void) {
+  enum { kM = 3, kN = 4, kK = 37 };
+  int8_t a[kM * kK];
+  int8_t b_t[kN * kK];
+  int32_t c[kM * kN];
+  for (size_t i = 0; i < kM * kK; i++) a[i] = (int8_t)((i * 29) % 255 - 127);
+  for (size_t i = 0; i < kN * kK; i++) b_t[i] = (int8_t)((i * 53) % 255 - 127);
+
+  gemm_int8(a, b_t, c, kM, kN, kK);
+  for (size_t i = 0; i < kM; i++) {
+    for (size_t j = 0; j < kN; j++) {
+      int32_t expected = 0;
+      for (size_t k = 0; k < kK; k++) {
+        expected += (int32_t)a[i * kK + k] * (int32_t)b_t[j * kK + k];
+      }
+      CU_ASSERT_EQUAL(c[i * kN + j], expected);
+    }
+  }
+}
+
+/**
+ * @brief Tests that int8 inference stays close to the double-precision
+ * forward pass on the calibration data.
+ */
+void test_quantized_predict(void) {
+  NeuralNetwork* nn = create_test_network(kTestSizes, 2, RELU, SOFTMAX);
+  Matrix* input = make_input(8, -1.0);
+
+  QuantizedNetwork* qnn = quantize_network(nn, input);
+  CU_ASSERT_PTR_NOT_NULL(qnn);
+  CU_ASSERT_EQUAL(qnn->num_layers, 2);
+
+  Matrix* expected = predict(nn, input);
+  Matrix* actual = quantized_predict(qnn, input);
+  CU_ASSERT_TRUE(compare_matrices(actual, expected, 2e-2));
+
+  free_matrix(input);
+  free_matrix(expected);
+  free_matrix(actual);
+  free_quantized_network(qnn);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests that streaming inference over several partial chunks writes
+ * the same predictions as one in-memory forward pass, and that malformed rows
+ * are reported.
+ */
+void test_stream_predict(void) {
+  NeuralNetwork* nn = create_test_network(kTestSizes, 2, RELU, SOFTMAX);
+  Matrix* input = make_input(7, -2.0);
+  Matrix* expected = predict(nn, input);
+
+  FILE* in = tmpfile();
+  FILE* out = tmpfile();
+  for (size_t i = 0; i < input->rows; i++) {
+    fprintf(in, "%.17g, %.17g,%.17g\n", input->matrix_data[i * 3],
+            input->matrix_data[i * 3 + 1], input->matrix_data[i * 3 + 2]);
+  }
+  rewind(in);
+
+  CU_ASSERT_EQUAL(stream_predict(nn, in, out, 3), 7);
+  rewind(out);
+  Matrix* actual = create_matrix(7, 2);
+  for (size_t i = 0; i < 14; i++) {
+    CU_ASSERT_EQUAL(fscanf(out, "%lf,", &actual->matrix_data[i]), 1);
+  }
+  CU_ASSERT_TRUE(compare_matrices(actual, expected, 1e-8));
+
+  FILE* bad = tmpfile();
+  fprintf(bad, "1,2,3\n4,5\n");
+  rewind(bad);
+  CU_ASSERT_EQUAL(stream_predict(nn, bad, out, 3), -1);
+
+  fclose(in);
+  fclose(out);
+  fclose(bad);
+  free_matrix(input);
+  free_matrix(expected);
+  free_matrix(actual);
+  free_network(nn);
+}
+
+/**
+ * @brief Array of CU_TestInfo structures for inference tests.
+ */
+CU_TestInfo inference_tests[] = {
+    {"test_predict_matches_feedforward", test_predict_matches_feedforward},
+    {"test_inference_pool_submit_wait", test_inference_pool_submit_wait},
+    {"test_model_slot_hot_swap", test_model_slot_hot_swap},
+    {"test_export_network_c", test_export_network_c},
+    {"test_gemm_int8", test_gemm_int8},
+    {"test_quantized_predict", test_quantized_predict},
+    {"test_stream_predict", test_stream_predict},
+    CU_TEST_INFO_NULL};
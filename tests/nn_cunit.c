@@ -11,10 +11,17 @@
 
 #include "activation.h"
 #include "backprop.h"
+#include "batch_norm.h"
+#include "cache.h"
+#include "conv.h"
 #include "feedforward.h"
+#include "init.h"
 #include "linalg.h"
 #include "loss.h"
 #include "neural_network.h"
+#include "optimizer.h"
+#include "pool.h"
+#include "rng.h"
 #include "test_utils.h"
 #include "utils.h"
 
@@ -60,7 +67,7 @@ void test_feedforward_simple() {
   CU_ASSERT_PTR_NOT_NULL(nn);
 
   // Create a simple layer
-  Layer* layer = (Layer*)malloc(sizeof(Layer));
+  Layer* layer = (Layer*)calloc(1, sizeof(Layer));
   CU_ASSERT_PTR_NOT_NULL(layer);
   layer->weights = create_matrix(2, 1);  // 2 inputs, 1 output
   layer->weights->matrix_data[0] = 0.5;
@@ -100,7 +107,7 @@ void test_backpropagate_softmax_cce() {
   CU_ASSERT_PTR_NOT_NULL(nn);
 
   // Create a simple layer with Softmax activation
-  Layer* layer = (Layer*)malloc(sizeof(Layer));
+  Layer* layer = (Layer*)calloc(1, sizeof(Layer));
   CU_ASSERT_PTR_NOT_NULL(layer);
   layer->weights = create_matrix(2, 2);  // 2 inputs, 2 outputs
   fill_matrix(layer->weights, 0.5);
@@ -148,6 +155,586 @@ void test_backpropagate_softmax_cce() {
   free_network(nn);
 }
 
+/**
+ * @brief Tests the fused softmax cross-entropy kernel against the separate
+ * softmax and CCE passes, its stability on large logits, and the fused
+ * backward pass after feedforward_logits against backpropagate.
+ */
+void test_softmax_cross_entropy_fused(void) {
+  Matrix* logits = create_matrix(3, 4);
+  Matrix* y = create_matrix(3, 4);
+  for (size_t i = 0; i < 12; i++) {
+    logits->matrix_data[i] = 0.3 * (double)i - 1.7;
+  }
+  fill_matrix(y, 0.0);
+  y->matrix_data[1] = 1.0;
+  y->matrix_data[4] = 1.0;
+  y->matrix_data[11] = 1.0;
+
+  Matrix* probabilities = softmax(logits);
+  Matrix* expected_delta = subtract_matrix(probabilities, y);
+  Matrix* delta = create_matrix(3, 4);
+  double loss = softmax_cross_entropy(logits, y, delta);
+  CU_ASSERT_DOUBLE_EQUAL(loss, categorical_cross_entropy(probabilities, y),
+                         1e-9);
+  CU_ASSERT_TRUE(compare_matrices(delta, expected_delta, 1e-12));
+  CU_ASSERT_DOUBLE_EQUAL(softmax_cross_entropy(logits, y, NULL), loss, 1e-15);
+
+  // A logit of 1000 overflows exp() without the log-sum-exp shift.
+  logits->matrix_data[0] = 1000.0;
+  loss = softmax_cross_entropy(logits, y, delta);
+  CU_ASSERT_TRUE(isfinite(loss));
+  CU_ASSERT_DOUBLE_EQUAL(delta->matrix_data[0], 1.0, 1e-12);
+  CU_ASSERT_DOUBLE_EQUAL(delta->matrix_data[1], -1.0, 1e-12);
+
+  const size_t sizes[] = {4, 3, 4};
+  NeuralNetwork* fused = create_test_network(sizes, 2, RELU, SOFTMAX);
+  NeuralNetwork* plain = create_test_network(sizes, 2, RELU, SOFTMAX);
+  Matrix* input = create_matrix(3, 4);
+  for (size_t i = 0; i < 12; i++) input->matrix_data[i] = 0.1 * (double)i;
+  free_matrix(feedforward(fused, input));
+  Matrix* out_fused = feedforward_logits(fused, input);
+  Matrix* out_plain = feedforward(plain, input);
+  // Only the logits come back, and no stale probabilities stay cached.
+  Matrix* softmax_fused = softmax(out_fused);
+  CU_ASSERT_TRUE(compare_matrices(softmax_fused, out_plain, 1e-12));
+  CU_ASSERT_PTR_NULL(cache_peek(fused->cache, "a_1"));
+  free_matrix(softmax_fused);
+  double fused_loss = backpropagate_softmax_cross_entropy(fused, y);
+  backpropagate(plain, y, CCE, categorical_cross_entropy_gradient);
+  CU_ASSERT_DOUBLE_EQUAL(fused_loss, categorical_cross_entropy(out_plain, y),
+                         1e-9);
+  for (size_t i = 0; i < 2; i++) {
+    char key[32];
+    sprintf(key, "delta_%zu", i);
+    Matrix* a = cache_get(fused->cache, key);
+    Matrix* b = cache_get(plain->cache, key);
+    CU_ASSERT_TRUE(compare_matrices(a, b, 1e-12));
+    free_matrix(a);
+    free_matrix(b);
+  }
+
+  free_matrix(out_fused);
+  free_matrix(out_plain);
+  free_matrix(input);
+  free_network(fused);
+  free_network(plain);
+  free_matrix(probabilities);
+  free_matrix(expected_delta);
+  free_matrix(delta);
+  free_matrix(logits);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests that the CSR forward and backward passes match the dense ones
+ * and leave the weight gradients of all-zero features at zero.
+ */
+void test_sparse_input(void) {
+  Matrix* input = create_matrix(4, 6);
+  Matrix* y = create_matrix(4, 2);
+  fill_matrix(input, 0.0);
+  fill_matrix(y, 0.0);
+  input->matrix_data[0 * 6 + 1] = 1.0;
+  input->matrix_data[1 * 6 + 4] = 0.5;
+  input->matrix_data[2 * 6 + 1] = -2.0;
+  input->matrix_data[2 * 6 + 5] = 1.0;
+  for (size_t r = 0; r < 4; r++) y->matrix_data[r * 2 + r % 2] = 1.0;
+
+  SparseMatrix* sparse = dense_to_sparse(input);
+  CU_ASSERT_PTR_NOT_NULL(sparse);
+  CU_ASSERT_EQUAL(sparse->nnz, 4);
+  CU_ASSERT_EQUAL(sparse->row_ptr[3], sparse->row_ptr[4]);
+
+  const size_t sizes[] = {6, 3, 2};
+  NeuralNetwork* nn = create_test_network(sizes, 2, TANH, SOFTMAX);
+  NetworkGradients* dense_grads = create_gradients(nn);
+  NetworkGradients* sparse_grads = create_gradients(nn);
+
+  Matrix* out_dense = feedforward(nn, input);
+  backpropagate_gradients(nn, y, CCE, categorical_cross_entropy_gradient,
+                          dense_grads, NULL, NULL);
+  Matrix* out_sparse = feedforward_sparse(nn, sparse);
+  CU_ASSERT_PTR_NULL(cache_peek(nn->cache, "input"));
+  backpropagate_gradients_sparse(nn, sparse, y, CCE,
+                                 categorical_cross_entropy_gradient,
+                                 sparse_grads, NULL, NULL);
+
+  CU_ASSERT_TRUE(compare_matrices(out_sparse, out_dense, 1e-12));
+  for (size_t i = 0; i < dense_grads->size; i++) {
+    CU_ASSERT_DOUBLE_EQUAL(sparse_grads->data[i], dense_grads->data[i],
+                           1e-12);
+  }
+  // Features 0, 2 and 3 are zero in every row.
+  for (size_t j = 0; j < 3; j++) {
+    CU_ASSERT_EQUAL(sparse_grads->weights[0]->matrix_data[0 * 3 + j], 0.0);
+    CU_ASSERT_EQUAL(sparse_grads->weights[0]->matrix_data[3 * 3 + j], 0.0);
+  }
+
+  free_matrix(out_dense);
+  free_matrix(out_sparse);
+  free_gradients(dense_grads);
+  free_gradients(sparse_grads);
+  free_network(nn);
+  free_sparse_matrix(sparse);
+  free_matrix(input);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests the Xavier/He schemes' ranges and spreads, that biases are
+ * zeroed, that initialization is reproducible from the seed, and that a
+ * normal init reserves every offset it reads.
+ */
+void test_weight_initialization(void) {
+  const size_t sizes[] = {50, 30, 10};
+  NeuralNetwork* nn = create_test_network(sizes, 2, RELU, SIGMOID);
+  fill_matrix(nn->layers[0]->bias, 1.0);
+
+  rng_set_seed(99);
+  initialize_network(nn, INIT_HE_UNIFORM);
+  const Matrix* w = nn->layers[0]->weights;
+  double limit = sqrt(6.0 / 50.0);
+  double sum_sq = 0.0;
+  for (size_t i = 0; i < 1500; i++) {
+    CU_ASSERT_TRUE(fabs(w->matrix_data[i]) <= limit);
+    sum_sq += w->matrix_data[i] * w->matrix_data[i];
+  }
+  // U(-a, a) has variance a^2 / 3 = 2 / fan_in.
+  CU_ASSERT_DOUBLE_EQUAL(sum_sq / 1500.0, 2.0 / 50.0, 0.006);
+  for (size_t j = 0; j < 30; j++) {
+    CU_ASSERT_EQUAL(nn->layers[0]->bias->matrix_data[j], 0.0);
+  }
+
+  Matrix* first = copy_matrix(nn->layers[1]->weights);
+  rng_set_seed(99);
+  initialize_network(nn, INIT_HE_UNIFORM);
+  CU_ASSERT_TRUE(compare_matrices(nn->layers[1]->weights, first, 0.0));
+
+  initialize_matrix(nn->layers[0]->weights, INIT_XAVIER_NORMAL, 50, 30);
+  sum_sq = 0.0;
+  for (size_t i = 0; i < 1500; i++) {
+    sum_sq += w->matrix_data[i] * w->matrix_data[i];
+  }
+  CU_ASSERT_DOUBLE_EQUAL(sum_sq / 1500.0, 2.0 / 80.0, 0.005);
+
+  // A normal init reserves the 2 offsets per value it reads, so a uniform
+  // draw right after it shares no bits with the weights.
+  rng_set_seed(17);
+  initialize_matrix(nn->layers[1]->weights, INIT_HE_NORMAL, 30, 10);
+  uint64_t next = rng_reserve(1);
+  CU_ASSERT_TRUE(next >= 2 * 300);
+  double stddev = sqrt(2.0 / 30.0);
+  for (size_t i = 0; i < 300; i++) {
+    double u1 = rng_uniform(17, 2 * i) + ldexp(1.0, -53);
+    double u2 = rng_uniform(17, 2 * i + 1);
+    double expected =
+        stddev * sqrt(-2.0 * log(u1)) * cos(6.28318530717958647692 * u2);
+    CU_ASSERT_DOUBLE_EQUAL(nn->layers[1]->weights->matrix_data[i], expected,
+                           1e-12);
+  }
+
+  free_matrix(first);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests dropout: about the requested fraction of hidden outputs is
+ * zeroed and the rest scaled by 1 / (1 - p), dropped units get no gradient,
+ * and inference mode matches predict.
+ */
+void test_dropout(void) {
+  const size_t sizes[] = {8, 256, 3};
+  NeuralNetwork* nn = create_test_network(sizes, 2, SIGMOID, SOFTMAX);
+  nn->layers[0]->dropout_rate = 0.5;
+  nn->layers[1]->dropout_rate = 0.5;  // Output layer: ignored.
+  Matrix* x = create_matrix(1, 8);
+  Matrix* y = create_matrix(1, 3);
+  for (size_t j = 0; j < 8; j++) x->matrix_data[j] = 0.1 * (double)j - 0.3;
+  fill_matrix(y, 0.0);
+  y->matrix_data[1] = 1.0;
+
+  Matrix* reference = predict(nn, x);
+  Matrix* eval = feedforward(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(eval, reference, 0.0));
+  Matrix* hidden = copy_matrix(cache_peek(nn->cache, "a_0"));
+
+  rng_set_seed(7);
+  nn->training = 1;
+  Matrix* train = feedforward(nn, x);
+  const Matrix* dropped = cache_peek(nn->cache, "a_0");
+  const uint64_t* mask = (const uint64_t*)cache_peek_buffer(nn->cache,
+                                                            "mask_0");
+  CU_ASSERT_PTR_NOT_NULL(mask);
+  CU_ASSERT_PTR_NULL(cache_peek_buffer(nn->cache, "mask_1"));
+  size_t kept = 0;
+  for (size_t j = 0; j < 256; j++) {
+    int keep = (int)((mask[j / 64] >> (j % 64)) & 1);
+    kept += (size_t)keep;
+    double expected = keep ? 2.0 * hidden->matrix_data[j] : 0.0;
+    CU_ASSERT_DOUBLE_EQUAL(dropped->matrix_data[j], expected, 1e-12);
+  }
+  CU_ASSERT_TRUE(kept > 96 && kept < 160);
+
+  NetworkGradients* grads = create_gradients(nn);
+  backpropagate_gradients(nn, y, CCE, categorical_cross_entropy_gradient,
+                          grads, NULL, NULL);
+  for (size_t j = 0; j < 256; j++) {
+    int keep = (int)((mask[j / 64] >> (j % 64)) & 1);
+    CU_ASSERT_EQUAL(grads->bias[0]->matrix_data[j] == 0.0, !keep);
+    CU_ASSERT_EQUAL(grads->weights[1]->matrix_data[j * 3] == 0.0, !keep);
+  }
+
+  // A new pass draws a new mask.
+  Matrix* again = feedforward(nn, x);
+  CU_ASSERT_FALSE(compare_matrices(again, train, 1e-12));
+  nn->training = 0;
+  Matrix* after = feedforward(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(after, reference, 0.0));
+
+  free_gradients(grads);
+  free_matrix(reference);
+  free_matrix(eval);
+  free_matrix(hidden);
+  free_matrix(train);
+  free_matrix(again);
+  free_matrix(after);
+  free_matrix(x);
+  free_matrix(y);
+  free_network(nn);
+}
+
+/**
+ * @brief Sum of squared errors of a training-mode forward pass; the loss whose
+ * gradient is mean_squared_error_gradient.
+ */
+static double sum_squared_error(NeuralNetwork* nn, const Matrix* x,
+                                const Matrix* y) {
+  Matrix* y_hat = feedforward(nn, x);
+  double loss = mean_squared_error(y_hat, y) * (double)(y->rows * y->cols);
+  free_matrix(y_hat);
+  return loss;
+}
+
+/**
+ * @brief Tests batch normalization: the single-pass statistics, gradients of
+ * the weights and of gamma/beta against finite differences, and that folding
+ * into the weights preserves inference outputs.
+ */
+void test_batch_norm(void) {
+  Matrix* x = create_matrix(6, 4);
+  Matrix* y = create_matrix(6, 2);
+  for (size_t i = 0; i < 24; i++) x->matrix_data[i] = sin(1.7 * (double)i);
+  for (size_t i = 0; i < 12; i++) y->matrix_data[i] = (double)(i % 3) / 2.0;
+
+  double mean[4], var[4];
+  batch_norm_statistics(x, mean, var);
+  for (size_t j = 0; j < 4; j++) {
+    double m = 0.0, v = 0.0;
+    for (size_t r = 0; r < 6; r++) m += x->matrix_data[r * 4 + j] / 6.0;
+    for (size_t r = 0; r < 6; r++) {
+      double d = x->matrix_data[r * 4 + j] - m;
+      v += d * d / 6.0;
+    }
+    CU_ASSERT_DOUBLE_EQUAL(mean[j], m, 1e-12);
+    CU_ASSERT_DOUBLE_EQUAL(var[j], v, 1e-12);
+  }
+
+  const size_t sizes[] = {4, 5, 2};
+  NeuralNetwork* nn = create_test_network(sizes, 2, TANH, SIGMOID);
+  BatchNorm* bn = create_batch_norm(5);
+  for (size_t j = 0; j < 5; j++) {
+    bn->gamma->matrix_data[j] = 0.5 + 0.1 * (double)j;
+    bn->beta->matrix_data[j] = 0.1 * (double)j - 0.2;
+  }
+  nn->layers[0]->batch_norm = bn;
+  nn->training = 1;
+
+  NetworkGradients* grads = create_gradients(nn);
+  Matrix* y_hat = feedforward(nn, x);
+  backpropagate_gradients(nn, y, MSE, mean_squared_error_gradient, grads,
+                          NULL, NULL);
+  free_matrix(y_hat);
+
+  double* params[] = {&nn->layers[0]->weights->matrix_data[3],
+                      &nn->layers[0]->weights->matrix_data[12],
+                      &bn->gamma->matrix_data[2], &bn->beta->matrix_data[4]};
+  double analytic[] = {grads->weights[0]->matrix_data[3],
+                       grads->weights[0]->matrix_data[12],
+                       bn->grad_gamma->matrix_data[2],
+                       bn->grad_beta->matrix_data[4]};
+  for (size_t k = 0; k < 4; k++) {
+    double saved = *params[k];
+    *params[k] = saved + 1e-6;
+    double plus = sum_squared_error(nn, x, y);
+    *params[k] = saved - 1e-6;
+    double minus = sum_squared_error(nn, x, y);
+    *params[k] = saved;
+    CU_ASSERT_DOUBLE_EQUAL(analytic[k], (plus - minus) / 2e-6, 1e-6);
+  }
+  // The bias before a normalization has no effect on the output.
+  CU_ASSERT_DOUBLE_EQUAL(grads->bias[0]->matrix_data[1], 0.0, 1e-12);
+  CU_ASSERT_TRUE(bn->running_mean->matrix_data[0] != 0.0);
+
+  // Accumulating one batch after zero_gradients, twice, gives the
+  // normalization gradients of a single fresh step each time.
+  Matrix* grad_gamma = copy_matrix(bn->grad_gamma);
+  Matrix* grad_beta = copy_matrix(bn->grad_beta);
+  for (int step = 0; step < 2; step++) {
+    zero_gradients(grads);
+    free_matrix(feedforward(nn, x));
+    backpropagate_accumulate(nn, y, MSE, mean_squared_error_gradient, grads);
+    CU_ASSERT_TRUE(compare_matrices(bn->grad_gamma, grad_gamma, 1e-12));
+    CU_ASSERT_TRUE(compare_matrices(bn->grad_beta, grad_beta, 1e-12));
+  }
+  free_matrix(grad_gamma);
+  free_matrix(grad_beta);
+
+  // A first Adam step moves every parameter by the learning rate against the
+  // sign of its gradient, the normalization scale and shift included.
+  Optimizer* opt = create_optimizer(OPTIMIZER_ADAM, nn, 0.01);
+  CU_ASSERT_EQUAL(opt->bn_offsets[0], opt->num_parameters);
+  CU_ASSERT_EQUAL(opt->bn_offsets[1], opt->num_parameters + 10);
+  double gamma = bn->gamma->matrix_data[2];
+  double beta = bn->beta->matrix_data[4];
+  optimizer_apply_gradients(opt, nn, grads);
+  CU_ASSERT_DOUBLE_EQUAL(bn->gamma->matrix_data[2],
+                         gamma - copysign(0.01, analytic[2]), 1e-6);
+  CU_ASSERT_DOUBLE_EQUAL(bn->beta->matrix_data[4],
+                         beta - copysign(0.01, analytic[3]), 1e-6);
+  free_optimizer(opt);
+
+  nn->training = 0;
+  Matrix* before = predict(nn, x);
+  Matrix* cached = feedforward(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(cached, before, 1e-12));
+  fold_network_batch_norm(nn);
+  CU_ASSERT_PTR_NULL(nn->layers[0]->batch_norm);
+  Matrix* after = predict(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(after, before, 1e-12));
+
+  free_matrix(before);
+  free_matrix(cached);
+  free_matrix(after);
+  free_gradients(grads);
+  free_network(nn);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/** @brief Fills a matrix from the global RNG stream with U(lo, hi). */
+static void fill_uniform(Matrix* m, double lo, double hi) {
+  size_t count = m->rows * m->cols;
+  rng_fill_uniform(rng_seed(), rng_reserve(count), m->matrix_data, count, lo,
+                   hi);
+}
+
+/** @brief One weight or bias entry of a network layer. */
+typedef struct {
+  size_t layer; /**< Layer index. */
+  int bias;     /**< Nonzero for the bias, zero for the weights. */
+  size_t index; /**< Element index within the matrix. */
+} ParamRef;
+
+/** @brief A fully connected sigmoid layer for the end of a test network. */
+static Layer* create_dense_head(size_t inputs, size_t outputs) {
+  Layer* dense = (Layer*)calloc(1, sizeof(Layer));
+  dense->weights = create_matrix(inputs, outputs);
+  dense->bias = create_matrix(1, outputs);
+  dense->activation_type = SIGMOID;
+  return dense;
+}
+
+/**
+ * @brief Checks that both backward passes and the per-layer gradient helpers
+ * agree, and that the gradients of the referenced parameters match finite
+ * differences of sum_squared_error.
+ * @return The output of the forward pass on x. Caller frees.
+ */
+static Matrix* check_network_gradients(NeuralNetwork* nn, const Matrix* x,
+                                       const Matrix* y, const ParamRef* refs,
+                                       size_t count) {
+  NetworkGradients* grads = create_gradients(nn);
+  NetworkGradients* cached = create_gradients(nn);
+  Matrix* y_hat = feedforward(nn, x);
+  backpropagate_gradients(nn, y, MSE, mean_squared_error_gradient, grads,
+                          NULL, NULL);
+  backpropagate(nn, y, MSE, mean_squared_error_gradient);
+  compute_gradients(nn, cached);
+  for (size_t i = 0; i < grads->size; i++) {
+    CU_ASSERT_DOUBLE_EQUAL(cached->data[i], grads->data[i], 1e-12);
+  }
+  for (size_t i = 0; i < nn->num_layers; i++) {
+    Matrix* dW = calculate_weight_gradient(nn, i);
+    Matrix* db = calculate_bias_gradient(nn, i);
+    CU_ASSERT_TRUE(compare_matrices(dW, cached->weights[i], 1e-12));
+    CU_ASSERT_TRUE(compare_matrices(db, cached->bias[i], 1e-12));
+    free_matrix(dW);
+    free_matrix(db);
+  }
+
+  for (size_t k = 0; k < count; k++) {
+    const Layer* layer = nn->layers[refs[k].layer];
+    Matrix* param = refs[k].bias ? layer->bias : layer->weights;
+    const Matrix* grad = refs[k].bias ? grads->bias[refs[k].layer]
+                                      : grads->weights[refs[k].layer];
+    double* p = &param->matrix_data[refs[k].index];
+    double saved = *p;
+    *p = saved + 1e-6;
+    double plus = sum_squared_error(nn, x, y);
+    *p = saved - 1e-6;
+    double minus = sum_squared_error(nn, x, y);
+    *p = saved;
+    CU_ASSERT_DOUBLE_EQUAL(grad->matrix_data[refs[k].index],
+                           (plus - minus) / 2e-6, 1e-6);
+  }
+
+  free_gradients(grads);
+  free_gradients(cached);
+  return y_hat;
+}
+
+/**
+ * @brief Tests the im2col convolution against a direct loop, and the
+ * gradients of a pointwise and a strided, padded convolution, through both
+ * backward passes, against finite differences.
+ */
+void test_conv2d(void) {
+  rng_set_seed(11);
+  NeuralNetwork* nn = create_network(3);
+  nn->layers[0] = create_conv2d_layer(5, 4, 2, 3, 1, 1, 0, TANH);
+  nn->layers[1] = create_conv2d_layer(5, 4, 3, 4, 3, 2, 1, TANH);
+  const Layer* layer = nn->layers[1];
+  CU_ASSERT_EQUAL(layer->conv->out_height, 3);
+  CU_ASSERT_EQUAL(layer->conv->out_width, 2);
+  CU_ASSERT_EQUAL(layer_input_size(layer), 60);
+  CU_ASSERT_EQUAL(layer_output_size(layer), 24);
+  nn->layers[2] = create_dense_head(24, 2);
+  initialize_network(nn, INIT_XAVIER_UNIFORM);
+  fill_uniform(nn->layers[0]->bias, -0.5, 0.5);
+  fill_uniform(nn->layers[1]->bias, -0.5, 0.5);
+
+  // Direct convolution, channels last.
+  Matrix* x1 = create_matrix(2, 60);
+  fill_uniform(x1, -1.0, 1.0);
+  Matrix* z = conv2d_forward(layer, x1);
+  for (size_t n = 0; n < 2; n++) {
+    for (size_t p = 0; p < 6; p++) {
+      for (size_t f = 0; f < 4; f++) {
+        double sum = layer->bias->matrix_data[f];
+        for (size_t t = 0; t < 9; t++) {
+          long ih = (long)(p / 2 * 2 + t / 3) - 1;
+          long iw = (long)(p % 2 * 2 + t % 3) - 1;
+          if (ih < 0 || ih >= 5 || iw < 0 || iw >= 4) continue;
+          for (size_t c = 0; c < 3; c++) {
+            size_t in = n * 60 + ((size_t)ih * 4 + (size_t)iw) * 3 + c;
+            sum += x1->matrix_data[in] *
+                   layer->weights->matrix_data[(t * 3 + c) * 4 + f];
+          }
+        }
+        CU_ASSERT_DOUBLE_EQUAL(z->matrix_data[n * 24 + p * 4 + f], sum,
+                               1e-12);
+      }
+    }
+  }
+
+  Matrix* x = create_matrix(3, 40);
+  Matrix* y = create_matrix(3, 2);
+  fill_uniform(x, -1.0, 1.0);
+  fill_uniform(y, 0.0, 1.0);
+  const ParamRef refs[] = {{0, 0, 4}, {0, 1, 1}, {1, 0, 50}, {1, 1, 3}};
+  Matrix* y_hat = check_network_gradients(nn, x, y, refs, 4);
+
+  Matrix* predicted = predict(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(predicted, y_hat, 1e-12));
+
+  free_matrix(predicted);
+  free_matrix(y_hat);
+  free_matrix(z);
+  free_matrix(x1);
+  free_network(nn);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests max-pool windows and argmax routing on a hand-built image, and
+ * the gradients of a convolution, overlapping max-pool and dense head against
+ * finite differences.
+ */
+void test_max_pool(void) {
+  // One 3x3 image with two channels, 2x2 windows at stride 1.
+  Layer* pool_layer = create_max_pool_layer(3, 3, 2, 2, 1);
+  const Pool2D* pool = pool_layer->pool;
+  CU_ASSERT_EQUAL(pool->out_height, 2);
+  CU_ASSERT_EQUAL(pool->out_width, 2);
+  CU_ASSERT_PTR_NULL(pool_layer->weights->matrix_data);
+  CU_ASSERT_PTR_NULL(pool_layer->bias->matrix_data);
+  double image[18];
+  for (size_t k = 0; k < 9; k++) {
+    image[2 * k] = (double)k;           // Bottom-right tap always wins.
+    image[2 * k + 1] = (double)(8 - k); // Top-left tap always wins.
+  }
+  Matrix* input = create_matrix(1, 18);
+  memcpy(input->matrix_data, image, sizeof(image));
+  uint8_t argmax[8];
+  Matrix* pooled = max_pool_forward(pool, input, argmax);
+  double expected[] = {4, 8, 5, 7, 7, 5, 8, 4};
+  for (size_t k = 0; k < 8; k++) {
+    CU_ASSERT_DOUBLE_EQUAL(pooled->matrix_data[k], expected[k], 0.0);
+    CU_ASSERT_EQUAL(argmax[k], k % 2 == 0 ? 3 : 0);
+  }
+  Matrix* delta = create_matrix(1, 8);
+  fill_matrix(delta, 1.0);
+  Matrix* delta_input = create_matrix(1, 18);
+  max_pool_backward(pool, delta, argmax, delta_input);
+  // The centre pixel wins all four windows in both channels.
+  CU_ASSERT_DOUBLE_EQUAL(delta_input->matrix_data[8], 1.0, 0.0);
+  CU_ASSERT_DOUBLE_EQUAL(delta_input->matrix_data[9], 1.0, 0.0);
+  CU_ASSERT_DOUBLE_EQUAL(delta_input->matrix_data[0], 0.0, 0.0);
+  CU_ASSERT_DOUBLE_EQUAL(delta_input->matrix_data[1], 1.0, 0.0);
+  CU_ASSERT_DOUBLE_EQUAL(delta_input->matrix_data[16], 1.0, 0.0);
+  free_matrix(delta_input);
+  free_matrix(delta);
+  free_matrix(pooled);
+  free_matrix(input);
+
+  // Convolution, overlapping max-pool and a dense head.
+  rng_set_seed(13);
+  NeuralNetwork* nn = create_network(3);
+  nn->layers[0] = create_conv2d_layer(4, 4, 1, 2, 3, 1, 1, TANH);
+  nn->layers[1] = create_max_pool_layer(4, 4, 2, 2, 1);
+  CU_ASSERT_EQUAL(layer_input_size(nn->layers[1]), 32);
+  CU_ASSERT_EQUAL(layer_output_size(nn->layers[1]), 18);
+  CU_ASSERT_FALSE(network_is_dense(nn));
+  nn->layers[2] = create_dense_head(18, 2);
+  initialize_network(nn, INIT_XAVIER_UNIFORM);
+  fill_uniform(nn->layers[0]->bias, -0.5, 0.5);
+
+  Matrix* x = create_matrix(3, 16);
+  Matrix* y = create_matrix(3, 2);
+  fill_uniform(x, -1.0, 1.0);
+  fill_uniform(y, 0.0, 1.0);
+  const ParamRef refs[] = {{0, 0, 3}, {0, 0, 10}, {0, 1, 1}, {2, 0, 7}};
+  Matrix* y_hat = check_network_gradients(nn, x, y, refs, 4);
+
+  Matrix* predicted = predict(nn, x);
+  CU_ASSERT_TRUE(compare_matrices(predicted, y_hat, 1e-12));
+
+  NeuralNetwork* copy = copy_network(nn);
+  Matrix* copied = predict(copy, x);
+  CU_ASSERT_TRUE(compare_matrices(copied, y_hat, 1e-12));
+
+  free_matrix(copied);
+  free_network(copy);
+  free_matrix(predicted);
+  free_matrix(y_hat);
+  free_network(nn);
+  free_matrix(x);
+  free_matrix(y);
+  free_layer(pool_layer);
+}
+
 /**
  * @brief Array of CU_TestInfo structures for neural network tests.
  */
@@ -156,4 +743,11 @@ CU_TestInfo nn_tests[] = {
     {"test_create_free_network", test_create_free_network},
     {"test_feedforward_simple", test_feedforward_simple},
     {"test_backpropagate_softmax_cce", test_backpropagate_softmax_cce},
+    {"test_softmax_cross_entropy_fused", test_softmax_cross_entropy_fused},
+    {"test_sparse_input", test_sparse_input},
+    {"test_weight_initialization", test_weight_initialization},
+    {"test_dropout", test_dropout},
+    {"test_batch_norm", test_batch_norm},
+    {"test_conv2d", test_conv2d},
+    {"test_max_pool", test_max_pool},
     CU_TEST_INFO_NULL};
@@ -6,6 +6,9 @@
 #include "test_utils.h"
 
 #include <math.h>
+#include <stdlib.h>
+
+#include "feedforward.h"
 
 /**
  * @brief Compares two matrices for approximate equality.
@@ -26,3 +29,34 @@ int compare_matrices(Matrix* m1, Matrix* m2, double epsilon) {
   }
   return 1;
 }
+
+/**
+ * @brief Builds a small fully connected network with deterministic weights.
+ * @param layer_sizes Array of num_layers + 1 layer widths, input first.
+ * @param num_layers Number of weight layers.
+ * @param hidden Activation of every layer except the last.
+ * @param output Activation of the last layer.
+ * @return A new network; free with free_network.
+ */
+NeuralNetwork* create_test_network(const size_t* layer_sizes,
+                                   size_t num_layers,
+                                   activation_function hidden,
+                                   activation_function output) {
+  NeuralNetwork* nn = create_network(num_layers);
+  for (size_t i = 0; i < num_layers; i++) {
+    Layer* layer = (Layer*)calloc(1, sizeof(Layer));
+    layer->weights = create_matrix(layer_sizes[i], layer_sizes[i + 1]);
+    layer->bias = create_matrix(1, layer_sizes[i + 1]);
+    size_t total = layer->weights->rows * layer->weights->cols;
+    for (size_t j = 0; j < total; j++) {
+      layer->weights->matrix_data[j] = 0.1 * (double)((j * 7 + i) % 11) - 0.5;
+    }
+    for (size_t j = 0; j < layer->bias->cols; j++) {
+      layer->bias->matrix_data[j] = 0.05 * (double)(j % 3);
+    }
+    layer->activation_type = (i == num_layers - 1) ? output : hidden;
+    layer->leak_parameter = 0.01;
+    nn->layers[i] = layer;
+  }
+  return nn;
+}
@@ -2,7 +2,9 @@
 
 #include <CUnit/Basic.h>
 
+#include "activation.h"
 #include "linalg.h"
+#include "neural_network.h"
 
 /**
  * @file test_utils.h
@@ -13,7 +15,9 @@
 
 #include <CUnit/Basic.h>
 
+#include "activation.h"
 #include "linalg.h"
+#include "neural_network.h"
 
 /**
  * @brief Helper function to compare two matrices for CUnit assertions.
@@ -23,3 +27,17 @@
  * @return 1 if the matrices are approximately equal, 0 otherwise.
  */
 int compare_matrices(Matrix* m1, Matrix* m2, double epsilon);
+
+/**
+ * @brief Builds a small fully connected network with deterministic weights.
+ * Weights and biases follow a fixed pattern so results are reproducible.
+ * @param layer_sizes Array of num_layers + 1 layer widths, input first.
+ * @param num_layers Number of weight layers.
+ * @param hidden Activation of every layer except the last.
+ * @param output Activation of the last layer.
+ * @return A new network; free with free_network.
+ */
+NeuralNetwork* create_test_network(const size_t* layer_sizes,
+                                   size_t num_layers,
+                                   activation_function hidden,
+                                   activation_function output);
@@ -0,0 +1,763 @@
+/**
+ * @file training_cunit.c
+ * @brief CUnit tests for parameter updates and training utilities.
+ */
+
+#include <CUnit/Basic.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "backprop.h"
+#include "feedforward.h"
+#include "linalg.h"
+#include "loss.h"
+#include "mixed_precision.h"
+#include "neural_network.h"
+#include "optimizer.h"
+#include "parallel_training.h"
+#include "shm_allreduce.h"
+#include "test_utils.h"
+#include "trainer.h"
+
+static const size_t kTrainSizes[] = {3, 4, 2};
+
+/**
+ * @brief Tests that the fused SGD update matches W - lr * dW and keeps the
+ * parameter buffers in place.
+ */
+void test_sgd_update_in_place(void) {
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, RELU, SIGMOID);
+  Layer* layer = nn->layers[0];
+  double* weights_data = layer->weights->matrix_data;
+  double* bias_data = layer->bias->matrix_data;
+
+  Matrix* dW = create_matrix(3, 4);
+  Matrix* db = create_matrix(1, 4);
+  for (size_t i = 0; i < 12; i++) dW->matrix_data[i] = 0.1 * (double)i;
+  for (size_t i = 0; i < 4; i++) db->matrix_data[i] = -1.0 * (double)i;
+
+  Matrix* scaled_dW = scale_matrix(0.5, dW);
+  Matrix* scaled_db = scale_matrix(0.5, db);
+  Matrix* expected_W = subtract_matrix(layer->weights, scaled_dW);
+  Matrix* expected_b = subtract_matrix(layer->bias, scaled_db);
+
+  sgd_update(layer, dW, db, 0.5);
+  CU_ASSERT_PTR_EQUAL(layer->weights->matrix_data, weights_data);
+  CU_ASSERT_PTR_EQUAL(layer->bias->matrix_data, bias_data);
+  CU_ASSERT_TRUE(compare_matrices(layer->weights, expected_W, 1e-12));
+  CU_ASSERT_TRUE(compare_matrices(layer->bias, expected_b, 1e-12));
+
+  free_matrix(dW);
+  free_matrix(db);
+  free_matrix(scaled_dW);
+  free_matrix(scaled_db);
+  free_matrix(expected_W);
+  free_matrix(expected_b);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests one or two steps of each stateful optimizer against the
+ * closed-form result for a constant gradient.
+ */
+void test_optimizer_kernels(void) {
+  const OptimizerType types[] = {OPTIMIZER_MOMENTUM, OPTIMIZER_RMSPROP,
+                                 OPTIMIZER_ADAM};
+  for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+    NeuralNetwork* nn = create_test_network(kTrainSizes, 2, RELU, SIGMOID);
+    Matrix* initial = copy_matrix(nn->layers[1]->weights);
+    Optimizer* opt = create_optimizer(types[t], nn, 0.1);
+    CU_ASSERT_PTR_NOT_NULL(opt);
+    CU_ASSERT_EQUAL(opt->num_parameters, 3 * 4 + 4 + 4 * 2 + 2);
+
+    Matrix* dW[2] = {create_matrix(3, 4), create_matrix(4, 2)};
+    Matrix* db[2] = {create_matrix(1, 4), create_matrix(1, 2)};
+    for (size_t i = 0; i < 2; i++) {
+      fill_matrix(dW[i], -2.0);
+      fill_matrix(db[i], 0.5);
+    }
+
+    optimizer_step(opt, nn, dW, db);
+    double step = 0.0;
+    switch (types[t]) {
+      case OPTIMIZER_MOMENTUM:
+        optimizer_step(opt, nn, dW, db);
+        step = 0.1 * -2.0 * (1.0 + 0.9 + 1.0);
+        break;
+      case OPTIMIZER_RMSPROP:
+        step = 0.1 * -2.0 / (sqrt(0.1) * 2.0 + 1e-8);
+        break;
+      default:
+        step = 0.1 * -2.0 / (2.0 + 1e-8);
+        break;
+    }
+    for (size_t i = 0; i < 8; i++) {
+      CU_ASSERT_DOUBLE_EQUAL(nn->layers[1]->weights->matrix_data[i],
+                             initial->matrix_data[i] - step, 1e-9);
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+      free_matrix(dW[i]);
+      free_matrix(db[i]);
+    }
+    free_matrix(initial);
+    free_optimizer(opt);
+    free_network(nn);
+  }
+}
+
+/**
+ * @brief Tests that a contiguous network's parameters live in one buffer and
+ * that flat gradients and the single-kernel optimizer update match the
+ * per-layer path.
+ */
+void test_contiguous_parameters(void) {
+  const activation_function activations[] = {RELU, SIGMOID};
+  NeuralNetwork* flat = create_contiguous_network(kTrainSizes, activations, 2);
+  NeuralNetwork* ref = create_test_network(kTrainSizes, 2, RELU, SIGMOID);
+  CU_ASSERT_PTR_NOT_NULL(flat);
+  CU_ASSERT_EQUAL(flat->num_parameters, 3 * 4 + 4 + 4 * 2 + 2);
+
+  double* cursor = flat->parameters;
+  for (size_t i = 0; i < 2; i++) {
+    Layer* layer = flat->layers[i];
+    CU_ASSERT_PTR_EQUAL(layer->weights->matrix_data, cursor);
+    cursor += layer->weights->rows * layer->weights->cols;
+    CU_ASSERT_PTR_EQUAL(layer->bias->matrix_data, cursor);
+    cursor += layer->bias->cols;
+    memcpy(layer->weights->matrix_data, ref->layers[i]->weights->matrix_data,
+           sizeof(double) * layer->weights->rows * layer->weights->cols);
+    memcpy(layer->bias->matrix_data, ref->layers[i]->bias->matrix_data,
+           sizeof(double) * layer->bias->cols);
+  }
+
+  Matrix* input = create_matrix(5, 3);
+  Matrix* y_true = create_matrix(5, 2);
+  for (size_t i = 0; i < 15; i++) input->matrix_data[i] = 0.1 * (double)i - 0.6;
+  for (size_t i = 0; i < 10; i++) y_true->matrix_data[i] = (double)(i % 2);
+  free_matrix(feedforward(flat, input));
+  backpropagate(flat, y_true, MSE, mean_squared_error_gradient);
+
+  NetworkGradients* grads = create_gradients(flat);
+  CU_ASSERT_PTR_NOT_NULL(grads);
+  CU_ASSERT_EQUAL(grads->size, flat->num_parameters);
+  CU_ASSERT_EQUAL((uintptr_t)flat->parameters % 64, 0);
+  CU_ASSERT_EQUAL((uintptr_t)grads->data % 64, 0);
+  compute_gradients(flat, grads);
+
+  Matrix* dW[2];
+  Matrix* db[2];
+  double norm = 0.0;
+  for (size_t i = 0; i < 2; i++) {
+    dW[i] = calculate_weight_gradient(flat, i);
+    db[i] = calculate_bias_gradient(flat, i);
+    CU_ASSERT_TRUE(compare_matrices(grads->weights[i], dW[i], 1e-12));
+    CU_ASSERT_TRUE(compare_matrices(grads->bias[i], db[i], 1e-12));
+    for (size_t j = 0; j < dW[i]->rows * dW[i]->cols; j++) {
+      norm += dW[i]->matrix_data[j] * dW[i]->matrix_data[j];
+    }
+    for (size_t j = 0; j < db[i]->cols; j++) {
+      norm += db[i]->matrix_data[j] * db[i]->matrix_data[j];
+    }
+  }
+  CU_ASSERT_DOUBLE_EQUAL(gradient_l2_norm(grads), sqrt(norm), 1e-12);
+
+  Optimizer* flat_opt = create_optimizer(OPTIMIZER_ADAM, flat, 0.01);
+  Optimizer* ref_opt = create_optimizer(OPTIMIZER_ADAM, ref, 0.01);
+  for (int step = 0; step < 2; step++) {
+    optimizer_apply_gradients(flat_opt, flat, grads);
+    optimizer_step(ref_opt, ref, dW, db);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    CU_ASSERT_TRUE(compare_matrices(flat->layers[i]->weights,
+                                    ref->layers[i]->weights, 1e-12));
+    CU_ASSERT_TRUE(
+        compare_matrices(flat->layers[i]->bias, ref->layers[i]->bias, 1e-12));
+    free_matrix(dW[i]);
+    free_matrix(db[i]);
+  }
+
+  zero_gradients(grads);
+  CU_ASSERT_DOUBLE_EQUAL(gradient_l2_norm(grads), 0.0, 1e-15);
+
+  free_optimizer(flat_opt);
+  free_optimizer(ref_opt);
+  free_gradients(grads);
+  free_matrix(input);
+  free_matrix(y_true);
+  free_network(flat);
+  free_network(ref);
+}
+
+/** @brief Records the order in which backpropagate_gradients emits layers. */
+typedef struct {
+  Optimizer* opt;
+  size_t order[4];
+  size_t calls;
+} GradientTrace;
+
+/** @brief LayerGradientCallback that records the layer and updates it. */
+static void trace_and_update(size_t layer_index, Layer* layer, const Matrix* dW,
+                             const Matrix* db, void* user_data) {
+  GradientTrace* trace = (GradientTrace*)user_data;
+  trace->order[trace->calls++] = layer_index;
+  optimizer_layer_callback(layer_index, layer, dW, db, trace->opt);
+}
+
+/**
+ * @brief Tests that the single-pass backward emits the same gradients as
+ * backpropagate + compute_gradients, last layer first, and that updating each
+ * layer from the callback matches a separate optimizer step.
+ */
+void test_backpropagate_gradients(void) {
+  const size_t sizes[] = {3, 5, 4, 2};
+  Matrix* x = create_matrix(6, 3);
+  Matrix* y = create_matrix(6, 2);
+  for (size_t i = 0; i < 18; i++) x->matrix_data[i] = 0.11 * (double)i - 0.9;
+  for (size_t i = 0; i < 12; i++) y->matrix_data[i] = (double)(i % 3 == 1);
+
+  NeuralNetwork* nn = create_test_network(sizes, 3, LEAKY_RELU, SIGMOID);
+  NeuralNetwork* ref = copy_network(nn);
+  NetworkGradients* grads = create_gradients(nn);
+  NetworkGradients* ref_grads = create_gradients(ref);
+  Optimizer* opt = create_optimizer(OPTIMIZER_MOMENTUM, nn, 0.1);
+  Optimizer* ref_opt = create_optimizer(OPTIMIZER_MOMENTUM, ref, 0.1);
+  GradientTrace trace = {opt, {0}, 0};
+
+  for (int step = 0; step < 2; step++) {
+    free_matrix(feedforward(nn, x));
+    free_matrix(feedforward(ref, x));
+    optimizer_begin_step(opt);
+    trace.calls = 0;
+    backpropagate_gradients(nn, y, MSE, mean_squared_error_gradient, grads,
+                            trace_and_update, &trace);
+    backpropagate(ref, y, MSE, mean_squared_error_gradient);
+    compute_gradients(ref, ref_grads);
+
+    CU_ASSERT_EQUAL(trace.calls, 3);
+    CU_ASSERT_TRUE(trace.order[0] == 2 && trace.order[1] == 1 &&
+                   trace.order[2] == 0);
+    for (size_t i = 0; i < ref_grads->size; i++) {
+      CU_ASSERT_DOUBLE_EQUAL(grads->data[i], ref_grads->data[i], 1e-12);
+    }
+    optimizer_apply_gradients(ref_opt, ref, ref_grads);
+  }
+  for (size_t i = 0; i < 3; i++) {
+    CU_ASSERT_TRUE(compare_matrices(nn->layers[i]->weights,
+                                    ref->layers[i]->weights, 1e-12));
+    CU_ASSERT_TRUE(
+        compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-12));
+  }
+
+  free_optimizer(opt);
+  free_optimizer(ref_opt);
+  free_gradients(grads);
+  free_gradients(ref_grads);
+  free_network(nn);
+  free_network(ref);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests that accumulating gradients over micro-batches in place equals
+ * the gradients of the whole batch.
+ */
+void test_backpropagate_accumulate(void) {
+  Matrix* x = create_matrix(7, 3);
+  Matrix* y = create_matrix(7, 2);
+  for (size_t i = 0; i < 21; i++) x->matrix_data[i] = 0.09 * (double)i - 0.8;
+  for (size_t i = 0; i < 14; i++) y->matrix_data[i] = (double)(i % 2);
+
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, RELU, SOFTMAX);
+  NetworkGradients* accumulated = create_gradients(nn);
+  NetworkGradients* full = create_gradients(nn);
+  double* buffer = accumulated->data;
+
+  free_matrix(feedforward(nn, x));
+  backpropagate_gradients(nn, y, CCE, categorical_cross_entropy_gradient,
+                          full, NULL, NULL);
+
+  const size_t bounds[] = {0, 3, 4, 7};
+  fill_matrix(accumulated->weights[0], 99.0);
+  zero_gradients(accumulated);
+  for (size_t k = 0; k < 3; k++) {
+    size_t rows = bounds[k + 1] - bounds[k];
+    Matrix* x_micro =
+        create_matrix_view(x->matrix_data + bounds[k] * 3, rows, 3);
+    Matrix* y_micro =
+        create_matrix_view(y->matrix_data + bounds[k] * 2, rows, 2);
+    free_matrix(feedforward(nn, x_micro));
+    backpropagate_accumulate(nn, y_micro, CCE,
+                             categorical_cross_entropy_gradient, accumulated);
+    free_matrix_view(x_micro);
+    free_matrix_view(y_micro);
+  }
+
+  CU_ASSERT_PTR_EQUAL(accumulated->data, buffer);
+  for (size_t i = 0; i < full->size; i++) {
+    CU_ASSERT_DOUBLE_EQUAL(accumulated->data[i], full->data[i], 1e-12);
+  }
+
+  free_gradients(accumulated);
+  free_gradients(full);
+  free_network(nn);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests that a float32 mixed-precision step tracks the double step,
+ * that the initial loss scale is clamped, and that an overflowing step skips
+ * the update and backs off.
+ */
+void test_mixed_precision_step(void) {
+  Matrix* x = create_matrix(6, 3);
+  Matrix* y = create_matrix(6, 2);
+  fill_matrix(y, 0.0);
+  for (size_t i = 0; i < 18; i++) x->matrix_data[i] = 0.07 * (double)i - 0.6;
+  for (size_t r = 0; r < 6; r++) y->matrix_data[r * 2 + r % 2] = 1.0;
+
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, RELU, SOFTMAX);
+  NeuralNetwork* ref = copy_network(nn);
+  Optimizer* opt = create_optimizer(OPTIMIZER_SGD, nn, 0.1);
+  Optimizer* ref_opt = create_optimizer(OPTIMIZER_SGD, ref, 0.1);
+  NetworkGradients* ref_grads = create_gradients(ref);
+  MixedPrecisionTrainer* trainer = create_mixed_precision_trainer(
+      nn, CCE, categorical_cross_entropy, categorical_cross_entropy_gradient,
+      1024.0);
+  CU_ASSERT_PTR_NOT_NULL(trainer);
+
+  for (int step = 0; step < 3; step++) {
+    double loss = mixed_precision_step(trainer, opt, x, y);
+    Matrix* y_hat = feedforward(ref, x);
+    CU_ASSERT_DOUBLE_EQUAL(loss, categorical_cross_entropy(y_hat, y), 1e-5);
+    backpropagate_gradients(ref, y, CCE, categorical_cross_entropy_gradient,
+                            ref_grads, NULL, NULL);
+    optimizer_apply_gradients(ref_opt, ref, ref_grads);
+    free_matrix(y_hat);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    CU_ASSERT_TRUE(compare_matrices(nn->layers[i]->weights,
+                                    ref->layers[i]->weights, 1e-4));
+    CU_ASSERT_TRUE(
+        compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-4));
+  }
+  CU_ASSERT_EQUAL(mixed_precision_skipped_steps(trainer), 0);
+  free_mixed_precision_trainer(trainer);
+
+  // The initial scale is clamped, and huge inputs overflow the scaled
+  // first-layer weight gradient.
+  trainer = create_mixed_precision_trainer(
+      nn, CCE, NULL, categorical_cross_entropy_gradient, 1e300);
+  CU_ASSERT_DOUBLE_EQUAL(mixed_precision_loss_scale(trainer),
+                         MIXED_PRECISION_MAX_SCALE, 0.0);
+  NeuralNetwork* before = copy_network(nn);
+  for (size_t i = 0; i < 18; i++) x->matrix_data[i] *= 1e35;
+  mixed_precision_step(trainer, opt, x, y);
+  CU_ASSERT_EQUAL(mixed_precision_skipped_steps(trainer), 1);
+  CU_ASSERT_DOUBLE_EQUAL(mixed_precision_loss_scale(trainer),
+                         MIXED_PRECISION_MAX_SCALE / 2.0, 0.0);
+  CU_ASSERT_TRUE(compare_matrices(nn->layers[0]->weights,
+                                  before->layers[0]->weights, 0.0));
+
+  free_mixed_precision_trainer(trainer);
+  free_gradients(ref_grads);
+  free_optimizer(opt);
+  free_optimizer(ref_opt);
+  free_network(before);
+  free_network(nn);
+  free_network(ref);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/** @brief Batch transform for the trainer test: halves the inputs. */
+static void halve_inputs(Matrix* x, Matrix* y, void* user_data) {
+  (void)y;
+  for (size_t i = 0; i < x->rows * x->cols; i++) x->matrix_data[i] *= 0.5;
+  (*(size_t*)user_data)++;
+}
+
+/**
+ * @brief Tests that the prefetching trainer matches a hand-written epoch loop
+ * over the same transformed batches, and that shuffled epochs run.
+ */
+void test_trainer_epochs(void) {
+  Matrix* x = create_matrix(10, 3);
+  Matrix* y = create_matrix(10, 2);
+  for (size_t i = 0; i < 30; i++) x->matrix_data[i] = 0.06 * (double)i - 0.9;
+  for (size_t i = 0; i < 20; i++) y->matrix_data[i] = (double)(i % 3 == 1);
+
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, TANH, SIGMOID);
+  NeuralNetwork* ref = copy_network(nn);
+  Optimizer* opt = create_optimizer(OPTIMIZER_SGD, nn, 0.2);
+  Optimizer* ref_opt = create_optimizer(OPTIMIZER_SGD, ref, 0.2);
+  NetworkGradients* ref_grads = create_gradients(ref);
+
+  size_t transforms = 0;
+  TrainerConfig config = {4, 0, 0, MSE, mean_squared_error,
+                          mean_squared_error_gradient, halve_inputs,
+                          &transforms};
+  Trainer* trainer = create_trainer(nn, opt, x, y, &config);
+  CU_ASSERT_PTR_NOT_NULL(trainer);
+
+  for (int epoch = 0; epoch < 2; epoch++) {
+    double loss = trainer_run_epoch(trainer);
+    double ref_loss = 0.0;
+    for (size_t begin = 0; begin < 10; begin += 4) {
+      size_t rows = begin + 4 > 10 ? 10 - begin : 4;
+      Matrix* x_batch = create_matrix(rows, 3);
+      Matrix* y_batch = create_matrix(rows, 2);
+      memcpy(x_batch->matrix_data, x->matrix_data + begin * 3,
+             rows * 3 * sizeof(double));
+      memcpy(y_batch->matrix_data, y->matrix_data + begin * 2,
+             rows * 2 * sizeof(double));
+      halve_inputs(x_batch, y_batch, &(size_t){0});
+
+      Matrix* y_hat = feedforward(ref, x_batch);
+      ref_loss += mean_squared_error(y_hat, y_batch) * (double)rows;
+      backpropagate_gradients(ref, y_batch, MSE, mean_squared_error_gradient,
+                              ref_grads, NULL, NULL);
+      optimizer_apply_gradients(ref_opt, ref, ref_grads);
+      free_matrix(y_hat);
+      free_matrix(x_batch);
+      free_matrix(y_batch);
+    }
+    CU_ASSERT_DOUBLE_EQUAL(loss, ref_loss / 10.0, 1e-12);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    CU_ASSERT_TRUE(compare_matrices(nn->layers[i]->weights,
+                                    ref->layers[i]->weights, 1e-12));
+    CU_ASSERT_TRUE(
+        compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-12));
+  }
+  free_trainer(trainer);
+  // Six batches trained; the loader may have prefetched up to two more.
+  CU_ASSERT_TRUE(transforms >= 6 && transforms <= 8);
+
+  config.shuffle = 1;
+  config.seed = 7;
+  config.transform = NULL;
+  trainer = create_trainer(nn, opt, x, y, &config);
+  CU_ASSERT_PTR_NOT_NULL(trainer);
+  double first = trainer_run_epoch(trainer);
+  double last = first;
+  for (int epoch = 0; epoch < 20; epoch++) last = trainer_run_epoch(trainer);
+  CU_ASSERT_TRUE(last < first);
+  free_trainer(trainer);
+
+  free_gradients(ref_grads);
+  free_optimizer(opt);
+  free_optimizer(ref_opt);
+  free_network(nn);
+  free_network(ref);
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests that a data-parallel step matches a single-threaded step on the
+ * whole batch, including when there are more workers than rows, and that the
+ * workers follow the master's training flag.
+ */
+void test_data_parallel_step(void) {
+  const size_t worker_counts[] = {1, 3, 8};
+  Matrix* x = create_matrix(7, 3);
+  Matrix* y = create_matrix(7, 2);
+  for (size_t i = 0; i < 21; i++) x->matrix_data[i] = 0.05 * (double)i - 0.5;
+  for (size_t i = 0; i < 14; i++) y->matrix_data[i] = (double)(i % 3 == 0);
+
+  for (size_t t = 0; t < sizeof(worker_counts) / sizeof(worker_counts[0]);
+       t++) {
+    NeuralNetwork* nn = create_test_network(kTrainSizes, 2, TANH, SIGMOID);
+    NeuralNetwork* ref = copy_network(nn);
+    Optimizer* opt = create_optimizer(OPTIMIZER_MOMENTUM, nn, 0.05);
+    Optimizer* ref_opt = create_optimizer(OPTIMIZER_MOMENTUM, ref, 0.05);
+    NetworkGradients* ref_grads = create_gradients(ref);
+    // Replicas created in training mode must follow the later switch to
+    // evaluation mode, in which dropout is off.
+    nn->layers[0]->dropout_rate = 0.5;
+    nn->training = 1;
+    DataParallelTrainer* trainer = create_data_parallel_trainer(
+        nn, worker_counts[t], MSE, mean_squared_error,
+        mean_squared_error_gradient);
+    CU_ASSERT_PTR_NOT_NULL(trainer);
+    nn->training = 0;
+
+    for (int step = 0; step < 3; step++) {
+      double loss = data_parallel_step(trainer, opt, x, y);
+
+      Matrix* y_hat = feedforward(ref, x);
+      CU_ASSERT_DOUBLE_EQUAL(loss, mean_squared_error(y_hat, y), 1e-12);
+      backpropagate(ref, y, MSE, mean_squared_error_gradient);
+      compute_gradients(ref, ref_grads);
+      optimizer_apply_gradients(ref_opt, ref, ref_grads);
+      free_matrix(y_hat);
+    }
+    for (size_t i = 0; i < 2; i++) {
+      CU_ASSERT_TRUE(compare_matrices(nn->layers[i]->weights,
+                                      ref->layers[i]->weights, 1e-12));
+      CU_ASSERT_TRUE(
+          compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-12));
+    }
+
+    free_data_parallel_trainer(trainer);
+    free_gradients(ref_grads);
+    free_optimizer(opt);
+    free_optimizer(ref_opt);
+    free_network(nn);
+    free_network(ref);
+  }
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Tests that Hogwild training applies every mini-batch and reduces the
+ * training loss.
+ */
+void test_hogwild_train(void) {
+  Matrix* x = create_matrix(64, 3);
+  Matrix* y = create_matrix(64, 2);
+  for (size_t i = 0; i < 64; i++) {
+    double a = (double)(i % 8) / 8.0;
+    double b = (double)(i / 8) / 8.0;
+    x->matrix_data[i * 3] = a;
+    x->matrix_data[i * 3 + 1] = b;
+    x->matrix_data[i * 3 + 2] = 1.0;
+    y->matrix_data[i * 2] = (a > b) ? 1.0 : 0.0;
+    y->matrix_data[i * 2 + 1] = (a > b) ? 0.0 : 1.0;
+  }
+
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, TANH, SIGMOID);
+  Matrix* before = predict(nn, x);
+  double loss_before = mean_squared_error(before, y);
+
+  long updates = hogwild_train(nn, x, y, 4, 20, 0.05, 4, MSE,
+                               mean_squared_error_gradient);
+  CU_ASSERT_EQUAL(updates, 16 * 20);
+
+  Matrix* after = predict(nn, x);
+  CU_ASSERT_TRUE(mean_squared_error(after, y) < loss_before);
+
+  free_matrix(before);
+  free_matrix(after);
+  free_matrix(x);
+  free_matrix(y);
+  free_network(nn);
+}
+
+/**
+ * @brief Tests that a pipelined step matches a single-threaded step for
+ * several stage and micro-batch counts, including a softmax output.
+ */
+void test_pipeline_step(void) {
+  const size_t sizes[] = {3, 5, 4, 3, 2};
+  const size_t configs[][2] = {{1, 1}, {2, 3}, {4, 4}, {3, 16}};
+  Matrix* x = create_matrix(9, 3);
+  Matrix* y = create_matrix(9, 2);
+  for (size_t i = 0; i < 27; i++) x->matrix_data[i] = 0.07 * (double)i - 0.8;
+  fill_matrix(y, 0.0);
+  for (size_t i = 0; i < 9; i++) y->matrix_data[i * 2 + (i % 2)] = 1.0;
+
+  for (size_t t = 0; t < sizeof(configs) / sizeof(configs[0]); t++) {
+    int use_softmax = (t % 2 == 1);
+    NeuralNetwork* nn = create_test_network(sizes, 4, RELU,
+                                            use_softmax ? SOFTMAX : SIGMOID);
+    NeuralNetwork* ref = copy_network(nn);
+    LossFunctionType loss_type = use_softmax ? CCE : MSE;
+    LossFunction loss =
+        use_softmax ? categorical_cross_entropy : mean_squared_error;
+    LossFunctionGrad loss_grad = use_softmax
+                                     ? categorical_cross_entropy_gradient
+                                     : mean_squared_error_gradient;
+    Optimizer* opt = create_optimizer(OPTIMIZER_ADAM, nn, 0.01);
+    Optimizer* ref_opt = create_optimizer(OPTIMIZER_ADAM, ref, 0.01);
+    NetworkGradients* ref_grads = create_gradients(ref);
+    PipelineTrainer* trainer = create_pipeline_trainer(
+        nn, configs[t][0], configs[t][1], loss_type, loss, loss_grad);
+    CU_ASSERT_PTR_NOT_NULL(trainer);
+
+    for (int step = 0; step < 3; step++) {
+      double batch_loss = pipeline_step(trainer, opt, x, y);
+
+      Matrix* y_hat = feedforward(ref, x);
+      CU_ASSERT_DOUBLE_EQUAL(batch_loss, loss(y_hat, y), 1e-9);
+      backpropagate(ref, y, loss_type, loss_grad);
+      compute_gradients(ref, ref_grads);
+      optimizer_apply_gradients(ref_opt, ref, ref_grads);
+      free_matrix(y_hat);
+    }
+    for (size_t i = 0; i < 4; i++) {
+      CU_ASSERT_TRUE(compare_matrices(nn->layers[i]->weights,
+                                      ref->layers[i]->weights, 1e-9));
+      CU_ASSERT_TRUE(
+          compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-9));
+    }
+
+    free_pipeline_trainer(trainer);
+    free_gradients(ref_grads);
+    free_optimizer(opt);
+    free_optimizer(ref_opt);
+    free_network(nn);
+    free_network(ref);
+  }
+  free_matrix(x);
+  free_matrix(y);
+}
+
+/**
+ * @brief Builds the segment name of one group of the shared-memory test. Every
+ * group gets its own segment, so a rank still leaving one group cannot attach
+ * to it again instead of the next one.
+ * @param base Per-run name prefix.
+ * @param group Group index.
+ * @param name Receives the segment name.
+ * @param size Size of `name`.
+ */
+static void shm_group_name(const char* base, int group, char* name,
+                           size_t size) {
+  snprintf(name, size, "%s_%d", base, group);
+}
+
+/**
+ * @brief Body of one rank in the shared-memory allreduce test. Runs in a
+ * forked child for every rank but 0, so it reports through its return value.
+ * @return 1 if every check on this rank passed, 0 otherwise.
+ */
+static int run_shm_rank(const char* base, size_t rank, size_t world_size) {
+  const size_t count = 11;
+  char name[64];
+  shm_group_name(base, 0, name, sizeof(name));
+  ShmCommunicator* comm = shm_comm_open(name, rank, world_size, count);
+  if (comm == NULL) {
+    return 0;
+  }
+  int ok = 1;
+
+  double data[11];
+  for (int round = 0; round < 2; round++) {
+    for (size_t i = 0; i < count; i++) {
+      data[i] = (double)(rank * 100 + i + round);
+    }
+    shm_allreduce_sum(comm, data);
+    for (size_t i = 0; i < count; i++) {
+      double expected = 0.0;
+      for (size_t r = 0; r < world_size; r++) {
+        expected += (double)(r * 100 + i + round);
+      }
+      ok &= fabs(data[i] - expected) < 1e-12;
+    }
+  }
+  shm_comm_close(comm);
+
+  // Data-parallel step across ranks: start from perturbed weights, sync them
+  // from rank 0 and check the update against a local full-batch step.
+  NeuralNetwork* nn = create_test_network(kTrainSizes, 2, TANH, SIGMOID);
+  NeuralNetwork* ref = copy_network(nn);
+  NetworkGradients* grads = create_gradients(nn);
+  NetworkGradients* ref_grads = create_gradients(ref);
+  shm_group_name(base, 1, name, sizeof(name));
+  comm = shm_comm_open(name, rank, world_size, grads->size);
+  if (comm == NULL) {
+    return 0;
+  }
+  nn->layers[0]->weights->matrix_data[0] += (double)rank;
+  shm_sync_network(comm, nn);
+
+  Matrix* x = create_matrix(6, 3);
+  Matrix* y = create_matrix(6, 2);
+  for (size_t i = 0; i < 18; i++) x->matrix_data[i] = 0.1 * (double)i - 0.9;
+  for (size_t i = 0; i < 12; i++) y->matrix_data[i] = (double)(i % 2);
+  size_t rows = x->rows / world_size;
+  Matrix* x_shard =
+      create_matrix_view(x->matrix_data + rank * rows * 3, rows, 3);
+  Matrix* y_shard =
+      create_matrix_view(y->matrix_data + rank * rows * 2, rows, 2);
+
+  free_matrix(feedforward(nn, x_shard));
+  backpropagate(nn, y_shard, MSE, mean_squared_error_gradient);
+  compute_gradients(nn, grads);
+  shm_allreduce_gradients(comm, grads);
+  free_matrix(feedforward(ref, x));
+  backpropagate(ref, y, MSE, mean_squared_error_gradient);
+  compute_gradients(ref, ref_grads);
+  for (size_t i = 0; i < 2; i++) {
+    sgd_update(nn->layers[i], grads->weights[i], grads->bias[i], 0.1);
+    sgd_update(ref->layers[i], ref_grads->weights[i], ref_grads->bias[i], 0.1);
+    ok &= compare_matrices(nn->layers[i]->weights, ref->layers[i]->weights,
+                           1e-12);
+    ok &= compare_matrices(nn->layers[i]->bias, ref->layers[i]->bias, 1e-12);
+  }
+  shm_comm_close(comm);
+
+  free_matrix_view(x_shard);
+  free_matrix_view(y_shard);
+  free_matrix(x);
+  free_matrix(y);
+  free_gradients(grads);
+  free_gradients(ref_grads);
+  free_network(nn);
+  free_network(ref);
+  return ok;
+}
+
+/**
+ * @brief Tests the shared-memory ring allreduce and network sync across
+ * forked processes.
+ */
+void test_shm_allreduce(void) {
+  const size_t world_size = 3;
+  char base[48];
+  snprintf(base, sizeof(base), "/nn_test_allreduce_%ld", (long)getpid());
+  // Remove segments left behind by an aborted run that had the same pid.
+  for (int group = 0; group < 2; group++) {
+    char name[64];
+    shm_group_name(base, group, name, sizeof(name));
+    shm_unlink(name);
+  }
+
+  // Children would otherwise print the inherited, unflushed test log again.
+  fflush(stdout);
+  fflush(stderr);
+  pid_t children[2];
+  for (size_t rank = 1; rank < world_size; rank++) {
+    pid_t pid = fork();
+    CU_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+      _exit(run_shm_rank(base, rank, world_size) ? 0 : 1);
+    }
+    children[rank - 1] = pid;
+  }
+  CU_ASSERT_TRUE(run_shm_rank(base, 0, world_size));
+
+  for (size_t i = 0; i < world_size - 1; i++) {
+    int status = 0;
+    CU_ASSERT_EQUAL(waitpid(children[i], &status, 0), children[i]);
+    CU_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+
+/**
+ * @brief Array of CU_TestInfo structures for training tests.
+ */
+CU_TestInfo training_tests[] = {
+    {"test_sgd_update_in_place", test_sgd_update_in_place},
+    {"test_optimizer_kernels", test_optimizer_kernels},
+    {"test_contiguous_parameters", test_contiguous_parameters},
+    {"test_backpropagate_gradients", test_backpropagate_gradients},
+    {"test_backpropagate_accumulate", test_backpropagate_accumulate},
+    {"test_mixed_precision_step", test_mixed_precision_step},
+    {"test_trainer_epochs", test_trainer_epochs},
+    {"test_data_parallel_step", test_data_parallel_step},
+    {"test_hogwild_train", test_hogwild_train},
+    {"test_pipeline_step", test_pipeline_step},
+    {"test_shm_allreduce", test_shm_allreduce},
+    CU_TEST_INFO_NULL};